@@ -1,7 +1,28 @@
+#include "thh-handle-vector/chunked-handle-vector.hpp"
+#include "thh-handle-vector/concurrent-handle-vector.hpp"
+#include "thh-handle-vector/epoch-handle-vector.hpp"
+#include "thh-handle-vector/handle-registry.hpp"
+#include "thh-handle-vector/handle-soa-vector.hpp"
 #include "thh-handle-vector/handle-vector.hpp"
+#include "thh-handle-vector/join.hpp"
+#include "thh-handle-vector/mapped-handle-vector.hpp"
+#include "thh-handle-vector/packed-handle.hpp"
+#include "thh-handle-vector/static-handle-vector.hpp"
 
 #include <benchmark/benchmark.h>
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <memory_resource>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <utility>
+
 static void add_element(benchmark::State& state)
 {
   thh::handle_vector_t<int> handle_vector;
@@ -136,4 +157,1142 @@ static void enumerate_iterators(benchmark::State& state)
 
 BENCHMARK(enumerate_iterators);
 
+static void add_elements_individually(benchmark::State& state)
+{
+  const auto count = static_cast<int32_t>(state.range(0));
+  std::vector<thh::handle_t> handles(count);
+  for ([[maybe_unused]] auto _ : state) {
+    thh::handle_vector_t<int> handle_vector;
+    for (int32_t i = 0; i < count; ++i) {
+      handles[i] = handle_vector.add();
+    }
+    benchmark::DoNotOptimize(handles.data());
+    benchmark::ClobberMemory();
+  }
+}
+
+BENCHMARK(add_elements_individually)->Range(64, 64 << 10);
+
+static void add_elements_batched(benchmark::State& state)
+{
+  const auto count = static_cast<int32_t>(state.range(0));
+  std::vector<thh::handle_t> handles(count);
+  for ([[maybe_unused]] auto _ : state) {
+    thh::handle_vector_t<int> handle_vector;
+    handle_vector.add_n(count, handles.begin());
+    benchmark::DoNotOptimize(handles.data());
+    benchmark::ClobberMemory();
+  }
+}
+
+BENCHMARK(add_elements_batched)->Range(64, 64 << 10);
+
+static void remove_elements_individually(benchmark::State& state)
+{
+  const auto count = static_cast<int32_t>(state.range(0));
+  thh::handle_vector_t<int> handle_vector;
+  std::vector<thh::handle_t> handles(count);
+  for ([[maybe_unused]] auto _ : state) {
+    state.PauseTiming();
+    handle_vector.add_n(count, handles.begin());
+    std::shuffle(handles.begin(), handles.end(), std::mt19937(1));
+    state.ResumeTiming();
+    for (const auto handle : handles) {
+      handle_vector.remove(handle);
+    }
+    benchmark::ClobberMemory();
+  }
+}
+
+BENCHMARK(remove_elements_individually)->Range(64, 64 << 10);
+
+static void remove_elements_batched(benchmark::State& state)
+{
+  const auto count = static_cast<int32_t>(state.range(0));
+  thh::handle_vector_t<int> handle_vector;
+  std::vector<thh::handle_t> handles(count);
+  for ([[maybe_unused]] auto _ : state) {
+    state.PauseTiming();
+    handle_vector.add_n(count, handles.begin());
+    std::shuffle(handles.begin(), handles.end(), std::mt19937(1));
+    state.ResumeTiming();
+    handle_vector.remove(handles.begin(), handles.end());
+    benchmark::ClobberMemory();
+  }
+}
+
+BENCHMARK(remove_elements_batched)->Range(64, 64 << 10);
+
+static void enumerate_resolve_shuffled(benchmark::State& state)
+{
+  const auto count = static_cast<int32_t>(state.range(0));
+  thh::handle_vector_t<int> handle_vector;
+  std::vector<thh::handle_t> handles(count);
+  handle_vector.add_n(count, handles.begin());
+  std::shuffle(handles.begin(), handles.end(), std::mt19937(1));
+  for ([[maybe_unused]] auto _ : state) {
+    for (const auto handle : handles) {
+      handle_vector.call(handle, [](auto& element) {
+        element++;
+        benchmark::ClobberMemory();
+      });
+    }
+  }
+}
+
+BENCHMARK(enumerate_resolve_shuffled)->Range(1 << 10, 1 << 20);
+
+static void enumerate_resolve_many_shuffled(benchmark::State& state)
+{
+  const auto count = static_cast<int32_t>(state.range(0));
+  thh::handle_vector_t<int> handle_vector;
+  std::vector<thh::handle_t> handles(count);
+  handle_vector.add_n(count, handles.begin());
+  std::shuffle(handles.begin(), handles.end(), std::mt19937(1));
+  std::vector<int*> elements(count);
+  for ([[maybe_unused]] auto _ : state) {
+    handle_vector.resolve_many(handles.data(), count, elements.data());
+    for (int* element : elements) {
+      if (element != nullptr) {
+        (*element)++;
+        benchmark::ClobberMemory();
+      }
+    }
+  }
+}
+
+BENCHMARK(enumerate_resolve_many_shuffled)->Range(1 << 10, 1 << 20);
+
+struct particle_t
+{
+  float position_[3] = {};
+  float velocity_[3] = {};
+  float payload_[44] = {};
+};
+
+static void update_positions_aos(benchmark::State& state)
+{
+  const auto count = static_cast<int32_t>(state.range(0));
+  thh::handle_vector_t<particle_t> handle_vector;
+  std::vector<thh::handle_t> handles(count);
+  handle_vector.add_n(count, handles.begin());
+  for ([[maybe_unused]] auto _ : state) {
+    for (auto& particle : handle_vector) {
+      particle.position_[0] += particle.velocity_[0];
+    }
+    benchmark::ClobberMemory();
+  }
+}
+
+BENCHMARK(update_positions_aos)->Range(1 << 10, 1 << 20);
+
+static void update_positions_soa(benchmark::State& state)
+{
+  const auto count = static_cast<int32_t>(state.range(0));
+  thh::handle_soa_vector_t<
+    thh::default_tag_t, int32_t, int32_t, float, float,
+    std::array<float, 48>>
+    handle_soa_vector;
+  for (int32_t i = 0; i < count; ++i) {
+    [[maybe_unused]] const auto handle = handle_soa_vector.add();
+  }
+  for ([[maybe_unused]] auto _ : state) {
+    const auto positions = handle_soa_vector.column<0>();
+    const auto velocities = handle_soa_vector.column<1>();
+    for (int32_t i = 0; i < positions.size(); ++i) {
+      positions[i] += velocities[i];
+    }
+    benchmark::ClobberMemory();
+  }
+}
+
+BENCHMARK(update_positions_soa)->Range(1 << 10, 1 << 20);
+
+// updates every element (compare against parallel_for_each)
+static void update_elements_serial(benchmark::State& state)
+{
+  const auto count = static_cast<int32_t>(state.range(0));
+  thh::handle_vector_t<particle_t> handle_vector;
+  std::vector<thh::handle_t> handles(count);
+  handle_vector.add_n(count, handles.begin());
+  for ([[maybe_unused]] auto _ : state) {
+    for (auto& particle : handle_vector) {
+      for (int i = 0; i < 3; ++i) {
+        particle.velocity_[i] += 0.1f;
+        particle.position_[i] += particle.velocity_[i] * 0.016f;
+      }
+    }
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+}
+
+BENCHMARK(update_elements_serial)->Range(1 << 10, 1 << 20);
+
+enum class items_e
+{
+  handle_from_index,
+  items,
+  item_chunks
+};
+
+// visits every element along with its handle
+template<items_e Items>
+static void iterate_with_handles(benchmark::State& state)
+{
+  const auto count = static_cast<int32_t>(state.range(0));
+  thh::handle_vector_t<int32_t> handle_vector;
+  std::vector<thh::handle_t> handles(count);
+  handle_vector.add_n(count, handles.begin(), 1);
+  for ([[maybe_unused]] auto _ : state) {
+    int64_t sum = 0;
+    if constexpr (Items == items_e::handle_from_index) {
+      for (int32_t i = 0; i < handle_vector.size(); ++i) {
+        sum += handle_vector.handle_from_index(i).gen_ + handle_vector[i];
+      }
+    } else if constexpr (Items == items_e::items) {
+      for (const auto [handle, element] : handle_vector.items()) {
+        sum += handle.gen_ + element;
+      }
+    } else {
+      handle_vector.for_each_item_chunk(
+        [&sum](
+          const thh::handle_t* chunk_handles, const int32_t* elements,
+          const int32_t chunk_count) {
+          for (int32_t i = 0; i < chunk_count; ++i) {
+            sum += chunk_handles[i].gen_ + elements[i];
+          }
+        });
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+}
+
+BENCHMARK_TEMPLATE(iterate_with_handles, items_e::handle_from_index)
+  ->Range(1 << 10, 1 << 20);
+BENCHMARK_TEMPLATE(iterate_with_handles, items_e::items)
+  ->Range(1 << 10, 1 << 20);
+BENCHMARK_TEMPLATE(iterate_with_handles, items_e::item_chunks)
+  ->Range(1 << 10, 1 << 20);
+
+// modifies a small fraction of elements each frame and then visits the
+// changed elements (by scanning everything or only those that are dirty)
+template<bool Tracked>
+static void flush_changes(benchmark::State& state)
+{
+  const auto count = static_cast<int32_t>(state.range(0));
+  const auto changed = std::max(count / 100, 1);
+  thh::handle_vector_t<particle_t> handle_vector;
+  std::vector<thh::handle_t> handles(count);
+  handle_vector.add_n(count, handles.begin());
+  std::shuffle(handles.begin(), handles.end(), std::mt19937(1));
+  handle_vector.track_changes(Tracked);
+  size_t next = 0;
+  for ([[maybe_unused]] auto _ : state) {
+    for (int32_t i = 0; i < changed; ++i) {
+      const auto handle = handles[next++ % handles.size()];
+      handle_vector.call(
+        handle, [](particle_t& particle) { particle.position_[0] += 1.0f; });
+    }
+    float sum = 0.0f;
+    if constexpr (Tracked) {
+      handle_vector.for_each_dirty(
+        [&sum](thh::handle_t, const particle_t& particle) {
+          sum += particle.position_[0];
+        });
+      handle_vector.clear_dirty();
+    } else {
+      std::as_const(handle_vector).for_each([&sum](const particle_t& particle) {
+        sum += particle.position_[0];
+      });
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * changed);
+}
+
+BENCHMARK_TEMPLATE(flush_changes, false)->Range(1 << 10, 1 << 20);
+BENCHMARK_TEMPLATE(flush_changes, true)->Range(1 << 10, 1 << 20);
+
+// applies velocities to positions for entities that have both, positions and
+// velocities are either separate containers (with the handle of the position
+// stored alongside each velocity) or storages sharing a registry
+template<bool Registry>
+static void integrate_components(benchmark::State& state)
+{
+  const auto count = static_cast<int32_t>(state.range(0));
+  struct velocity_t
+  {
+    thh::handle_t position_handle_;
+    float velocity_[3] = {1.0f, 2.0f, 3.0f};
+  };
+  struct position_t
+  {
+    float position_[3] = {};
+  };
+  const auto integrate = [](position_t& position, const float* velocity) {
+    for (int i = 0; i < 3; ++i) {
+      position.position_[i] += velocity[i] * 0.016f;
+    }
+  };
+
+  if constexpr (Registry) {
+    thh::handle_registry_t<> registry;
+    thh::handle_storage_t<position_t> positions(registry);
+    thh::handle_storage_t<velocity_t> velocities(registry);
+    for (int32_t i = 0; i < count; ++i) {
+      const auto entity = registry.create();
+      positions.add(entity);
+      if (i % 2 == 0) {
+        velocities.add(entity);
+      }
+    }
+    for ([[maybe_unused]] auto _ : state) {
+      velocities.for_each(
+        [&](const thh::handle_t entity, const velocity_t& velocity) {
+          positions.call(entity, [&](position_t& position) {
+            integrate(position, velocity.velocity_);
+          });
+        });
+      benchmark::ClobberMemory();
+    }
+  } else {
+    thh::handle_vector_t<position_t> positions;
+    thh::handle_vector_t<velocity_t> velocities;
+    for (int32_t i = 0; i < count; ++i) {
+      const auto position_handle = positions.add();
+      if (i % 2 == 0) {
+        [[maybe_unused]] const auto velocity_handle =
+          velocities.add(velocity_t{position_handle});
+      }
+    }
+    for ([[maybe_unused]] auto _ : state) {
+      velocities.for_each([&](const velocity_t& velocity) {
+        positions.call(velocity.position_handle_, [&](position_t& position) {
+          integrate(position, velocity.velocity_);
+        });
+      });
+      benchmark::ClobberMemory();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * (count / 2));
+}
+
+BENCHMARK_TEMPLATE(integrate_components, false)->Range(1 << 10, 1 << 20);
+BENCHMARK_TEMPLATE(integrate_components, true)->Range(1 << 10, 1 << 20);
+
+enum class join_e
+{
+  storage_calls,
+  storage_join,
+  keyed_calls,
+  keyed_join
+};
+
+// integrates positions by velocities (every other position has a velocity)
+// where velocities refer to positions in a shuffled order, looking each
+// position up with call or resolving them a block at a time with join
+template<join_e Join>
+static void join_components(benchmark::State& state)
+{
+  const auto count = static_cast<int32_t>(state.range(0));
+  struct velocity_t
+  {
+    thh::handle_t position_handle_;
+    float velocity_[3] = {1.0f, 2.0f, 3.0f};
+  };
+  struct position_t
+  {
+    float position_[3] = {};
+  };
+  const auto integrate = [](position_t& position, const float* velocity) {
+    for (int i = 0; i < 3; ++i) {
+      position.position_[i] += velocity[i] * 0.016f;
+    }
+  };
+
+  std::vector<int32_t> order(count);
+  std::iota(order.begin(), order.end(), 0);
+  std::shuffle(order.begin(), order.end(), std::mt19937(42));
+
+  if constexpr (Join == join_e::storage_calls || Join == join_e::storage_join) {
+    thh::handle_registry_t<> registry;
+    thh::handle_storage_t<position_t> positions(registry);
+    thh::handle_storage_t<velocity_t> velocities(registry);
+    std::vector<thh::handle_t> entities(count);
+    for (auto& entity : entities) {
+      entity = registry.create();
+    }
+    for (const auto i : order) {
+      positions.add(entities[i]);
+    }
+    for (int32_t i = 0; i < count; i += 2) {
+      velocities.add(entities[i]);
+    }
+    for ([[maybe_unused]] auto _ : state) {
+      if constexpr (Join == join_e::storage_calls) {
+        velocities.for_each(
+          [&](const thh::handle_t entity, const velocity_t& velocity) {
+            positions.call(entity, [&](position_t& position) {
+              integrate(position, velocity.velocity_);
+            });
+          });
+      } else {
+        thh::join(positions, velocities)
+          .for_each([&](thh::handle_t, position_t& position,
+                        const velocity_t& velocity) {
+            integrate(position, velocity.velocity_);
+          });
+      }
+      benchmark::ClobberMemory();
+    }
+  } else {
+    thh::handle_vector_t<position_t> positions;
+    thh::handle_vector_t<velocity_t> velocities;
+    std::vector<thh::handle_t> position_handles(count);
+    positions.add_n(count, position_handles.begin());
+    for (int32_t i = 0; i < count; i += 2) {
+      [[maybe_unused]] const auto velocity_handle =
+        velocities.add(velocity_t{position_handles[order[i]]});
+    }
+    for ([[maybe_unused]] auto _ : state) {
+      if constexpr (Join == join_e::keyed_calls) {
+        velocities.for_each([&](const velocity_t& velocity) {
+          positions.call(velocity.position_handle_, [&](position_t& position) {
+            integrate(position, velocity.velocity_);
+          });
+        });
+      } else {
+        thh::join(
+          [](const velocity_t& velocity) { return velocity.position_handle_; },
+          velocities, positions)
+          .for_each([&](thh::handle_t, const velocity_t& velocity,
+                        position_t& position) {
+            integrate(position, velocity.velocity_);
+          });
+      }
+      benchmark::ClobberMemory();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * (count / 2));
+}
+
+BENCHMARK_TEMPLATE(join_components, join_e::storage_calls)
+  ->Range(1 << 10, 1 << 20);
+BENCHMARK_TEMPLATE(join_components, join_e::storage_join)
+  ->Range(1 << 10, 1 << 20);
+BENCHMARK_TEMPLATE(join_components, join_e::keyed_calls)
+  ->Range(1 << 10, 1 << 20);
+BENCHMARK_TEMPLATE(join_components, join_e::keyed_join)
+  ->Range(1 << 10, 1 << 20);
+
+static void update_elements_parallel(benchmark::State& state)
+{
+  const auto count = static_cast<int32_t>(state.range(0));
+  const thh::parallel_t parallel{static_cast<int32_t>(state.range(1))};
+  thh::handle_vector_t<particle_t> handle_vector;
+  std::vector<thh::handle_t> handles(count);
+  handle_vector.add_n(count, handles.begin());
+  for ([[maybe_unused]] auto _ : state) {
+    handle_vector.parallel_for_each(
+      parallel, [](thh::handle_t, particle_t& particle) {
+        for (int i = 0; i < 3; ++i) {
+          particle.velocity_[i] += 0.1f;
+          particle.position_[i] += particle.velocity_[i] * 0.016f;
+        }
+      });
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+}
+
+BENCHMARK(update_elements_parallel)
+  ->ArgsProduct({{1 << 10, 1 << 15, 1 << 20}, {1, 2, 4, 8}})
+  ->UseRealTime();
+
+static void sum_elements_parallel(benchmark::State& state)
+{
+  const auto count = static_cast<int32_t>(state.range(0));
+  const thh::parallel_t parallel{static_cast<int32_t>(state.range(1))};
+  thh::handle_vector_t<particle_t> handle_vector;
+  std::vector<thh::handle_t> handles(count);
+  handle_vector.add_n(count, handles.begin());
+  for ([[maybe_unused]] auto _ : state) {
+    benchmark::DoNotOptimize(handle_vector.parallel_transform_reduce(
+      parallel, 0.0f, std::plus<>(),
+      [](thh::handle_t, const particle_t& particle) {
+        return particle.position_[0];
+      }));
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+}
+
+BENCHMARK(sum_elements_parallel)
+  ->ArgsProduct({{1 << 10, 1 << 15, 1 << 20}, {1, 2, 4, 8}})
+  ->UseRealTime();
+
+static void build_and_destroy_per_frame(benchmark::State& state)
+{
+  const auto count = static_cast<int32_t>(state.range(0));
+  std::vector<thh::handle_t> handles(count);
+  for ([[maybe_unused]] auto _ : state) {
+    for (int container = 0; container < 100; ++container) {
+      thh::handle_vector_t<int> handle_vector;
+      for (int32_t i = 0; i < count; ++i) {
+        handles[i] = handle_vector.add(i);
+      }
+      benchmark::DoNotOptimize(handle_vector.data());
+    }
+    benchmark::ClobberMemory();
+  }
+}
+
+BENCHMARK(build_and_destroy_per_frame)->Range(8, 512);
+
+static void build_and_destroy_per_frame_pmr(benchmark::State& state)
+{
+  const auto count = static_cast<int32_t>(state.range(0));
+  std::vector<thh::handle_t> handles(count);
+  std::vector<std::byte> arena(1 << 22);
+  for ([[maybe_unused]] auto _ : state) {
+    std::pmr::monotonic_buffer_resource resource(arena.data(), arena.size());
+    for (int container = 0; container < 100; ++container) {
+      thh::pmr::handle_vector_t<int> handle_vector(&resource);
+      for (int32_t i = 0; i < count; ++i) {
+        handles[i] = handle_vector.add(i);
+      }
+      benchmark::DoNotOptimize(handle_vector.data());
+    }
+    benchmark::ClobberMemory();
+  }
+}
+
+BENCHMARK(build_and_destroy_per_frame_pmr)->Range(8, 512);
+
+static void add_remove_churn(benchmark::State& state)
+{
+  thh::handle_vector_t<int> handle_vector;
+  thh::handle_t handles[256];
+  for ([[maybe_unused]] auto _ : state) {
+    for (auto& handle : handles) {
+      handle = handle_vector.add();
+    }
+    for (const auto handle : handles) {
+      handle_vector.remove(handle);
+    }
+    benchmark::ClobberMemory();
+  }
+}
+
+BENCHMARK(add_remove_churn);
+
+static void add_remove_churn_static(benchmark::State& state)
+{
+  thh::static_handle_vector_t<int, 256> handle_vector;
+  thh::static_handle_vector_t<int, 256>::handle_type handles[256];
+  for ([[maybe_unused]] auto _ : state) {
+    for (auto& handle : handles) {
+      handle = handle_vector.add();
+    }
+    for (const auto handle : handles) {
+      handle_vector.remove(handle);
+    }
+    benchmark::ClobberMemory();
+  }
+}
+
+BENCHMARK(add_remove_churn_static);
+
+static void remove_burst_eager(benchmark::State& state)
+{
+  const auto count = static_cast<int32_t>(state.range(0));
+  thh::handle_vector_t<particle_t> handle_vector;
+  std::vector<thh::handle_t> handles(count);
+  for ([[maybe_unused]] auto _ : state) {
+    state.PauseTiming();
+    handle_vector.clear();
+    handle_vector.add_n(count, handles.begin());
+    std::shuffle(handles.begin(), handles.end(), std::mt19937(1));
+    state.ResumeTiming();
+    // remove a quarter of the elements and then update the rest
+    for (int32_t i = 0; i < count / 4; ++i) {
+      handle_vector.remove(handles[i]);
+    }
+    for (auto& particle : handle_vector) {
+      particle.position_[0] += particle.velocity_[0];
+    }
+    benchmark::ClobberMemory();
+  }
+}
+
+BENCHMARK(remove_burst_eager)->Range(1 << 10, 1 << 18);
+
+static void remove_burst_deferred(benchmark::State& state)
+{
+  const auto count = static_cast<int32_t>(state.range(0));
+  thh::handle_vector_t<particle_t> handle_vector;
+  std::vector<thh::handle_t> handles(count);
+  for ([[maybe_unused]] auto _ : state) {
+    state.PauseTiming();
+    handle_vector.clear();
+    handle_vector.add_n(count, handles.begin());
+    std::shuffle(handles.begin(), handles.end(), std::mt19937(1));
+    state.ResumeTiming();
+    for (int32_t i = 0; i < count / 4; ++i) {
+      handle_vector.remove_deferred(handles[i]);
+    }
+    handle_vector.for_each([](particle_t& particle) {
+      particle.position_[0] += particle.velocity_[0];
+    });
+    handle_vector.compact();
+    benchmark::ClobberMemory();
+  }
+}
+
+BENCHMARK(remove_burst_deferred)->Range(1 << 10, 1 << 18);
+
+static void remove_and_resort(benchmark::State& state)
+{
+  const auto count = static_cast<int32_t>(state.range(0));
+  thh::handle_vector_t<int> handle_vector;
+  std::vector<thh::handle_t> handles(count);
+  for ([[maybe_unused]] auto _ : state) {
+    state.PauseTiming();
+    handle_vector.clear();
+    for (int32_t i = 0; i < count; ++i) {
+      handles[i] = handle_vector.add(i);
+    }
+    std::shuffle(handles.begin(), handles.end(), std::mt19937(1));
+    state.ResumeTiming();
+    // remove 1% of elements and restore the sorted order
+    handle_vector.remove(handles.begin(), handles.begin() + count / 100);
+    handle_vector.sort([&handle_vector](const int32_t lhs, const int32_t rhs) {
+      return handle_vector[lhs] < handle_vector[rhs];
+    });
+    benchmark::ClobberMemory();
+  }
+}
+
+BENCHMARK(remove_and_resort)->Range(1 << 10, 1 << 18);
+
+static void erase_stable_sorted(benchmark::State& state)
+{
+  const auto count = static_cast<int32_t>(state.range(0));
+  thh::handle_vector_t<int> handle_vector;
+  std::vector<thh::handle_t> handles(count);
+  for ([[maybe_unused]] auto _ : state) {
+    state.PauseTiming();
+    handle_vector.clear();
+    for (int32_t i = 0; i < count; ++i) {
+      handles[i] = handle_vector.add(i);
+    }
+    std::shuffle(handles.begin(), handles.end(), std::mt19937(1));
+    state.ResumeTiming();
+    handle_vector.erase_stable(handles.begin(), handles.begin() + count / 100);
+    benchmark::ClobberMemory();
+  }
+}
+
+BENCHMARK(erase_stable_sorted)->Range(1 << 10, 1 << 18);
+
+// sorts shuffled elements using the given number of threads (0 is the serial
+// sort for comparison)
+static void sort_parallel(benchmark::State& state)
+{
+  const auto count = static_cast<int32_t>(state.range(0));
+  const auto thread_count = static_cast<int32_t>(state.range(1));
+  std::vector<int32_t> values(count);
+  std::iota(values.begin(), values.end(), 0);
+  std::shuffle(values.begin(), values.end(), std::mt19937(42));
+  for ([[maybe_unused]] auto _ : state) {
+    state.PauseTiming();
+    thh::handle_vector_t<int32_t> handle_vector;
+    std::vector<thh::handle_t> handles(count);
+    handle_vector.add_n(count, handles.begin());
+    std::copy(values.begin(), values.end(), handle_vector.begin());
+    state.ResumeTiming();
+    const auto compare = [&handle_vector](
+                           const int32_t lhs, const int32_t rhs) {
+      return handle_vector[lhs] < handle_vector[rhs];
+    };
+    if (thread_count == 0) {
+      handle_vector.sort(compare);
+    } else {
+      handle_vector.sort(thh::parallel_t{thread_count}, compare);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+}
+
+BENCHMARK(sort_parallel)
+  ->ArgsProduct({{1 << 16, 1 << 20, 5000000}, {0, 1, 2, 4, 8}})
+  ->Unit(benchmark::kMillisecond)
+  ->UseRealTime();
+
+// restores shuffled values to the container before each iteration and then
+// reorders it with reorder(handle_vector)
+template<typename Reorder>
+static void reorder_shuffled(benchmark::State& state, Reorder reorder)
+{
+  const auto count = static_cast<int32_t>(state.range(0));
+  std::vector<int32_t> values(count);
+  std::iota(values.begin(), values.end(), 0);
+  std::shuffle(values.begin(), values.end(), std::mt19937(42));
+  thh::handle_vector_t<int32_t> handle_vector;
+  std::vector<thh::handle_t> handles(count);
+  handle_vector.add_n(count, handles.begin());
+  for ([[maybe_unused]] auto _ : state) {
+    state.PauseTiming();
+    std::copy(values.begin(), values.end(), handle_vector.begin());
+    state.ResumeTiming();
+    reorder(handle_vector);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+}
+
+static void sort_shuffled(benchmark::State& state)
+{
+  reorder_shuffled(state, [](thh::handle_vector_t<int32_t>& handle_vector) {
+    handle_vector.sort([&handle_vector](const int32_t lhs, const int32_t rhs) {
+      return handle_vector[lhs] < handle_vector[rhs];
+    });
+  });
+}
+
+BENCHMARK(sort_shuffled)->Range(1 << 10, 1 << 20);
+
+static void sort_elements_shuffled(benchmark::State& state)
+{
+  reorder_shuffled(state, [](thh::handle_vector_t<int32_t>& handle_vector) {
+    handle_vector.sort_elements(std::less<>());
+  });
+}
+
+BENCHMARK(sort_elements_shuffled)->Range(1 << 10, 1 << 20);
+
+static void sort_by_key_shuffled(benchmark::State& state)
+{
+  reorder_shuffled(state, [](thh::handle_vector_t<int32_t>& handle_vector) {
+    handle_vector.sort_by_key([](const int32_t value) { return value; });
+  });
+}
+
+BENCHMARK(sort_by_key_shuffled)->Range(1 << 10, 1 << 20);
+
+static void partition_shuffled(benchmark::State& state)
+{
+  reorder_shuffled(state, [](thh::handle_vector_t<int32_t>& handle_vector) {
+    const auto half = handle_vector.size() / 2;
+    handle_vector.partition([&handle_vector, half](const int32_t index) {
+      return handle_vector[index] < half;
+    });
+  });
+}
+
+BENCHMARK(partition_shuffled)->Range(1 << 10, 1 << 20);
+
+enum class select_e
+{
+  sort,
+  partial_sort,
+  nth_element
+};
+
+// moves the nearest 1% of elements to the front of the container
+template<select_e Select>
+static void select_nearest(benchmark::State& state)
+{
+  reorder_shuffled(state, [](thh::handle_vector_t<int32_t>& handle_vector) {
+    const auto compare = [&handle_vector](
+                           const int32_t lhs, const int32_t rhs) {
+      return handle_vector[lhs] < handle_vector[rhs];
+    };
+    const auto nearest = handle_vector.size() / 100;
+    if constexpr (Select == select_e::sort) {
+      handle_vector.sort(compare);
+    } else if constexpr (Select == select_e::partial_sort) {
+      handle_vector.partial_sort(nearest, compare);
+    } else {
+      handle_vector.nth_element(nearest, compare);
+    }
+  });
+}
+
+BENCHMARK_TEMPLATE(select_nearest, select_e::sort)->Range(1 << 10, 1 << 20);
+BENCHMARK_TEMPLATE(select_nearest, select_e::partial_sort)
+  ->Range(1 << 10, 1 << 20);
+BENCHMARK_TEMPLATE(select_nearest, select_e::nth_element)
+  ->Range(1 << 10, 1 << 20);
+
+// re-sorts elements after nudging 1% of them a few positions (as happens when
+// sorting by distance each frame)
+template<bool Incremental>
+static void resort_after_frame(benchmark::State& state)
+{
+  const auto count = static_cast<int32_t>(state.range(0));
+  thh::handle_vector_t<int32_t> handle_vector;
+  std::vector<thh::handle_t> handles(count);
+  handle_vector.add_n(count, handles.begin());
+  for (int32_t i = 0; i < count; ++i) {
+    handle_vector[i] = i * 16;
+  }
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<int32_t> position(0, count - 1);
+  std::uniform_int_distribution<int32_t> nudge(-48, 48);
+  const auto compare = [&handle_vector](const int32_t lhs, const int32_t rhs) {
+    return handle_vector[lhs] < handle_vector[rhs];
+  };
+  for ([[maybe_unused]] auto _ : state) {
+    state.PauseTiming();
+    for (int32_t i = 0; i < count / 100; ++i) {
+      handle_vector[position(gen)] += nudge(gen);
+    }
+    state.ResumeTiming();
+    if constexpr (Incremental) {
+      handle_vector.incremental_sort(compare);
+    } else {
+      handle_vector.sort(compare);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+}
+
+BENCHMARK_TEMPLATE(resort_after_frame, false)->Range(1 << 10, 1 << 20);
+BENCHMARK_TEMPLATE(resort_after_frame, true)->Range(1 << 10, 1 << 20);
+
+static void save_container(benchmark::State& state)
+{
+  const auto count = static_cast<int32_t>(state.range(0));
+  thh::handle_vector_t<particle_t> handle_vector;
+  std::vector<thh::handle_t> handles(count);
+  handle_vector.add_n(count, handles.begin());
+  std::stringstream stream;
+  for ([[maybe_unused]] auto _ : state) {
+    stream.seekp(0);
+    handle_vector.save(stream);
+    benchmark::ClobberMemory();
+  }
+  state.SetBytesProcessed(
+    state.iterations() * static_cast<int64_t>(stream.tellp()));
+}
+
+BENCHMARK(save_container)->Range(1 << 10, 1 << 18);
+
+static void load_container(benchmark::State& state)
+{
+  const auto count = static_cast<int32_t>(state.range(0));
+  thh::handle_vector_t<particle_t> handle_vector;
+  std::vector<thh::handle_t> handles(count);
+  handle_vector.add_n(count, handles.begin());
+  std::stringstream stream;
+  handle_vector.save(stream);
+  thh::handle_vector_t<particle_t> loaded;
+  for ([[maybe_unused]] auto _ : state) {
+    stream.seekg(0);
+    const bool success = loaded.load(stream);
+    benchmark::DoNotOptimize(success);
+    benchmark::ClobberMemory();
+  }
+  state.SetBytesProcessed(
+    state.iterations() * static_cast<int64_t>(stream.str().size()));
+}
+
+BENCHMARK(load_container)->Range(1 << 10, 1 << 18);
+
+// adds count elements to an empty container and reports the slowest add
+template<typename HandleVector>
+static void add_elements_worst_case(benchmark::State& state)
+{
+  const auto count = static_cast<int32_t>(state.range(0));
+  int64_t slowest_add_ns = 0;
+  for ([[maybe_unused]] auto _ : state) {
+    HandleVector handle_vector;
+    for (int32_t i = 0; i < count; ++i) {
+      const auto before = std::chrono::steady_clock::now();
+      const auto handle = handle_vector.add();
+      const auto after = std::chrono::steady_clock::now();
+      benchmark::DoNotOptimize(handle);
+      slowest_add_ns = std::max<int64_t>(
+        slowest_add_ns,
+        std::chrono::duration_cast<std::chrono::nanoseconds>(after - before)
+          .count());
+    }
+  }
+  state.counters["slowest_add_ns"] = static_cast<double>(slowest_add_ns);
+}
+
+BENCHMARK_TEMPLATE(add_elements_worst_case, thh::handle_vector_t<particle_t>)
+  ->Range(1 << 10, 1 << 20);
+BENCHMARK_TEMPLATE(
+  add_elements_worst_case, thh::chunked_handle_vector_t<particle_t>)
+  ->Range(1 << 10, 1 << 20);
+
+static void iterate_elements_chunked(benchmark::State& state)
+{
+  const auto count = static_cast<int32_t>(state.range(0));
+  thh::chunked_handle_vector_t<particle_t> handle_vector;
+  for (int32_t i = 0; i < count; ++i) {
+    [[maybe_unused]] const auto handle = handle_vector.add();
+  }
+  for ([[maybe_unused]] auto _ : state) {
+    handle_vector.for_each_chunk([](particle_t* particles, const int32_t size) {
+      for (int32_t i = 0; i < size; ++i) {
+        for (int axis = 0; axis < 3; ++axis) {
+          particles[i].position_[axis] += particles[i].velocity_[axis];
+        }
+      }
+    });
+    benchmark::ClobberMemory();
+  }
+}
+
+BENCHMARK(iterate_elements_chunked)->Range(1 << 10, 1 << 20);
+
+static void iterate_elements_vector(benchmark::State& state)
+{
+  const auto count = static_cast<int32_t>(state.range(0));
+  thh::handle_vector_t<particle_t> handle_vector;
+  for (int32_t i = 0; i < count; ++i) {
+    [[maybe_unused]] const auto handle = handle_vector.add();
+  }
+  for ([[maybe_unused]] auto _ : state) {
+    for (auto& particle : handle_vector) {
+      for (int axis = 0; axis < 3; ++axis) {
+        particle.position_[axis] += particle.velocity_[axis];
+      }
+    }
+    benchmark::ClobberMemory();
+  }
+}
+
+BENCHMARK(iterate_elements_vector)->Range(1 << 10, 1 << 20);
+
+// fills a container, removes all but 1% of the elements and then shrinks it
+static void shrink_after_spike(benchmark::State& state)
+{
+  const auto count = static_cast<int32_t>(state.range(0));
+  thh::memory_usage_t before;
+  thh::memory_usage_t after;
+  for ([[maybe_unused]] auto _ : state) {
+    state.PauseTiming();
+    thh::handle_vector_t<particle_t> handle_vector;
+    std::vector<thh::handle_t> handles(count);
+    handle_vector.add_n(count, handles.begin());
+    handle_vector.remove(handles.begin() + count / 100, handles.end());
+    before = handle_vector.memory_usage();
+    state.ResumeTiming();
+    handle_vector.shrink_to_fit();
+    after = handle_vector.memory_usage();
+  }
+  state.counters["bytes_before"] = static_cast<double>(before.total_bytes());
+  state.counters["bytes_after"] = static_cast<double>(after.total_bytes());
+}
+
+BENCHMARK(shrink_after_spike)->Range(1 << 10, 1 << 20);
+
+// looks up handles in random order (the internal handle for each one is
+// unlikely to be in cache for large containers)
+static void resolve_random_handles(benchmark::State& state)
+{
+  const auto count = static_cast<int32_t>(state.range(0));
+  thh::handle_vector_t<int> handle_vector;
+  std::vector<thh::handle_t> handles(count);
+  handle_vector.add_n(count, handles.begin(), 1);
+  std::shuffle(handles.begin(), handles.end(), std::mt19937(42));
+  for ([[maybe_unused]] auto _ : state) {
+    int64_t sum = 0;
+    for (const auto handle : handles) {
+      handle_vector.call(handle, [&sum](const int value) { sum += value; });
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+}
+
+BENCHMARK(resolve_random_handles)->RangeMultiplier(10)->Range(10000, 10000000);
+
+// resolves a table of stored handles (several per element, in random order)
+// where each handle is stored as StoredHandle
+template<typename StoredHandle>
+static void resolve_stored_handles(benchmark::State& state)
+{
+  const auto count = static_cast<int32_t>(state.range(0));
+  thh::packed_handle_vector_t<int, thh::default_tag_t, 32, 24> handle_vector;
+  std::vector<StoredHandle> handles;
+  for (int32_t i = 0; i < count; ++i) {
+    const StoredHandle handle = handle_vector.add(i);
+    handles.insert(handles.end(), 4, handle);
+  }
+  std::shuffle(handles.begin(), handles.end(), std::mt19937(42));
+  for ([[maybe_unused]] auto _ : state) {
+    int64_t sum = 0;
+    for (const auto handle : handles) {
+      handle_vector.call(handle, [&sum](const int value) { sum += value; });
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.counters["handle_bytes"] =
+    static_cast<double>(handles.size() * sizeof(StoredHandle));
+}
+
+BENCHMARK_TEMPLATE(
+  resolve_stored_handles,
+  thh::packed_handle_t<thh::default_tag_t, 32, 24>::typed_handle_type)
+  ->Range(1 << 10, 1 << 20);
+BENCHMARK_TEMPLATE(
+  resolve_stored_handles, thh::packed_handle_t<thh::default_tag_t, 32, 24>)
+  ->Range(1 << 10, 1 << 20);
+
+#if __has_include(<sys/mman.h>)
+#include <sys/resource.h>
+
+// number of minor page faults taken by the process so far
+static int64_t minor_page_faults()
+{
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_minflt;
+}
+
+static void reopen_and_iterate_loaded(benchmark::State& state)
+{
+  const auto count = static_cast<int32_t>(state.range(0));
+  std::stringstream stream;
+  {
+    thh::handle_vector_t<particle_t> handle_vector;
+    std::vector<thh::handle_t> handles(count);
+    handle_vector.add_n(count, handles.begin());
+    handle_vector.save(stream);
+  }
+  const int64_t faults_before = minor_page_faults();
+  for ([[maybe_unused]] auto _ : state) {
+    stream.seekg(0);
+    thh::handle_vector_t<particle_t> loaded;
+    [[maybe_unused]] const bool success = loaded.load(stream);
+    float sum = 0.0f;
+    for (const auto& particle : loaded) {
+      sum += particle.position_[0];
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.counters["page_faults"] = benchmark::Counter(
+    static_cast<double>(minor_page_faults() - faults_before),
+    benchmark::Counter::kAvgIterations);
+}
+
+BENCHMARK(reopen_and_iterate_loaded)->Range(1 << 10, 1 << 20);
+
+static void reopen_and_iterate_mapped(benchmark::State& state)
+{
+  const auto count = static_cast<int32_t>(state.range(0));
+  const std::string path =
+    (std::filesystem::temp_directory_path() / "thh-mapped-bench").string();
+  {
+    auto handle_vector = thh::mapped_handle_vector_t<particle_t>::open(path);
+    handle_vector->clear();
+    handle_vector->reserve(count);
+    for (int32_t i = 0; i < count; ++i) {
+      [[maybe_unused]] const auto handle = handle_vector->add();
+    }
+  }
+  const int64_t faults_before = minor_page_faults();
+  for ([[maybe_unused]] auto _ : state) {
+    auto handle_vector = thh::mapped_handle_vector_t<particle_t>::open(path);
+    float sum = 0.0f;
+    for (const auto& particle : *handle_vector) {
+      sum += particle.position_[0];
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.counters["page_faults"] = benchmark::Counter(
+    static_cast<double>(minor_page_faults() - faults_before),
+    benchmark::Counter::kAvgIterations);
+  for (const char* suffix : {".handles", ".ids", ".elements"}) {
+    std::filesystem::remove(path + suffix);
+  }
+}
+
+BENCHMARK(reopen_and_iterate_mapped)->Range(1 << 10, 1 << 20);
+#endif
+
+static void add_call_remove_mutex(benchmark::State& state)
+{
+  static std::mutex mutex;
+  static thh::handle_vector_t<int> handle_vector;
+  for ([[maybe_unused]] auto _ : state) {
+    thh::handle_t handle;
+    {
+      std::lock_guard lock(mutex);
+      handle = handle_vector.add();
+    }
+    {
+      std::lock_guard lock(mutex);
+      handle_vector.call(handle, [](auto& element) { element++; });
+    }
+    {
+      std::lock_guard lock(mutex);
+      handle_vector.remove(handle);
+    }
+  }
+}
+
+BENCHMARK(add_call_remove_mutex)->ThreadRange(1, 16)->UseRealTime();
+
+static void add_call_remove_concurrent(benchmark::State& state)
+{
+  static thh::concurrent_handle_vector_t<int> handle_vector(16);
+  for ([[maybe_unused]] auto _ : state) {
+    const thh::handle_t handle = handle_vector.add();
+    handle_vector.call(handle, [](auto& element) { element++; });
+    handle_vector.remove(handle);
+  }
+}
+
+BENCHMARK(add_call_remove_concurrent)->ThreadRange(1, 16)->UseRealTime();
+
+static void resolve_shared_lock(benchmark::State& state)
+{
+  static thh::concurrent_handle_vector_t<int> handle_vector;
+  static const auto handles = [] {
+    std::vector<thh::handle_t> handles;
+    for (int i = 0; i < 1024; ++i) {
+      handles.push_back(handle_vector.add(i));
+    }
+    return handles;
+  }();
+  const auto& readable = std::as_const(handle_vector);
+  for ([[maybe_unused]] auto _ : state) {
+    for (const auto handle : handles) {
+      readable.call(
+        handle, [](const int element) { benchmark::DoNotOptimize(element); });
+    }
+  }
+}
+
+BENCHMARK(resolve_shared_lock)->ThreadRange(1, 16)->UseRealTime();
+
+static void resolve_epoch(benchmark::State& state)
+{
+  static thh::epoch_handle_vector_t<int> handle_vector;
+  static const auto handles = [] {
+    std::vector<thh::handle_t> handles;
+    for (int i = 0; i < 1024; ++i) {
+      handles.push_back(handle_vector.add(i));
+    }
+    return handles;
+  }();
+  auto reader = handle_vector.register_reader();
+  for ([[maybe_unused]] auto _ : state) {
+    const auto guard = reader->enter();
+    for (const auto handle : handles) {
+      guard.call(
+        handle, [](const int element) { benchmark::DoNotOptimize(element); });
+    }
+  }
+}
+
+BENCHMARK(resolve_epoch)->ThreadRange(1, 16)->UseRealTime();
+
 BENCHMARK_MAIN();
@@ -0,0 +1,303 @@
+#pragma once
+
+#include "handle-vector.hpp"
+
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <new>
+
+namespace thh
+{
+  // storage for type T where elements are kept in fixed size chunks that are
+  // allocated as the container grows but never moved (elements remain tightly
+  // packed across chunks)
+  // note: adding an element never moves existing elements, so pointers
+  // returned by resolve remain valid as the container grows (remove, sort and
+  // partition still move elements as they do in handle_vector_t)
+  // note: ChunkSize is the number of elements per chunk (a power of two)
+  template<
+    typename T, std::size_t ChunkSize = 1024, typename Tag = default_tag_t,
+    typename Index = int32_t, typename Gen = int32_t>
+  class chunked_handle_vector_t
+  {
+    static_assert(
+      ChunkSize > 0 && (ChunkSize & (ChunkSize - 1)) == 0,
+      "ChunkSize must be a power of two.");
+    static_assert(
+      ChunkSize <= static_cast<std::size_t>(std::numeric_limits<Index>::max()),
+      "ChunkSize must be representable by Index.");
+
+    // uninitialized storage for ChunkSize elements
+    struct chunk_t
+    {
+      alignas(T) unsigned char storage_[sizeof(T) * ChunkSize];
+    };
+
+    // backing chunks for elements (only the vector of pointers reallocates)
+    std::vector<std::unique_ptr<chunk_t>> chunks_;
+    // mapping from handles to elements (and elements back to handles)
+    detail::handle_table_t<Tag, Index, Gen> handles_;
+
+    // returns the capacity of all allocated chunks
+    [[nodiscard]] size_t element_capacity() const;
+    // allocates a new chunk if the last chunk is full
+    void try_allocate_chunk();
+    // destroys the elements in the range [first, last)
+    void destroy_elements(Index first, Index last);
+
+  public:
+    // random access iterator over elements (one chunk after another)
+    template<typename V>
+    class iterator_t
+    {
+      const std::unique_ptr<chunk_t>* chunks_ = nullptr;
+      Index position_ = 0;
+
+    public:
+      using iterator_category = std::random_access_iterator_tag;
+      using value_type = std::remove_const_t<V>;
+      using difference_type = std::ptrdiff_t;
+      using pointer = V*;
+      using reference = V&;
+
+      iterator_t() = default;
+      iterator_t(const std::unique_ptr<chunk_t>* chunks, const Index position)
+        : chunks_(chunks), position_(position)
+      {
+      }
+      // allows conversion from iterator to const_iterator
+      template<
+        typename U, typename = std::enable_if_t<std::is_const_v<V>
+                                                && std::is_same_v<const U, V>>>
+      iterator_t(const iterator_t<U>& other)
+        : chunks_(other.chunks_), position_(other.position_)
+      {
+      }
+
+      reference operator*() const
+      {
+        return *std::launder(reinterpret_cast<V*>(
+          chunks_[position_ / Index(ChunkSize)]->storage_
+          + sizeof(T) * (position_ % Index(ChunkSize))));
+      }
+      pointer operator->() const { return &**this; }
+      reference operator[](const difference_type offset) const
+      {
+        return *(*this + offset);
+      }
+      iterator_t& operator++()
+      {
+        ++position_;
+        return *this;
+      }
+      iterator_t operator++(int)
+      {
+        auto it = *this;
+        ++position_;
+        return it;
+      }
+      iterator_t& operator--()
+      {
+        --position_;
+        return *this;
+      }
+      iterator_t operator--(int)
+      {
+        auto it = *this;
+        --position_;
+        return it;
+      }
+      iterator_t& operator+=(const difference_type offset)
+      {
+        position_ = static_cast<Index>(position_ + offset);
+        return *this;
+      }
+      iterator_t& operator-=(const difference_type offset)
+      {
+        position_ = static_cast<Index>(position_ - offset);
+        return *this;
+      }
+      iterator_t operator+(const difference_type offset) const
+      {
+        auto it = *this;
+        return it += offset;
+      }
+      iterator_t operator-(const difference_type offset) const
+      {
+        auto it = *this;
+        return it -= offset;
+      }
+      difference_type operator-(const iterator_t& other) const
+      {
+        return difference_type(position_) - difference_type(other.position_);
+      }
+      bool operator==(const iterator_t& other) const
+      {
+        return position_ == other.position_;
+      }
+      bool operator!=(const iterator_t& other) const
+      {
+        return position_ != other.position_;
+      }
+      bool operator<(const iterator_t& other) const
+      {
+        return position_ < other.position_;
+      }
+      bool operator<=(const iterator_t& other) const
+      {
+        return position_ <= other.position_;
+      }
+      bool operator>(const iterator_t& other) const
+      {
+        return position_ > other.position_;
+      }
+      bool operator>=(const iterator_t& other) const
+      {
+        return position_ >= other.position_;
+      }
+      friend iterator_t operator+(
+        const difference_type offset, const iterator_t& it)
+      {
+        return it + offset;
+      }
+
+      template<typename>
+      friend class iterator_t;
+    };
+
+    using iterator = iterator_t<T>;
+    using const_iterator = iterator_t<const T>;
+    using value_type = T;
+    using reference = T&;
+    using const_reference = const T&;
+
+    chunked_handle_vector_t() = default;
+    chunked_handle_vector_t(chunked_handle_vector_t&& other) noexcept;
+    chunked_handle_vector_t& operator=(
+      chunked_handle_vector_t&& other) noexcept;
+    chunked_handle_vector_t(const chunked_handle_vector_t&) = delete;
+    chunked_handle_vector_t& operator=(const chunked_handle_vector_t&) = delete;
+    ~chunked_handle_vector_t();
+
+    // creates an element T in-place and returns a handle to it
+    // note: args allow arguments to be passed directly to the type constructor
+    // useful if the type does not support a default constructor
+    template<typename... Args>
+    [[nodiscard]] typed_handle_t<Tag, Index, Gen> add(Args&&... args);
+    // returns a mutable pointer to the element referenced by the handle (or
+    // nullptr if the handle is no longer valid)
+    // note: remains valid until the element is moved (by remove, sort or
+    // partition) or removed
+    [[nodiscard]] T* resolve(typed_handle_t<Tag, Index, Gen> handle);
+    // returns a constant pointer to the element referenced by the handle (or
+    // nullptr if the handle is no longer valid)
+    [[nodiscard]] const T* resolve(
+      typed_handle_t<Tag, Index, Gen> handle) const;
+    // invokes a callable object (usually a lambda) on a particular element in
+    // the container
+    template<typename Fn>
+    void call(typed_handle_t<Tag, Index, Gen> handle, Fn&& fn);
+    // invokes a callable object (usually a lambda) on a particular element in
+    // the container (const overload)
+    template<typename Fn>
+    void call(typed_handle_t<Tag, Index, Gen> handle, Fn&& fn) const;
+    // invokes a callable object (usually a lambda) on a particular element in
+    // the container and returns a std::optional containing either the result
+    // or an empty optional (as the handle may not have been successfully
+    // resolved)
+    template<typename Fn>
+    [[nodiscard]] decltype(auto) call_return(
+      typed_handle_t<Tag, Index, Gen> handle, Fn&& fn);
+    // invokes a callable object (usually a lambda) on a particular element in
+    // the container and returns a std::optional containing either the result
+    // or an empty optional (const overload)
+    template<typename Fn>
+    [[nodiscard]] decltype(auto) call_return(
+      typed_handle_t<Tag, Index, Gen> handle, Fn&& fn) const;
+    // removes the element referenced by the handle (the last element is moved
+    // into its place)
+    // returns true if the element was removed, false otherwise (the handle was
+    // invalid or could not be found in the container)
+    bool remove(typed_handle_t<Tag, Index, Gen> handle);
+    // removes the elements referenced by the range of handles
+    // returns the number of elements removed (invalid or duplicate handles are
+    // ignored)
+    template<typename InputIt>
+    Index remove(InputIt first, InputIt last);
+    // returns if the container still has the element referenced by the handle
+    [[nodiscard]] bool has(typed_handle_t<Tag, Index, Gen> handle) const;
+    // returns the number of elements currently stored in the container
+    [[nodiscard]] Index size() const;
+    // returns the number of available handles (includes chunk storage that is
+    // allocated but not yet in use)
+    [[nodiscard]] Index capacity() const;
+    // allocates chunks for the number of elements specified
+    void reserve(Index capacity);
+    // removes all elements and invalidates all handles
+    // note: chunks remain allocated
+    void clear();
+    // frees chunks that no longer hold any elements and releases unused id
+    // capacity and any handles at the back that have never been used
+    void shrink_to_fit();
+    // returns the bytes reserved for chunks, ids and handles
+    [[nodiscard]] memory_usage_t memory_usage() const;
+    // returns the handle for a value at the given index
+    // note: will return an invalid handle if the index is out of range
+    [[nodiscard]] typed_handle_t<Tag, Index, Gen> handle_from_index(
+      Index index) const;
+    // returns the index (position) of a value for a given handle
+    // note: will return an empty optional if the handle is invalid
+    [[nodiscard]] std::optional<Index> index_from_handle(
+      typed_handle_t<Tag, Index, Gen> handle) const;
+    // returns if the container has any elements or not
+    [[nodiscard]] bool empty() const;
+    // returns mutable reference to element at position
+    // note: position must be in range (0 <= position < size)
+    T& operator[](Index position);
+    // returns constant reference to element at position
+    // note: position must be in range (0 <= position < size)
+    const T& operator[](Index position) const;
+    // returns an iterator to the beginning of the elements
+    auto begin() -> iterator;
+    // returns a const iterator to the beginning of the elements
+    auto begin() const -> const_iterator;
+    // returns a const iterator to the beginning of the elements
+    auto cbegin() const -> const_iterator;
+    // returns an iterator to the end of the elements
+    auto end() -> iterator;
+    // returns a const iterator to the end of the elements
+    auto end() const -> const_iterator;
+    // returns a const iterator to the end of the elements
+    auto cend() const -> const_iterator;
+    // invokes a callable object (usually a lambda) on every element
+    template<typename Fn>
+    void for_each(Fn&& fn);
+    // invokes a callable object (usually a lambda) on every element (const
+    // overload)
+    template<typename Fn>
+    void for_each(Fn&& fn) const;
+    // invokes fn(data, count) for each chunk in turn, where data points to
+    // count contiguous elements (the last chunk may be partially filled)
+    template<typename Fn>
+    void for_each_chunk(Fn&& fn);
+    // invokes fn(data, count) for each chunk in turn (const overload)
+    template<typename Fn>
+    void for_each_chunk(Fn&& fn) const;
+    // sorts elements in the container according to the provided comparison
+    // note: compare is passed the indices of the elements to compare
+    template<typename Compare>
+    void sort(Compare&& compare);
+    // sorts elements in the container in the specified range according to the
+    // provided comparison
+    // begin - inclusive, end - exclusive
+    template<typename Compare>
+    void sort(Index begin, Index end, Compare&& compare);
+    // partitions elements in the container according to the provided predicate
+    // returns index of the first element for the second group
+    template<typename Predicate>
+    Index partition(Predicate&& predicate);
+  };
+} // namespace thh
+
+#include "chunked-handle-vector.inl"
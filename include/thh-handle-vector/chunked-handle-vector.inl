@@ -0,0 +1,465 @@
+namespace thh
+{
+  template<
+    typename T, std::size_t ChunkSize, typename Tag, typename Index,
+    typename Gen>
+  size_t chunked_handle_vector_t<
+    T, ChunkSize, Tag, Index, Gen>::element_capacity() const
+  {
+    return chunks_.size() * ChunkSize;
+  }
+
+  template<
+    typename T, std::size_t ChunkSize, typename Tag, typename Index,
+    typename Gen>
+  void chunked_handle_vector_t<
+    T, ChunkSize, Tag, Index, Gen>::try_allocate_chunk()
+  {
+    if (static_cast<size_t>(handles_.size()) == element_capacity()) {
+      // storage is left uninitialized, elements are constructed in place
+      chunks_.push_back(std::unique_ptr<chunk_t>(new chunk_t));
+    }
+  }
+
+  template<
+    typename T, std::size_t ChunkSize, typename Tag, typename Index,
+    typename Gen>
+  void chunked_handle_vector_t<T, ChunkSize, Tag, Index, Gen>::destroy_elements(
+    const Index first, const Index last)
+  {
+    if constexpr (!std::is_trivially_destructible_v<T>) {
+      for (Index i = first; i < last; i++) {
+        begin()[i].~T();
+      }
+    }
+  }
+
+  template<
+    typename T, std::size_t ChunkSize, typename Tag, typename Index,
+    typename Gen>
+  chunked_handle_vector_t<T, ChunkSize, Tag, Index, Gen>::
+    chunked_handle_vector_t(chunked_handle_vector_t&& other) noexcept
+    : chunks_(std::move(other.chunks_))
+  {
+    handles_.swap(other.handles_);
+  }
+
+  template<
+    typename T, std::size_t ChunkSize, typename Tag, typename Index,
+    typename Gen>
+  auto chunked_handle_vector_t<T, ChunkSize, Tag, Index, Gen>::operator=(
+    chunked_handle_vector_t&& other) noexcept -> chunked_handle_vector_t&
+  {
+    if (this != &other) {
+      clear();
+      chunks_.swap(other.chunks_);
+      handles_.swap(other.handles_);
+    }
+    return *this;
+  }
+
+  template<
+    typename T, std::size_t ChunkSize, typename Tag, typename Index,
+    typename Gen>
+  chunked_handle_vector_t<
+    T, ChunkSize, Tag, Index, Gen>::~chunked_handle_vector_t()
+  {
+    destroy_elements(0, size());
+  }
+
+  template<
+    typename T, std::size_t ChunkSize, typename Tag, typename Index,
+    typename Gen>
+  template<typename... Args>
+  typed_handle_t<Tag, Index, Gen> chunked_handle_vector_t<
+    T, ChunkSize, Tag, Index, Gen>::add(Args&&... args)
+  {
+    try_allocate_chunk();
+
+    // construct the new element in place at the back of the last chunk
+    const auto position = handles_.size();
+    new (chunks_[position / Index(ChunkSize)]->storage_
+         + sizeof(T) * (position % Index(ChunkSize)))
+      T(std::forward<Args>(args)...);
+
+    return handles_.add(element_capacity());
+  }
+
+  template<
+    typename T, std::size_t ChunkSize, typename Tag, typename Index,
+    typename Gen>
+  const T* chunked_handle_vector_t<T, ChunkSize, Tag, Index, Gen>::resolve(
+    const typed_handle_t<Tag, Index, Gen> handle) const
+  {
+    if (!has(handle)) {
+      return nullptr;
+    }
+    return &(*this)[handles_.lookup(handle)];
+  }
+
+  template<
+    typename T, std::size_t ChunkSize, typename Tag, typename Index,
+    typename Gen>
+  T* chunked_handle_vector_t<T, ChunkSize, Tag, Index, Gen>::resolve(
+    const typed_handle_t<Tag, Index, Gen> handle)
+  {
+    return const_cast<T*>(
+      static_cast<const chunked_handle_vector_t&>(*this).resolve(handle));
+  }
+
+  template<
+    typename T, std::size_t ChunkSize, typename Tag, typename Index,
+    typename Gen>
+  template<typename Fn>
+  void chunked_handle_vector_t<T, ChunkSize, Tag, Index, Gen>::call(
+    const typed_handle_t<Tag, Index, Gen> handle, Fn&& fn)
+  {
+    if (auto* element = resolve(handle)) {
+      fn(*element);
+    }
+  }
+
+  template<
+    typename T, std::size_t ChunkSize, typename Tag, typename Index,
+    typename Gen>
+  template<typename Fn>
+  void chunked_handle_vector_t<T, ChunkSize, Tag, Index, Gen>::call(
+    const typed_handle_t<Tag, Index, Gen> handle, Fn&& fn) const
+  {
+    if (const auto* element = resolve(handle)) {
+      fn(*element);
+    }
+  }
+
+  template<
+    typename T, std::size_t ChunkSize, typename Tag, typename Index,
+    typename Gen>
+  template<typename Fn>
+  decltype(auto) chunked_handle_vector_t<
+    T, ChunkSize, Tag, Index, Gen>::call_return(
+    const typed_handle_t<Tag, Index, Gen> handle, Fn&& fn)
+  {
+    if (auto* element = resolve(handle)) {
+      return std::optional(fn(*element));
+    }
+    return std::optional<decltype(fn(std::declval<T&>()))>{};
+  }
+
+  template<
+    typename T, std::size_t ChunkSize, typename Tag, typename Index,
+    typename Gen>
+  template<typename Fn>
+  decltype(auto) chunked_handle_vector_t<
+    T, ChunkSize, Tag, Index, Gen>::call_return(
+    const typed_handle_t<Tag, Index, Gen> handle, Fn&& fn) const
+  {
+    if (const auto* element = resolve(handle)) {
+      return std::optional(fn(*element));
+    }
+    return std::optional<decltype(fn(std::declval<const T&>()))>{};
+  }
+
+  template<
+    typename T, std::size_t ChunkSize, typename Tag, typename Index,
+    typename Gen>
+  bool chunked_handle_vector_t<T, ChunkSize, Tag, Index, Gen>::remove(
+    const typed_handle_t<Tag, Index, Gen> handle)
+  {
+    if (!has(handle)) {
+      return false;
+    }
+
+    // move the last element into the position of the element being removed
+    // and then destroy the last element
+    const auto lookup = handles_.remove(handle);
+    const auto last = handles_.size();
+    if (lookup != last) {
+      begin()[lookup] = std::move(begin()[last]);
+    }
+    destroy_elements(last, last + 1);
+
+    return true;
+  }
+
+  template<
+    typename T, std::size_t ChunkSize, typename Tag, typename Index,
+    typename Gen>
+  template<typename InputIt>
+  Index chunked_handle_vector_t<T, ChunkSize, Tag, Index, Gen>::remove(
+    InputIt first, InputIt last)
+  {
+    const auto size_before = size();
+    using std::swap;
+    const auto removed =
+      handles_.remove(first, last, [this](const Index lhs, const Index rhs) {
+        swap(begin()[lhs], begin()[rhs]);
+      });
+    destroy_elements(handles_.size(), size_before);
+
+    return removed;
+  }
+
+  template<
+    typename T, std::size_t ChunkSize, typename Tag, typename Index,
+    typename Gen>
+  bool chunked_handle_vector_t<T, ChunkSize, Tag, Index, Gen>::has(
+    const typed_handle_t<Tag, Index, Gen> handle) const
+  {
+    return handles_.has(handle);
+  }
+
+  template<
+    typename T, std::size_t ChunkSize, typename Tag, typename Index,
+    typename Gen>
+  Index chunked_handle_vector_t<T, ChunkSize, Tag, Index, Gen>::size() const
+  {
+    return handles_.size();
+  }
+
+  template<
+    typename T, std::size_t ChunkSize, typename Tag, typename Index,
+    typename Gen>
+  Index chunked_handle_vector_t<T, ChunkSize, Tag, Index, Gen>::capacity()
+    const
+  {
+    return handles_.capacity();
+  }
+
+  template<
+    typename T, std::size_t ChunkSize, typename Tag, typename Index,
+    typename Gen>
+  void chunked_handle_vector_t<T, ChunkSize, Tag, Index, Gen>::reserve(
+    const Index capacity)
+  {
+    assert(capacity > 0);
+
+    const auto chunk_count = (static_cast<size_t>(capacity) + ChunkSize - 1)
+                           / ChunkSize;
+    chunks_.reserve(chunk_count);
+    while (chunks_.size() < chunk_count) {
+      chunks_.push_back(std::unique_ptr<chunk_t>(new chunk_t));
+    }
+    handles_.reserve(element_capacity());
+  }
+
+  template<
+    typename T, std::size_t ChunkSize, typename Tag, typename Index,
+    typename Gen>
+  void chunked_handle_vector_t<T, ChunkSize, Tag, Index, Gen>::clear()
+  {
+    destroy_elements(0, size());
+    handles_.clear();
+  }
+
+  template<
+    typename T, std::size_t ChunkSize, typename Tag, typename Index,
+    typename Gen>
+  void chunked_handle_vector_t<T, ChunkSize, Tag, Index, Gen>::shrink_to_fit()
+  {
+    chunks_.resize((static_cast<size_t>(size()) + ChunkSize - 1) / ChunkSize);
+    chunks_.shrink_to_fit();
+    handles_.shrink_to_fit();
+  }
+
+  template<
+    typename T, std::size_t ChunkSize, typename Tag, typename Index,
+    typename Gen>
+  memory_usage_t chunked_handle_vector_t<
+    T, ChunkSize, Tag, Index, Gen>::memory_usage() const
+  {
+    auto memory_usage = handles_.memory_usage();
+    memory_usage.element_bytes_ =
+      chunks_.size() * sizeof(chunk_t)
+      + chunks_.capacity() * sizeof(std::unique_ptr<chunk_t>);
+    return memory_usage;
+  }
+
+  template<
+    typename T, std::size_t ChunkSize, typename Tag, typename Index,
+    typename Gen>
+  typed_handle_t<Tag, Index, Gen> chunked_handle_vector_t<
+    T, ChunkSize, Tag, Index, Gen>::handle_from_index(const Index index) const
+  {
+    return handles_.handle_from_index(index);
+  }
+
+  template<
+    typename T, std::size_t ChunkSize, typename Tag, typename Index,
+    typename Gen>
+  std::optional<Index> chunked_handle_vector_t<T, ChunkSize, Tag, Index, Gen>::
+    index_from_handle(const typed_handle_t<Tag, Index, Gen> handle) const
+  {
+    return handles_.index_from_handle(handle);
+  }
+
+  template<
+    typename T, std::size_t ChunkSize, typename Tag, typename Index,
+    typename Gen>
+  bool chunked_handle_vector_t<T, ChunkSize, Tag, Index, Gen>::empty() const
+  {
+    return size() == 0;
+  }
+
+  template<
+    typename T, std::size_t ChunkSize, typename Tag, typename Index,
+    typename Gen>
+  T& chunked_handle_vector_t<T, ChunkSize, Tag, Index, Gen>::operator[](
+    const Index position)
+  {
+    assert(position >= 0 && position < size());
+    return begin()[position];
+  }
+
+  template<
+    typename T, std::size_t ChunkSize, typename Tag, typename Index,
+    typename Gen>
+  const T& chunked_handle_vector_t<T, ChunkSize, Tag, Index, Gen>::operator[](
+    const Index position) const
+  {
+    assert(position >= 0 && position < size());
+    return begin()[position];
+  }
+
+  template<
+    typename T, std::size_t ChunkSize, typename Tag, typename Index,
+    typename Gen>
+  auto chunked_handle_vector_t<T, ChunkSize, Tag, Index, Gen>::begin()
+    -> iterator
+  {
+    return iterator(chunks_.data(), 0);
+  }
+
+  template<
+    typename T, std::size_t ChunkSize, typename Tag, typename Index,
+    typename Gen>
+  auto chunked_handle_vector_t<T, ChunkSize, Tag, Index, Gen>::begin() const
+    -> const_iterator
+  {
+    return const_iterator(chunks_.data(), 0);
+  }
+
+  template<
+    typename T, std::size_t ChunkSize, typename Tag, typename Index,
+    typename Gen>
+  auto chunked_handle_vector_t<T, ChunkSize, Tag, Index, Gen>::cbegin() const
+    -> const_iterator
+  {
+    return begin();
+  }
+
+  template<
+    typename T, std::size_t ChunkSize, typename Tag, typename Index,
+    typename Gen>
+  auto chunked_handle_vector_t<T, ChunkSize, Tag, Index, Gen>::end()
+    -> iterator
+  {
+    return iterator(chunks_.data(), size());
+  }
+
+  template<
+    typename T, std::size_t ChunkSize, typename Tag, typename Index,
+    typename Gen>
+  auto chunked_handle_vector_t<T, ChunkSize, Tag, Index, Gen>::end() const
+    -> const_iterator
+  {
+    return const_iterator(chunks_.data(), size());
+  }
+
+  template<
+    typename T, std::size_t ChunkSize, typename Tag, typename Index,
+    typename Gen>
+  auto chunked_handle_vector_t<T, ChunkSize, Tag, Index, Gen>::cend() const
+    -> const_iterator
+  {
+    return end();
+  }
+
+  template<
+    typename T, std::size_t ChunkSize, typename Tag, typename Index,
+    typename Gen>
+  template<typename Fn>
+  void chunked_handle_vector_t<T, ChunkSize, Tag, Index, Gen>::for_each(
+    Fn&& fn)
+  {
+    for_each_chunk([&fn](T* data, const Index count) {
+      for (Index i = 0; i < count; i++) {
+        fn(data[i]);
+      }
+    });
+  }
+
+  template<
+    typename T, std::size_t ChunkSize, typename Tag, typename Index,
+    typename Gen>
+  template<typename Fn>
+  void chunked_handle_vector_t<T, ChunkSize, Tag, Index, Gen>::for_each(
+    Fn&& fn) const
+  {
+    for_each_chunk([&fn](const T* data, const Index count) {
+      for (Index i = 0; i < count; i++) {
+        fn(data[i]);
+      }
+    });
+  }
+
+  template<
+    typename T, std::size_t ChunkSize, typename Tag, typename Index,
+    typename Gen>
+  template<typename Fn>
+  void chunked_handle_vector_t<T, ChunkSize, Tag, Index, Gen>::for_each_chunk(
+    Fn&& fn)
+  {
+    for (Index begin = 0; begin < size(); begin += Index(ChunkSize)) {
+      fn(&(*this)[begin], std::min(Index(ChunkSize), Index(size() - begin)));
+    }
+  }
+
+  template<
+    typename T, std::size_t ChunkSize, typename Tag, typename Index,
+    typename Gen>
+  template<typename Fn>
+  void chunked_handle_vector_t<T, ChunkSize, Tag, Index, Gen>::for_each_chunk(
+    Fn&& fn) const
+  {
+    for (Index begin = 0; begin < size(); begin += Index(ChunkSize)) {
+      fn(&(*this)[begin], std::min(Index(ChunkSize), Index(size() - begin)));
+    }
+  }
+
+  template<
+    typename T, std::size_t ChunkSize, typename Tag, typename Index,
+    typename Gen>
+  template<typename Compare>
+  void chunked_handle_vector_t<T, ChunkSize, Tag, Index, Gen>::sort(
+    Compare&& compare)
+  {
+    sort(Index(0), size(), std::forward<Compare>(compare));
+  }
+
+  template<
+    typename T, std::size_t ChunkSize, typename Tag, typename Index,
+    typename Gen>
+  template<typename Compare>
+  void chunked_handle_vector_t<T, ChunkSize, Tag, Index, Gen>::sort(
+    const Index begin, const Index end, Compare&& compare)
+  {
+    const auto range = std::min(size() - begin, end - begin);
+    auto* indices = handles_.scratch_positions(begin, range);
+    std::sort(indices, indices + range, std::forward<Compare>(compare));
+    handles_.permute(begin, begin + range, indices, this->begin());
+  }
+
+  template<
+    typename T, std::size_t ChunkSize, typename Tag, typename Index,
+    typename Gen>
+  template<typename Predicate>
+  Index chunked_handle_vector_t<T, ChunkSize, Tag, Index, Gen>::partition(
+    Predicate&& predicate)
+  {
+    auto* indices = handles_.scratch_positions(Index(0), size());
+    const auto second = std::partition(
+      indices, indices + size(), std::forward<Predicate>(predicate));
+    handles_.permute(Index(0), size(), indices, begin());
+    return Index(second - indices);
+  }
+} // namespace thh
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "handle-vector.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+
+namespace thh
+{
+  // thread-safe storage for type T split across a number of independently
+  // locked shards (each shard is a handle_vector_t)
+  // note: handles encode the shard they belong to, elements added from the
+  // same thread are placed in the same shard and threads are given shards in
+  // turn so threads adding concurrently rarely contend with one another
+  //
+  // linearization:
+  // - add, remove, call and call_return each take effect atomically at the
+  //   point the lock of the shard owning the handle is held
+  // - remove(h) takes an exclusive lock, so a concurrent call(h) either sees
+  //   the element before it is removed, or does not invoke the callable
+  // - operations on different shards do not synchronize with one another,
+  //   size() and for_each() visit shards one at a time and so do not observe
+  //   a single consistent snapshot of the whole container
+  template<
+    typename T, typename Tag = default_tag_t, typename Index = int32_t,
+    typename Gen = int32_t>
+  class concurrent_handle_vector_t
+  {
+    // handle container and lock, aligned to avoid false sharing between
+    // neighboring shards
+    struct alignas(64) shard_t
+    {
+      mutable std::shared_mutex mutex_;
+      handle_vector_t<T, Tag, Index, Gen> elements_;
+    };
+
+    std::unique_ptr<shard_t[]> shards_;
+    Index shard_count_ = 0;
+
+    // returns the shard the calling thread adds elements to
+    [[nodiscard]] Index thread_shard() const;
+    // converts a handle from a shard to a handle for the whole container
+    [[nodiscard]] typed_handle_t<Tag, Index, Gen> to_global(
+      typed_handle_t<Tag, Index, Gen> handle, Index shard) const;
+    // converts a handle for the whole container to a handle for a shard
+    // returns the shard the handle belongs to (or -1 if it is out of range)
+    [[nodiscard]] Index to_local(
+      typed_handle_t<Tag, Index, Gen>& handle) const;
+
+  public:
+    using value_type = T;
+
+    // creates a container with the specified number of shards (defaults to
+    // the number of hardware threads)
+    explicit concurrent_handle_vector_t(
+      Index shard_count =
+        static_cast<Index>(std::max(1u, std::thread::hardware_concurrency())));
+
+    // creates an element T in-place and returns a handle to it
+    // note: takes an exclusive lock on the shard for the calling thread
+    template<typename... Args>
+    [[nodiscard]] typed_handle_t<Tag, Index, Gen> add(Args&&... args);
+    // invokes a callable object (usually a lambda) on a particular element in
+    // the container
+    // note: takes an exclusive lock on the shard owning the handle
+    template<typename Fn>
+    void call(typed_handle_t<Tag, Index, Gen> handle, Fn&& fn);
+    // invokes a callable object (usually a lambda) on a particular element in
+    // the container (const overload)
+    // note: takes a shared lock so may run concurrently with other readers
+    template<typename Fn>
+    void call(typed_handle_t<Tag, Index, Gen> handle, Fn&& fn) const;
+    // invokes a callable object (usually a lambda) on a particular element in
+    // the container and returns a std::optional containing either the result
+    // or an empty optional (as the handle may not have been successfully
+    // resolved)
+    template<typename Fn>
+    [[nodiscard]] decltype(auto) call_return(
+      typed_handle_t<Tag, Index, Gen> handle, Fn&& fn);
+    // invokes a callable object (usually a lambda) on a particular element in
+    // the container and returns a std::optional containing either the result
+    // or an empty optional (const overload, takes a shared lock)
+    template<typename Fn>
+    [[nodiscard]] decltype(auto) call_return(
+      typed_handle_t<Tag, Index, Gen> handle, Fn&& fn) const;
+    // removes the element referenced by the handle
+    // returns true if the element was removed, false otherwise (the handle was
+    // invalid or had already been removed)
+    bool remove(typed_handle_t<Tag, Index, Gen> handle);
+    // returns if the container still has the element referenced by the handle
+    // note: takes a shared lock so may run concurrently with other readers
+    [[nodiscard]] bool has(typed_handle_t<Tag, Index, Gen> handle) const;
+    // returns the number of elements currently stored in the container
+    // note: only exact when no other thread is modifying the container
+    [[nodiscard]] Index size() const;
+    // returns the number of shards elements are split across
+    [[nodiscard]] Index shard_count() const;
+    // reserves underlying memory in every shard for the number of elements
+    // specified (per shard)
+    void reserve(Index capacity);
+    // removes all elements and invalidates all handles
+    void clear();
+    // invokes a callable object (usually a lambda) on every element, one
+    // shard at a time (each shard is locked exclusively while it is visited)
+    template<typename Fn>
+    void for_each(Fn&& fn);
+    // invokes a callable object (usually a lambda) on every element, one
+    // shard at a time (each shard is locked for shared access while it is
+    // visited)
+    template<typename Fn>
+    void for_each(Fn&& fn) const;
+  };
+} // namespace thh
+
+#include "concurrent-handle-vector.inl"
@@ -0,0 +1,199 @@
+namespace thh
+{
+  template<typename T, typename Tag, typename Index, typename Gen>
+  concurrent_handle_vector_t<T, Tag, Index, Gen>::concurrent_handle_vector_t(
+    const Index shard_count)
+    : shards_(std::make_unique<shard_t[]>(shard_count)),
+      shard_count_(shard_count)
+  {
+    assert(shard_count > 0);
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  Index concurrent_handle_vector_t<T, Tag, Index, Gen>::thread_shard() const
+  {
+    // threads are numbered round-robin the first time they add an element
+    // (the same thread always maps to the same shard) so up to shard_count
+    // threads adding at once never share a shard
+    static std::atomic<size_t> next_thread_number{0};
+    thread_local const size_t thread_number =
+      next_thread_number.fetch_add(1, std::memory_order_relaxed);
+    return static_cast<Index>(
+      thread_number % static_cast<size_t>(shard_count_));
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  typed_handle_t<Tag, Index, Gen> concurrent_handle_vector_t<
+    T, Tag, Index, Gen>::
+    to_global(
+      const typed_handle_t<Tag, Index, Gen> handle, const Index shard) const
+  {
+    assert(
+      handle.id_
+      <= (std::numeric_limits<Index>::max() - shard) / shard_count_);
+    return {
+      static_cast<Index>(handle.id_ * shard_count_ + shard), handle.gen_};
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  Index concurrent_handle_vector_t<T, Tag, Index, Gen>::to_local(
+    typed_handle_t<Tag, Index, Gen>& handle) const
+  {
+    if (handle.id_ < 0) {
+      return -1;
+    }
+    const auto shard = static_cast<Index>(handle.id_ % shard_count_);
+    handle.id_ = static_cast<Index>(handle.id_ / shard_count_);
+    return shard;
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  template<typename... Args>
+  typed_handle_t<Tag, Index, Gen> concurrent_handle_vector_t<
+    T, Tag, Index, Gen>::add(Args&&... args)
+  {
+    const auto shard = thread_shard();
+    auto& [mutex, elements] = shards_[shard];
+    std::unique_lock lock(mutex);
+    return to_global(elements.add(std::forward<Args>(args)...), shard);
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  template<typename Fn>
+  void concurrent_handle_vector_t<T, Tag, Index, Gen>::call(
+    typed_handle_t<Tag, Index, Gen> handle, Fn&& fn)
+  {
+    if (const auto shard = to_local(handle); shard != -1) {
+      auto& [mutex, elements] = shards_[shard];
+      std::unique_lock lock(mutex);
+      elements.call(handle, std::forward<Fn>(fn));
+    }
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  template<typename Fn>
+  void concurrent_handle_vector_t<T, Tag, Index, Gen>::call(
+    typed_handle_t<Tag, Index, Gen> handle, Fn&& fn) const
+  {
+    if (const auto shard = to_local(handle); shard != -1) {
+      const auto& [mutex, elements] = shards_[shard];
+      std::shared_lock lock(mutex);
+      elements.call(handle, std::forward<Fn>(fn));
+    }
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  template<typename Fn>
+  decltype(auto) concurrent_handle_vector_t<T, Tag, Index, Gen>::call_return(
+    typed_handle_t<Tag, Index, Gen> handle, Fn&& fn)
+  {
+    if (const auto shard = to_local(handle); shard != -1) {
+      auto& [mutex, elements] = shards_[shard];
+      std::unique_lock lock(mutex);
+      return elements.call_return(handle, std::forward<Fn>(fn));
+    }
+    return std::optional<decltype(fn(*(static_cast<T*>(nullptr))))>{};
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  template<typename Fn>
+  decltype(auto) concurrent_handle_vector_t<T, Tag, Index, Gen>::call_return(
+    typed_handle_t<Tag, Index, Gen> handle, Fn&& fn) const
+  {
+    if (const auto shard = to_local(handle); shard != -1) {
+      const auto& [mutex, elements] = shards_[shard];
+      std::shared_lock lock(mutex);
+      return elements.call_return(handle, std::forward<Fn>(fn));
+    }
+    return std::optional<decltype(fn(*(static_cast<const T*>(nullptr))))>{};
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  bool concurrent_handle_vector_t<T, Tag, Index, Gen>::remove(
+    typed_handle_t<Tag, Index, Gen> handle)
+  {
+    if (const auto shard = to_local(handle); shard != -1) {
+      auto& [mutex, elements] = shards_[shard];
+      std::unique_lock lock(mutex);
+      return elements.remove(handle);
+    }
+    return false;
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  bool concurrent_handle_vector_t<T, Tag, Index, Gen>::has(
+    typed_handle_t<Tag, Index, Gen> handle) const
+  {
+    if (const auto shard = to_local(handle); shard != -1) {
+      const auto& [mutex, elements] = shards_[shard];
+      std::shared_lock lock(mutex);
+      return elements.has(handle);
+    }
+    return false;
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  Index concurrent_handle_vector_t<T, Tag, Index, Gen>::size() const
+  {
+    Index size = 0;
+    for (Index shard = 0; shard < shard_count_; shard++) {
+      const auto& [mutex, elements] = shards_[shard];
+      std::shared_lock lock(mutex);
+      size += elements.size();
+    }
+    return size;
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  Index concurrent_handle_vector_t<T, Tag, Index, Gen>::shard_count() const
+  {
+    return shard_count_;
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  void concurrent_handle_vector_t<T, Tag, Index, Gen>::reserve(
+    const Index capacity)
+  {
+    for (Index shard = 0; shard < shard_count_; shard++) {
+      auto& [mutex, elements] = shards_[shard];
+      std::unique_lock lock(mutex);
+      elements.reserve(capacity);
+    }
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  void concurrent_handle_vector_t<T, Tag, Index, Gen>::clear()
+  {
+    for (Index shard = 0; shard < shard_count_; shard++) {
+      auto& [mutex, elements] = shards_[shard];
+      std::unique_lock lock(mutex);
+      elements.clear();
+    }
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  template<typename Fn>
+  void concurrent_handle_vector_t<T, Tag, Index, Gen>::for_each(Fn&& fn)
+  {
+    for (Index shard = 0; shard < shard_count_; shard++) {
+      auto& [mutex, elements] = shards_[shard];
+      std::unique_lock lock(mutex);
+      for (auto& element : elements) {
+        fn(element);
+      }
+    }
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  template<typename Fn>
+  void concurrent_handle_vector_t<T, Tag, Index, Gen>::for_each(Fn&& fn) const
+  {
+    for (Index shard = 0; shard < shard_count_; shard++) {
+      const auto& [mutex, elements] = shards_[shard];
+      std::shared_lock lock(mutex);
+      for (const auto& element : elements) {
+        fn(element);
+      }
+    }
+  }
+} // namespace thh
@@ -0,0 +1,192 @@
+#pragma once
+
+#include "handle-vector.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <new>
+#include <optional>
+
+namespace thh
+{
+  // storage for type T where a single writer thread adds and removes elements
+  // while any number of reader threads resolve handles without taking a lock
+  // note: readers register once (register_reader) and then enter a read-side
+  // critical section (reader_t::enter) before resolving handles, removed
+  // elements and replaced handle/element buffers are only destroyed once
+  // every reader that could still observe them has left its critical section
+  // note: elements are not tightly packed (each handle refers to a slot that
+  // does not change) and must not be modified once added as readers may be
+  // accessing them concurrently
+  template<
+    typename T, typename Tag = default_tag_t, typename Index = int32_t,
+    typename Gen = int32_t>
+  class epoch_handle_vector_t
+  {
+    // storage for an element and the generation of the handle referring to it
+    struct slot_t
+    {
+      // generation of the element currently stored (-1 if there is none)
+      // note: the only field readers access
+      std::atomic<Gen> live_gen_ = -1;
+      // generation of the most recently added element (writer only)
+      Gen gen_ = -1;
+      alignas(T) unsigned char element_[sizeof(T)];
+
+      [[nodiscard]] T* element();
+      [[nodiscard]] const T* element() const;
+    };
+
+    // fixed capacity buffer of slots, replaced (and later reclaimed) when the
+    // container grows
+    struct table_t
+    {
+      explicit table_t(Index capacity);
+      std::unique_ptr<slot_t[]> slots_;
+      Index capacity_ = 0;
+    };
+
+    // per reader epoch, aligned to avoid false sharing between readers
+    struct alignas(64) reader_slot_t
+    {
+      // epoch the reader entered its critical section in (0 when outside)
+      std::atomic<uint64_t> epoch_ = 0;
+      std::atomic<bool> registered_ = false;
+    };
+
+    // element waiting for readers to leave before it is destroyed
+    struct retired_element_t
+    {
+      uint64_t epoch_;
+      T* element_;
+      Index id_;
+    };
+
+    // buffer waiting for readers to leave before it is destroyed
+    struct retired_table_t
+    {
+      uint64_t epoch_;
+      std::unique_ptr<table_t> table_;
+    };
+
+    // table readers resolve handles against
+    std::atomic<table_t*> table_ = nullptr;
+    // writer owned copy of the current table (identical to table_)
+    std::unique_ptr<table_t> owned_table_;
+    // global epoch, incremented each time something is retired
+    std::atomic<uint64_t> epoch_ = 1;
+    std::unique_ptr<reader_slot_t[]> reader_slots_;
+    int32_t reader_capacity_ = 0;
+    std::deque<retired_element_t> retired_elements_;
+    std::deque<retired_table_t> retired_tables_;
+    // reclaimed slots available for reuse
+    std::deque<Index> free_ids_;
+    // next slot that has never been used
+    Index next_id_ = 0;
+    Index size_ = 0;
+
+    void grow(Index capacity);
+    // returns the oldest epoch a reader is currently in (or the max value if
+    // no readers are inside a critical section)
+    [[nodiscard]] uint64_t oldest_reader_epoch() const;
+    // destroys live elements in a table that is no longer in use
+    static void destroy_elements(table_t& table);
+
+  public:
+    using value_type = T;
+    using handle_type = typed_handle_t<Tag, Index, Gen>;
+
+    class reader_t;
+
+    // read-side critical section, resolved elements remain valid until the
+    // guard is destroyed
+    class read_guard_t
+    {
+      friend class reader_t;
+      const epoch_handle_vector_t* container_ = nullptr;
+      reader_slot_t* reader_slot_ = nullptr;
+      read_guard_t(
+        const epoch_handle_vector_t* container, reader_slot_t* reader_slot);
+
+    public:
+      read_guard_t(const read_guard_t&) = delete;
+      read_guard_t& operator=(const read_guard_t&) = delete;
+      ~read_guard_t();
+
+      // returns a pointer to the element referenced by the handle (or nullptr
+      // if the handle is no longer valid)
+      [[nodiscard]] const T* resolve(handle_type handle) const;
+      // returns if the container has the element referenced by the handle
+      [[nodiscard]] bool has(handle_type handle) const;
+      // invokes a callable object (usually a lambda) on a particular element
+      // in the container
+      template<typename Fn>
+      void call(handle_type handle, Fn&& fn) const;
+      // invokes a callable object (usually a lambda) on a particular element
+      // in the container and returns a std::optional containing either the
+      // result or an empty optional (as the handle may not have been
+      // successfully resolved)
+      template<typename Fn>
+      [[nodiscard]] decltype(auto) call_return(
+        handle_type handle, Fn&& fn) const;
+    };
+
+    // registration for a reader thread (one per thread)
+    class reader_t
+    {
+      friend class epoch_handle_vector_t;
+      const epoch_handle_vector_t* container_ = nullptr;
+      reader_slot_t* reader_slot_ = nullptr;
+      reader_t(
+        const epoch_handle_vector_t* container, reader_slot_t* reader_slot);
+
+    public:
+      reader_t(reader_t&& reader) noexcept;
+      reader_t& operator=(reader_t&& reader) noexcept;
+      ~reader_t();
+
+      // enters a read-side critical section
+      // note: critical sections must not be nested
+      [[nodiscard]] read_guard_t enter() const;
+    };
+
+    // creates a container supporting up to max_readers registered readers
+    explicit epoch_handle_vector_t(int32_t max_readers = 64);
+    epoch_handle_vector_t(const epoch_handle_vector_t&) = delete;
+    epoch_handle_vector_t& operator=(const epoch_handle_vector_t&) = delete;
+    ~epoch_handle_vector_t();
+
+    // registers a reader (may be called from any thread)
+    // returns an empty optional if max_readers are already registered
+    [[nodiscard]] std::optional<reader_t> register_reader() const;
+
+    // writer interface (must only be called from a single thread)
+
+    // creates an element T in-place and returns a handle to it
+    template<typename... Args>
+    [[nodiscard]] handle_type add(Args&&... args);
+    // removes the element referenced by the handle
+    // note: the element is destroyed once no reader can still observe it
+    bool remove(handle_type handle);
+    // returns if the container still has the element referenced by the handle
+    [[nodiscard]] bool has(handle_type handle) const;
+    // returns the number of elements currently stored in the container
+    [[nodiscard]] Index size() const;
+    // returns if the container has any elements or not
+    [[nodiscard]] bool empty() const;
+    // returns the number of slots currently allocated
+    [[nodiscard]] Index capacity() const;
+    // reserves underlying memory for the number of elements specified
+    void reserve(Index capacity);
+    // removes all elements and invalidates all handles
+    void clear();
+    // destroys removed elements and replaced buffers no longer visible to any
+    // reader (called automatically by remove and when the container grows)
+    void reclaim();
+  };
+} // namespace thh
+
+#include "epoch-handle-vector.inl"
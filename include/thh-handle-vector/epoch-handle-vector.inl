@@ -0,0 +1,342 @@
+namespace thh
+{
+  template<typename T, typename Tag, typename Index, typename Gen>
+  T* epoch_handle_vector_t<T, Tag, Index, Gen>::slot_t::element()
+  {
+    return std::launder(reinterpret_cast<T*>(element_));
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  const T* epoch_handle_vector_t<T, Tag, Index, Gen>::slot_t::element() const
+  {
+    return std::launder(reinterpret_cast<const T*>(element_));
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  epoch_handle_vector_t<T, Tag, Index, Gen>::table_t::table_t(
+    const Index capacity)
+    : slots_(std::make_unique<slot_t[]>(capacity)), capacity_(capacity)
+  {
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  epoch_handle_vector_t<T, Tag, Index, Gen>::read_guard_t::read_guard_t(
+    const epoch_handle_vector_t* container, reader_slot_t* reader_slot)
+    : container_(container), reader_slot_(reader_slot)
+  {
+    assert(reader_slot_->epoch_.load() == 0); // critical sections must not nest
+    // publish the epoch before the table is read (sequentially consistent so
+    // the writer either sees this reader or the reader sees the new table)
+    reader_slot_->epoch_.store(container_->epoch_.load());
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  epoch_handle_vector_t<T, Tag, Index, Gen>::read_guard_t::~read_guard_t()
+  {
+    reader_slot_->epoch_.store(0);
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  const T* epoch_handle_vector_t<T, Tag, Index, Gen>::read_guard_t::resolve(
+    const handle_type handle) const
+  {
+    const table_t* table = container_->table_.load();
+    if (table == nullptr || handle.id_ < 0 || handle.id_ >= table->capacity_) {
+      return nullptr;
+    }
+    const slot_t& slot = table->slots_[handle.id_];
+    if (slot.live_gen_.load() != handle.gen_) {
+      return nullptr;
+    }
+    return slot.element();
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  bool epoch_handle_vector_t<T, Tag, Index, Gen>::read_guard_t::has(
+    const handle_type handle) const
+  {
+    return resolve(handle) != nullptr;
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  template<typename Fn>
+  void epoch_handle_vector_t<T, Tag, Index, Gen>::read_guard_t::call(
+    const handle_type handle, Fn&& fn) const
+  {
+    if (const T* element = resolve(handle)) {
+      fn(*element);
+    }
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  template<typename Fn>
+  decltype(auto) epoch_handle_vector_t<T, Tag, Index, Gen>::read_guard_t::
+    call_return(const handle_type handle, Fn&& fn) const
+  {
+    if (const T* element = resolve(handle)) {
+      return std::optional(fn(*element));
+    }
+    return std::optional<decltype(fn(*(static_cast<const T*>(nullptr))))>{};
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  epoch_handle_vector_t<T, Tag, Index, Gen>::reader_t::reader_t(
+    const epoch_handle_vector_t* container, reader_slot_t* reader_slot)
+    : container_(container), reader_slot_(reader_slot)
+  {
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  epoch_handle_vector_t<T, Tag, Index, Gen>::reader_t::reader_t(
+    reader_t&& reader) noexcept
+    : container_(std::exchange(reader.container_, nullptr)),
+      reader_slot_(std::exchange(reader.reader_slot_, nullptr))
+  {
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  typename epoch_handle_vector_t<T, Tag, Index, Gen>::reader_t&
+  epoch_handle_vector_t<T, Tag, Index, Gen>::reader_t::operator=(
+    reader_t&& reader) noexcept
+  {
+    if (this != &reader) {
+      if (reader_slot_ != nullptr) {
+        reader_slot_->registered_.store(false);
+      }
+      container_ = std::exchange(reader.container_, nullptr);
+      reader_slot_ = std::exchange(reader.reader_slot_, nullptr);
+    }
+    return *this;
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  epoch_handle_vector_t<T, Tag, Index, Gen>::reader_t::~reader_t()
+  {
+    if (reader_slot_ != nullptr) {
+      reader_slot_->registered_.store(false);
+    }
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  typename epoch_handle_vector_t<T, Tag, Index, Gen>::read_guard_t
+  epoch_handle_vector_t<T, Tag, Index, Gen>::reader_t::enter() const
+  {
+    return read_guard_t(container_, reader_slot_);
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  epoch_handle_vector_t<T, Tag, Index, Gen>::epoch_handle_vector_t(
+    const int32_t max_readers)
+    : reader_slots_(std::make_unique<reader_slot_t[]>(max_readers)),
+      reader_capacity_(max_readers)
+  {
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  epoch_handle_vector_t<T, Tag, Index, Gen>::~epoch_handle_vector_t()
+  {
+    // no readers may be inside a critical section at this point
+    for (const auto& retired_element : retired_elements_) {
+      std::destroy_at(retired_element.element_);
+    }
+    for (auto& retired_table : retired_tables_) {
+      destroy_elements(*retired_table.table_);
+    }
+    if (owned_table_) {
+      destroy_elements(*owned_table_);
+    }
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  void epoch_handle_vector_t<T, Tag, Index, Gen>::destroy_elements(
+    table_t& table)
+  {
+    for (Index id = 0; id < table.capacity_; id++) {
+      if (table.slots_[id].live_gen_.load(std::memory_order_relaxed) != -1) {
+        std::destroy_at(table.slots_[id].element());
+      }
+    }
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  std::optional<typename epoch_handle_vector_t<T, Tag, Index, Gen>::reader_t>
+  epoch_handle_vector_t<T, Tag, Index, Gen>::register_reader() const
+  {
+    for (int32_t r = 0; r < reader_capacity_; r++) {
+      bool registered = false;
+      if (reader_slots_[r].registered_.compare_exchange_strong(
+            registered, true)) {
+        return reader_t(this, &reader_slots_[r]);
+      }
+    }
+    return {};
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  void epoch_handle_vector_t<T, Tag, Index, Gen>::grow(const Index capacity)
+  {
+    auto table = std::make_unique<table_t>(capacity);
+    if (owned_table_) {
+      // copy (rather than move) elements as readers may still be accessing
+      // the previous table
+      for (Index id = 0; id < owned_table_->capacity_; id++) {
+        const slot_t& slot = owned_table_->slots_[id];
+        slot_t& next_slot = table->slots_[id];
+        const Gen live_gen = slot.live_gen_.load(std::memory_order_relaxed);
+        if (live_gen != -1) {
+          ::new (static_cast<void*>(next_slot.element_)) T(*slot.element());
+        }
+        next_slot.gen_ = slot.gen_;
+        next_slot.live_gen_.store(live_gen, std::memory_order_relaxed);
+      }
+    }
+    table_.store(table.get());
+    if (owned_table_) {
+      retired_tables_.push_back({epoch_.fetch_add(1), std::move(owned_table_)});
+    }
+    owned_table_ = std::move(table);
+    reclaim();
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  uint64_t epoch_handle_vector_t<T, Tag, Index, Gen>::oldest_reader_epoch()
+    const
+  {
+    uint64_t oldest = std::numeric_limits<uint64_t>::max();
+    for (int32_t r = 0; r < reader_capacity_; r++) {
+      if (const uint64_t epoch = reader_slots_[r].epoch_.load(); epoch != 0) {
+        oldest = std::min(oldest, epoch);
+      }
+    }
+    return oldest;
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  void epoch_handle_vector_t<T, Tag, Index, Gen>::reclaim()
+  {
+    if (retired_elements_.empty() && retired_tables_.empty()) {
+      return;
+    }
+    // anything retired before the oldest reader entered can be reclaimed
+    const uint64_t oldest = oldest_reader_epoch();
+    // elements are reclaimed first as they may live in a retired table
+    while (!retired_elements_.empty()
+           && retired_elements_.front().epoch_ < oldest) {
+      const auto& retired_element = retired_elements_.front();
+      std::destroy_at(retired_element.element_);
+      // retire the slot if its generation has reached its limit
+      if (
+        owned_table_->slots_[retired_element.id_].gen_
+        != std::numeric_limits<Gen>::max()) {
+        free_ids_.push_back(retired_element.id_);
+      }
+      retired_elements_.pop_front();
+    }
+    while (!retired_tables_.empty()
+           && retired_tables_.front().epoch_ < oldest) {
+      destroy_elements(*retired_tables_.front().table_);
+      retired_tables_.pop_front();
+    }
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  template<typename... Args>
+  typename epoch_handle_vector_t<T, Tag, Index, Gen>::handle_type
+  epoch_handle_vector_t<T, Tag, Index, Gen>::add(Args&&... args)
+  {
+    Index id;
+    if (!free_ids_.empty()) {
+      id = free_ids_.front();
+      free_ids_.pop_front();
+    } else {
+      if (next_id_ == capacity()) {
+        assert(capacity() <= std::numeric_limits<Index>::max() / 2);
+        grow(std::max(capacity() * 2, Index(8)));
+      }
+      id = next_id_++;
+    }
+
+    slot_t& slot = owned_table_->slots_[id];
+    ::new (static_cast<void*>(slot.element_)) T(std::forward<Args>(args)...);
+    slot.gen_++;
+    // publish the element to readers
+    slot.live_gen_.store(slot.gen_);
+    size_++;
+
+    return {id, slot.gen_};
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  bool epoch_handle_vector_t<T, Tag, Index, Gen>::remove(
+    const handle_type handle)
+  {
+    if (!has(handle)) {
+      return false;
+    }
+
+    slot_t& slot = owned_table_->slots_[handle.id_];
+    slot.live_gen_.store(-1);
+    retired_elements_.push_back(
+      {epoch_.fetch_add(1), slot.element(), handle.id_});
+    size_--;
+
+    reclaim();
+
+    return true;
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  bool epoch_handle_vector_t<T, Tag, Index, Gen>::has(
+    const handle_type handle) const
+  {
+    return handle.id_ >= 0 && handle.id_ < capacity()
+        && owned_table_->slots_[handle.id_].live_gen_.load(
+             std::memory_order_relaxed)
+             == handle.gen_;
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  Index epoch_handle_vector_t<T, Tag, Index, Gen>::size() const
+  {
+    return size_;
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  bool epoch_handle_vector_t<T, Tag, Index, Gen>::empty() const
+  {
+    return size_ == 0;
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  Index epoch_handle_vector_t<T, Tag, Index, Gen>::capacity() const
+  {
+    return owned_table_ ? owned_table_->capacity_ : 0;
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  void epoch_handle_vector_t<T, Tag, Index, Gen>::reserve(const Index capacity)
+  {
+    if (capacity > this->capacity()) {
+      grow(capacity);
+    }
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  void epoch_handle_vector_t<T, Tag, Index, Gen>::clear()
+  {
+    if (size_ == 0) {
+      return;
+    }
+    // all elements are retired together in the same epoch
+    const uint64_t epoch = epoch_.fetch_add(1);
+    for (Index id = 0; id < next_id_; id++) {
+      slot_t& slot = owned_table_->slots_[id];
+      if (slot.live_gen_.load(std::memory_order_relaxed) != -1) {
+        slot.live_gen_.store(-1);
+        retired_elements_.push_back({epoch, slot.element(), id});
+      }
+    }
+    size_ = 0;
+    reclaim();
+  }
+} // namespace thh
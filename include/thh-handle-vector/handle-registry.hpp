@@ -0,0 +1,206 @@
+#pragma once
+
+#include "handle-vector.hpp"
+
+#include <cstddef>
+
+namespace thh
+{
+  // forward declare handle_storage_t (attaches itself to a registry)
+  template<typename T, typename Tag, typename Index, typename Gen>
+  class handle_storage_t;
+
+  // forward declare storage_join_t (reads the mapping of each storage)
+  template<typename Tag, typename Index, typename Gen, typename... Ts>
+  class storage_join_t;
+
+  // allocates handles (generations and the free list) independently of any
+  // element storage so several handle_storage_t containers can share a single
+  // handle space (e.g. entities with components stored separately)
+  // note: destroying a handle removes its element from every attached storage
+  // note: the registry must outlive the storages attached to it (it cannot be
+  // copied or moved as storages refer to it)
+  template<
+    typename Tag = default_tag_t, typename Index = int32_t,
+    typename Gen = int32_t>
+  class handle_registry_t
+  {
+    template<typename, typename, typename, typename>
+    friend class handle_storage_t;
+
+    // storage attached to the registry, remove_ is invoked for each handle
+    // that is destroyed and clear_ when all handles are destroyed at once
+    struct attached_storage_t
+    {
+      void* storage_ = nullptr;
+      void (*remove_)(void* storage, typed_handle_t<Tag, Index, Gen> handle);
+      void (*clear_)(void* storage);
+    };
+
+    // lookup of a handle that is currently in use (handles do not refer to
+    // anything in the registry itself)
+    static constexpr Index in_use = 0;
+
+    // generation and free list link for every handle ever created (handles
+    // are reused in the order they were destroyed)
+    detail::handle_pool_t<Tag, Index, Gen> handles_;
+    // storages to notify when handles are destroyed
+    std::vector<attached_storage_t> storages_;
+    // number of handles in use
+    Index size_ = 0;
+
+    // registers a storage to be notified when handles are destroyed
+    void attach(
+      void* storage,
+      void (*remove)(void* storage, typed_handle_t<Tag, Index, Gen> handle),
+      void (*clear)(void* storage));
+    // stops notifying the storage
+    void detach(const void* storage);
+
+  public:
+    handle_registry_t() = default;
+    handle_registry_t(const handle_registry_t&) = delete;
+    handle_registry_t& operator=(const handle_registry_t&) = delete;
+
+    // returns a new handle (reusing a destroyed handle if one is available)
+    [[nodiscard]] typed_handle_t<Tag, Index, Gen> create();
+    // destroys the handle and removes its element from every attached storage
+    // returns true if the handle was destroyed, false otherwise (the handle
+    // was invalid)
+    bool destroy(typed_handle_t<Tag, Index, Gen> handle);
+    // returns if the handle has been created and not yet destroyed
+    [[nodiscard]] bool has(typed_handle_t<Tag, Index, Gen> handle) const;
+    // returns the number of handles currently in use
+    [[nodiscard]] Index size() const;
+    // returns the number of handles ever created (in use, free or depleted)
+    [[nodiscard]] Index capacity() const;
+    // returns if the registry has any handles in use or not
+    [[nodiscard]] bool empty() const;
+    // reserves underlying memory for the number of handles specified
+    void reserve(Index capacity);
+    // destroys all handles and removes every element from attached storages
+    // note: generations are kept so existing handles never become valid again
+    void clear();
+    // invokes fn(handle) for every handle in use (in order of id)
+    template<typename Fn>
+    void for_each(Fn&& fn) const;
+  };
+
+  // packed storage for elements of type T indexed by handles from a shared
+  // handle_registry_t (at most one element per handle), elements are kept
+  // tightly packed so iteration is dense
+  // note: each storage keeps its own mapping from handles to elements, only
+  // handles with an element in this storage take up space in the packed
+  // elements (the mapping grows to the largest handle id added)
+  // note: storages cannot be copied or moved as the registry refers to them
+  template<
+    typename T, typename Tag = default_tag_t, typename Index = int32_t,
+    typename Gen = int32_t>
+  class handle_storage_t
+  {
+    template<typename, typename, typename, typename...>
+    friend class storage_join_t;
+
+    // registry that handles are created by
+    handle_registry_t<Tag, Index, Gen>* registry_ = nullptr;
+    // backing container for elements (vector remains tightly packed)
+    std::vector<T> elements_;
+    // parallel vector of the handle each element belongs to
+    std::vector<typed_handle_t<Tag, Index, Gen>> element_handles_;
+    // sparse vector (indexed by handle id) of element positions (-1 for
+    // handles without an element)
+    std::vector<Index> lookup_;
+
+    // invoked by the registry when handle is destroyed
+    static void remove_element(
+      void* storage, typed_handle_t<Tag, Index, Gen> handle);
+    // invoked by the registry when all handles are destroyed
+    static void clear_elements(void* storage);
+
+  public:
+    using iterator = typename std::vector<T>::iterator;
+    using const_iterator = typename std::vector<T>::const_iterator;
+    using value_type = T;
+    using reference = T&;
+    using const_reference = const T&;
+
+    // attaches the storage to registry (detached again when destroyed)
+    explicit handle_storage_t(handle_registry_t<Tag, Index, Gen>& registry);
+    ~handle_storage_t();
+    handle_storage_t(const handle_storage_t&) = delete;
+    handle_storage_t& operator=(const handle_storage_t&) = delete;
+
+    // creates an element T in-place for the handle
+    // returns true if the element was added, false otherwise (the handle is
+    // not in use by the registry or already has an element in this storage)
+    template<typename... Args>
+    bool add(typed_handle_t<Tag, Index, Gen> handle, Args&&... args);
+    // removes the element for the handle (the handle remains in use)
+    // returns true if the element was removed, false otherwise
+    bool remove(typed_handle_t<Tag, Index, Gen> handle);
+    // returns if the storage has an element for the handle
+    [[nodiscard]] bool has(typed_handle_t<Tag, Index, Gen> handle) const;
+    // invokes a callable object (usually a lambda) on the element for the
+    // handle (if there is one)
+    template<typename Fn>
+    void call(typed_handle_t<Tag, Index, Gen> handle, Fn&& fn);
+    // invokes a callable object (usually a lambda) on the element for the
+    // handle (const overload)
+    template<typename Fn>
+    void call(typed_handle_t<Tag, Index, Gen> handle, Fn&& fn) const;
+    // invokes a callable object (usually a lambda) on the element for the
+    // handle and returns a std::optional containing either the result or an
+    // empty optional (as the handle may not have an element)
+    template<typename Fn>
+    [[nodiscard]] decltype(auto) call_return(
+      typed_handle_t<Tag, Index, Gen> handle, Fn&& fn);
+    // invokes a callable object (usually a lambda) on the element for the
+    // handle and returns a std::optional containing either the result or an
+    // empty optional (const overload)
+    template<typename Fn>
+    [[nodiscard]] decltype(auto) call_return(
+      typed_handle_t<Tag, Index, Gen> handle, Fn&& fn) const;
+    // returns the number of elements currently stored
+    [[nodiscard]] Index size() const;
+    // returns if the storage has any elements or not
+    [[nodiscard]] bool empty() const;
+    // reserves underlying memory for the number of elements specified
+    void reserve(Index capacity);
+    // removes all elements (handles remain in use by the registry)
+    void clear();
+    // returns the handle of the element at the given index
+    // note: will return an invalid handle if the index is out of range
+    [[nodiscard]] typed_handle_t<Tag, Index, Gen> handle_from_index(
+      Index index) const;
+    // returns the index (position) of the element for a given handle
+    // note: will return an empty optional if there is no element
+    [[nodiscard]] std::optional<Index> index_from_handle(
+      typed_handle_t<Tag, Index, Gen> handle) const;
+    // returns mutable reference to element at position
+    // note: position must be in range (0 <= position < size)
+    T& operator[](Index position);
+    // returns constant reference to element at position
+    // note: position must be in range (0 <= position < size)
+    const T& operator[](Index position) const;
+    // returns a pointer to the underlying element storage
+    T* data();
+    // returns a const pointer to the underlying element storage
+    const T* data() const;
+    // returns an iterator to the beginning of the elements
+    auto begin() -> iterator;
+    // returns a const iterator to the beginning of the elements
+    auto begin() const -> const_iterator;
+    // returns an iterator to the end of the elements
+    auto end() -> iterator;
+    // returns a const iterator to the end of the elements
+    auto end() const -> const_iterator;
+    // invokes fn(handle, element) on every element (in order)
+    template<typename Fn>
+    void for_each(Fn&& fn);
+    // invokes fn(handle, element) on every element (const overload)
+    template<typename Fn>
+    void for_each(Fn&& fn) const;
+  };
+} // namespace thh
+
+#include "handle-registry.inl"
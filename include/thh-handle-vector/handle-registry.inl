@@ -0,0 +1,351 @@
+namespace thh
+{
+  template<typename Tag, typename Index, typename Gen>
+  void handle_registry_t<Tag, Index, Gen>::attach(
+    void* storage,
+    void (*remove)(void* storage, typed_handle_t<Tag, Index, Gen> handle),
+    void (*clear)(void* storage))
+  {
+    storages_.push_back({storage, remove, clear});
+  }
+
+  template<typename Tag, typename Index, typename Gen>
+  void handle_registry_t<Tag, Index, Gen>::detach(const void* storage)
+  {
+    storages_.erase(
+      std::remove_if(
+        storages_.begin(), storages_.end(),
+        [storage](const attached_storage_t& attached) {
+          return attached.storage_ == storage;
+        }),
+      storages_.end());
+  }
+
+  template<typename Tag, typename Index, typename Gen>
+  typed_handle_t<Tag, Index, Gen> handle_registry_t<Tag, Index, Gen>::create()
+  {
+    // handles are only created once there are none free to reuse
+    const auto id = handles_.allocate(static_cast<size_t>(size_) + 1, in_use);
+    size_++;
+
+    return {id, handles_[id].gen_};
+  }
+
+  template<typename Tag, typename Index, typename Gen>
+  bool handle_registry_t<Tag, Index, Gen>::destroy(
+    const typed_handle_t<Tag, Index, Gen> handle)
+  {
+    if (!has(handle)) {
+      return false;
+    }
+
+    for (const auto& attached : storages_) {
+      attached.remove_(attached.storage_, handle);
+    }
+
+    handles_.free_handle(handle.id_);
+    size_--;
+
+    return true;
+  }
+
+  template<typename Tag, typename Index, typename Gen>
+  bool handle_registry_t<Tag, Index, Gen>::has(
+    const typed_handle_t<Tag, Index, Gen> handle) const
+  {
+    return handles_.has(handle);
+  }
+
+  template<typename Tag, typename Index, typename Gen>
+  Index handle_registry_t<Tag, Index, Gen>::size() const
+  {
+    return size_;
+  }
+
+  template<typename Tag, typename Index, typename Gen>
+  Index handle_registry_t<Tag, Index, Gen>::capacity() const
+  {
+    return static_cast<Index>(handles_.size());
+  }
+
+  template<typename Tag, typename Index, typename Gen>
+  bool handle_registry_t<Tag, Index, Gen>::empty() const
+  {
+    return size_ == 0;
+  }
+
+  template<typename Tag, typename Index, typename Gen>
+  void handle_registry_t<Tag, Index, Gen>::reserve(const Index capacity)
+  {
+    assert(capacity > 0);
+
+    handles_.reserve(capacity);
+  }
+
+  template<typename Tag, typename Index, typename Gen>
+  void handle_registry_t<Tag, Index, Gen>::clear()
+  {
+    for (const auto& attached : storages_) {
+      attached.clear_(attached.storage_);
+    }
+
+    // generations are kept so destroyed handles never become valid again
+    handles_.clear();
+    size_ = 0;
+  }
+
+  template<typename Tag, typename Index, typename Gen>
+  template<typename Fn>
+  void handle_registry_t<Tag, Index, Gen>::for_each(Fn&& fn) const
+  {
+    for (Index id = 0; id < static_cast<Index>(handles_.size()); id++) {
+      if (handles_[id].lookup_ == in_use) {
+        fn(typed_handle_t<Tag, Index, Gen>(id, handles_[id].gen_));
+      }
+    }
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  void handle_storage_t<T, Tag, Index, Gen>::remove_element(
+    void* storage, const typed_handle_t<Tag, Index, Gen> handle)
+  {
+    static_cast<handle_storage_t*>(storage)->remove(handle);
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  void handle_storage_t<T, Tag, Index, Gen>::clear_elements(void* storage)
+  {
+    static_cast<handle_storage_t*>(storage)->clear();
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  handle_storage_t<T, Tag, Index, Gen>::handle_storage_t(
+    handle_registry_t<Tag, Index, Gen>& registry)
+    : registry_(&registry)
+  {
+    registry_->attach(this, &remove_element, &clear_elements);
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  handle_storage_t<T, Tag, Index, Gen>::~handle_storage_t()
+  {
+    registry_->detach(this);
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  template<typename... Args>
+  bool handle_storage_t<T, Tag, Index, Gen>::add(
+    const typed_handle_t<Tag, Index, Gen> handle, Args&&... args)
+  {
+    if (!registry_->has(handle) || has(handle)) {
+      return false;
+    }
+
+    // grow the sparse lookup to cover the handle
+    if (handle.id_ >= static_cast<Index>(lookup_.size())) {
+      lookup_.resize(
+        std::max(size_t(handle.id_) + 1, size_t(registry_->capacity())),
+        Index(-1));
+    }
+
+    elements_.emplace_back(std::forward<Args>(args)...);
+    element_handles_.push_back(handle);
+    lookup_[handle.id_] = static_cast<Index>(elements_.size() - 1);
+
+    return true;
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  bool handle_storage_t<T, Tag, Index, Gen>::remove(
+    const typed_handle_t<Tag, Index, Gen> handle)
+  {
+    if (!has(handle)) {
+      return false;
+    }
+
+    // swap the last element with the element being removed and then pop_back
+    using std::swap;
+    const auto lookup = lookup_[handle.id_];
+    swap(elements_[lookup], elements_.back());
+    element_handles_[lookup] = element_handles_.back();
+    lookup_[element_handles_[lookup].id_] = lookup;
+    lookup_[handle.id_] = -1;
+    elements_.pop_back();
+    element_handles_.pop_back();
+
+    return true;
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  bool handle_storage_t<T, Tag, Index, Gen>::has(
+    const typed_handle_t<Tag, Index, Gen> handle) const
+  {
+    // elements are removed as soon as their handle is destroyed, so matching
+    // the stored handle (including its generation) is sufficient
+    return handle.id_ >= 0 && handle.id_ < static_cast<Index>(lookup_.size())
+        && lookup_[handle.id_] != -1
+        && element_handles_[lookup_[handle.id_]] == handle;
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  template<typename Fn>
+  void handle_storage_t<T, Tag, Index, Gen>::call(
+    const typed_handle_t<Tag, Index, Gen> handle, Fn&& fn)
+  {
+    if (has(handle)) {
+      fn(elements_[lookup_[handle.id_]]);
+    }
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  template<typename Fn>
+  void handle_storage_t<T, Tag, Index, Gen>::call(
+    const typed_handle_t<Tag, Index, Gen> handle, Fn&& fn) const
+  {
+    if (has(handle)) {
+      fn(elements_[lookup_[handle.id_]]);
+    }
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  template<typename Fn>
+  decltype(auto) handle_storage_t<T, Tag, Index, Gen>::call_return(
+    const typed_handle_t<Tag, Index, Gen> handle, Fn&& fn)
+  {
+    if (has(handle)) {
+      return std::optional(fn(elements_[lookup_[handle.id_]]));
+    }
+    return std::optional<decltype(fn(std::declval<T&>()))>{};
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  template<typename Fn>
+  decltype(auto) handle_storage_t<T, Tag, Index, Gen>::call_return(
+    const typed_handle_t<Tag, Index, Gen> handle, Fn&& fn) const
+  {
+    if (has(handle)) {
+      return std::optional(fn(elements_[lookup_[handle.id_]]));
+    }
+    return std::optional<decltype(fn(std::declval<const T&>()))>{};
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  Index handle_storage_t<T, Tag, Index, Gen>::size() const
+  {
+    return static_cast<Index>(elements_.size());
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  bool handle_storage_t<T, Tag, Index, Gen>::empty() const
+  {
+    return elements_.empty();
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  void handle_storage_t<T, Tag, Index, Gen>::reserve(const Index capacity)
+  {
+    assert(capacity > 0);
+
+    elements_.reserve(capacity);
+    element_handles_.reserve(capacity);
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  void handle_storage_t<T, Tag, Index, Gen>::clear()
+  {
+    for (const auto& handle : element_handles_) {
+      lookup_[handle.id_] = -1;
+    }
+    elements_.clear();
+    element_handles_.clear();
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  typed_handle_t<Tag, Index, Gen> handle_storage_t<
+    T, Tag, Index, Gen>::handle_from_index(const Index index) const
+  {
+    if (index < 0 || index >= size()) {
+      return {};
+    }
+    return element_handles_[index];
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  std::optional<Index> handle_storage_t<T, Tag, Index, Gen>::index_from_handle(
+    const typed_handle_t<Tag, Index, Gen> handle) const
+  {
+    if (!has(handle)) {
+      return {};
+    }
+    return lookup_[handle.id_];
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  T& handle_storage_t<T, Tag, Index, Gen>::operator[](const Index position)
+  {
+    assert(position >= 0 && position < size());
+    return elements_[position];
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  const T& handle_storage_t<T, Tag, Index, Gen>::operator[](
+    const Index position) const
+  {
+    assert(position >= 0 && position < size());
+    return elements_[position];
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  T* handle_storage_t<T, Tag, Index, Gen>::data()
+  {
+    return elements_.data();
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  const T* handle_storage_t<T, Tag, Index, Gen>::data() const
+  {
+    return elements_.data();
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  auto handle_storage_t<T, Tag, Index, Gen>::begin() -> iterator
+  {
+    return elements_.begin();
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  auto handle_storage_t<T, Tag, Index, Gen>::begin() const -> const_iterator
+  {
+    return elements_.begin();
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  auto handle_storage_t<T, Tag, Index, Gen>::end() -> iterator
+  {
+    return elements_.end();
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  auto handle_storage_t<T, Tag, Index, Gen>::end() const -> const_iterator
+  {
+    return elements_.end();
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  template<typename Fn>
+  void handle_storage_t<T, Tag, Index, Gen>::for_each(Fn&& fn)
+  {
+    for (size_t i = 0; i < elements_.size(); i++) {
+      fn(element_handles_[i], elements_[i]);
+    }
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  template<typename Fn>
+  void handle_storage_t<T, Tag, Index, Gen>::for_each(Fn&& fn) const
+  {
+    for (size_t i = 0; i < elements_.size(); i++) {
+      fn(element_handles_[i], elements_[i]);
+    }
+  }
+} // namespace thh
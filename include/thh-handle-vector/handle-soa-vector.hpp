@@ -0,0 +1,173 @@
+#pragma once
+
+#include "handle-vector.hpp"
+
+#include <tuple>
+
+namespace thh
+{
+  // forward declare handle_soa_vector_t
+  template<typename Tag, typename Index, typename Gen, typename... Ts>
+  class handle_soa_vector_t;
+
+  // forward declare debug_handles friend function
+  template<typename Tag, typename Index, typename Gen, typename... Ts>
+  [[nodiscard]] std::string debug_handles(
+    const handle_soa_vector_t<Tag, Index, Gen, Ts...>& handle_soa_vector);
+
+  // non-owning view of a single tightly packed column of elements
+  // note: invalidated by any operation that adds, removes or reorders elements
+  template<typename T, typename Index>
+  class column_t
+  {
+    T* data_ = nullptr;
+    Index size_ = 0;
+
+  public:
+    using iterator = T*;
+    using value_type = std::remove_const_t<T>;
+    using reference = T&;
+
+    column_t() = default;
+    column_t(T* data, const Index size) : data_(data), size_(size) {}
+
+    // returns the number of elements in the column
+    [[nodiscard]] Index size() const { return size_; }
+    // returns if the column has any elements or not
+    [[nodiscard]] bool empty() const { return size_ == 0; }
+    // returns a pointer to the first element in the column
+    T* data() const { return data_; }
+    // returns an iterator to the beginning of the column
+    T* begin() const { return data_; }
+    // returns an iterator to the end of the column
+    T* end() const { return data_ + size_; }
+    // returns a reference to the element at position
+    // note: position must be in range (0 <= position < size)
+    T& operator[](const Index position) const
+    {
+      assert(position >= 0 && position < size_);
+      return data_[position];
+    }
+  };
+
+  // storage for elements made up of several types (columns) where each column
+  // is stored in its own tightly packed vector (structure of arrays)
+  // a single handle returned from add() refers to a value in every column
+  // note: provide a custom tag to create a type-safe container-handle pair
+  template<typename Tag, typename Index, typename Gen, typename... Ts>
+  class handle_soa_vector_t
+  {
+    static_assert(sizeof...(Ts) > 0, "At least one column type is required.");
+
+    // backing containers for each column (vectors remain tightly packed)
+    std::tuple<std::vector<Ts>...> columns_;
+    // mapping from handles to elements (and elements back to handles)
+    detail::handle_table_t<Tag, Index, Gen> handles_;
+
+    // invokes fn on each column vector in turn
+    template<typename Fn>
+    void for_each_column(Fn&& fn);
+    // returns the capacity of element storage (all columns grow together)
+    [[nodiscard]] size_t element_capacity() const;
+
+  public:
+    // type of the column at position I
+    template<std::size_t I>
+    using column_type = std::tuple_element_t<I, std::tuple<Ts...>>;
+
+    // creates an element in-place in each column and returns a handle to it
+    // note: either pass no args (all values are default constructed) or one
+    // arg per column (passed directly to the column type constructor)
+    template<typename... Args>
+    [[nodiscard]] typed_handle_t<Tag, Index, Gen> add(Args&&... args);
+    // invokes a callable object (usually a lambda) with a reference to the
+    // value in each column for a particular element in the container
+    template<typename Fn>
+    void call(typed_handle_t<Tag, Index, Gen> handle, Fn&& fn);
+    // invokes a callable object (usually a lambda) with a reference to the
+    // value in each column for a particular element in the container (const
+    // overload)
+    template<typename Fn>
+    void call(typed_handle_t<Tag, Index, Gen> handle, Fn&& fn) const;
+    // invokes a callable object (usually a lambda) on a particular element in
+    // the container and returns a std::optional containing either the result
+    // or an empty optional (as the handle may not have been successfully
+    // resolved)
+    template<typename Fn>
+    [[nodiscard]] decltype(auto) call_return(
+      typed_handle_t<Tag, Index, Gen> handle, Fn&& fn);
+    // invokes a callable object (usually a lambda) on a particular element in
+    // the container and returns a std::optional containing either the result
+    // or an empty optional (const overload)
+    template<typename Fn>
+    [[nodiscard]] decltype(auto) call_return(
+      typed_handle_t<Tag, Index, Gen> handle, Fn&& fn) const;
+    // removes the element referenced by the handle from every column
+    // returns true if the element was removed, false otherwise
+    bool remove(typed_handle_t<Tag, Index, Gen> handle);
+    // removes the elements referenced by the range of handles
+    // returns the number of elements removed
+    template<typename InputIt>
+    Index remove(InputIt first, InputIt last);
+    // returns if the container still has the element referenced by the handle
+    [[nodiscard]] bool has(typed_handle_t<Tag, Index, Gen> handle) const;
+    // returns the number of elements currently stored in the container
+    [[nodiscard]] Index size() const;
+    // returns the number of available handles
+    [[nodiscard]] Index capacity() const;
+    // reserves underlying memory in every column for the number of elements
+    // specified
+    void reserve(Index capacity);
+    // removes all elements and invalidates all handles
+    void clear();
+    // releases unused capacity in every column, ids and any handles at the
+    // back that have never been used
+    void shrink_to_fit();
+    // returns the bytes reserved for all columns, ids and handles
+    [[nodiscard]] memory_usage_t memory_usage() const;
+    // returns the handle for a value at the given index
+    // note: will return an invalid handle if the index is out of range
+    [[nodiscard]] typed_handle_t<Tag, Index, Gen> handle_from_index(
+      Index index) const;
+    // returns the index (position) of a value for a given handle
+    // note: will return an empty optional if the handle is invalid
+    [[nodiscard]] std::optional<Index> index_from_handle(
+      typed_handle_t<Tag, Index, Gen> handle) const;
+    // returns if the container has any elements or not
+    [[nodiscard]] bool empty() const;
+    // returns a view of all values in the column at position I
+    template<std::size_t I>
+    [[nodiscard]] auto column() -> column_t<column_type<I>, Index>;
+    // returns a const view of all values in the column at position I
+    template<std::size_t I>
+    [[nodiscard]] auto column() const -> column_t<const column_type<I>, Index>;
+    // invokes a callable object with a reference to the value in each column
+    // for every element in the container (in order)
+    template<typename Fn>
+    void for_each(Fn&& fn);
+    // invokes a callable object with a const reference to the value in each
+    // column for every element in the container (in order)
+    template<typename Fn>
+    void for_each(Fn&& fn) const;
+    // sorts elements in the container according to the provided comparison
+    // note: compare is passed the indices of the elements to compare
+    template<typename Compare>
+    void sort(Compare&& compare);
+    // sorts elements in the container in the specified range according to the
+    // provided comparison
+    // begin - inclusive, end - exclusive
+    template<typename Compare>
+    void sort(Index begin, Index end, Compare&& compare);
+    // partitions elements in the container according to the provided predicate
+    // returns index of the first element for the second group
+    template<typename Predicate>
+    Index partition(Predicate&& predicate);
+
+    // returns an ascii representation of the currently allocated handles
+    // (useful for debugging purposes)
+    friend std::string debug_handles<Tag, Index, Gen, Ts...>(
+      const handle_soa_vector_t<Tag, Index, Gen, Ts...>& handle_soa_vector);
+  };
+} // namespace thh
+
+#include "handle-soa-vector.inl"
@@ -0,0 +1,302 @@
+namespace thh
+{
+  template<typename Tag, typename Index, typename Gen, typename... Ts>
+  template<typename Fn>
+  void handle_soa_vector_t<Tag, Index, Gen, Ts...>::for_each_column(Fn&& fn)
+  {
+    std::apply([&fn](auto&... columns) { (fn(columns), ...); }, columns_);
+  }
+
+  template<typename Tag, typename Index, typename Gen, typename... Ts>
+  size_t handle_soa_vector_t<Tag, Index, Gen, Ts...>::element_capacity() const
+  {
+    return std::get<0>(columns_).capacity();
+  }
+
+  template<typename Tag, typename Index, typename Gen, typename... Ts>
+  template<typename... Args>
+  typed_handle_t<Tag, Index, Gen> handle_soa_vector_t<
+    Tag, Index, Gen, Ts...>::add(Args&&... args)
+  {
+    static_assert(
+      sizeof...(Args) == 0 || sizeof...(Args) == sizeof...(Ts),
+      "Either no args or one arg per column must be provided.");
+
+    // allocate new element in each column
+    if constexpr (sizeof...(Args) == 0) {
+      for_each_column([](auto& column) { column.emplace_back(); });
+    } else {
+      std::apply(
+        [&args...](auto&... columns) {
+          (columns.emplace_back(std::forward<Args>(args)), ...);
+        },
+        columns_);
+    }
+
+    return handles_.add(element_capacity());
+  }
+
+  template<typename Tag, typename Index, typename Gen, typename... Ts>
+  template<typename Fn>
+  void handle_soa_vector_t<Tag, Index, Gen, Ts...>::call(
+    const typed_handle_t<Tag, Index, Gen> handle, Fn&& fn)
+  {
+    if (has(handle)) {
+      const auto lookup = handles_.lookup(handle);
+      std::apply(
+        [&fn, lookup](auto&... columns) { fn(columns[lookup]...); },
+        columns_);
+    }
+  }
+
+  template<typename Tag, typename Index, typename Gen, typename... Ts>
+  template<typename Fn>
+  void handle_soa_vector_t<Tag, Index, Gen, Ts...>::call(
+    const typed_handle_t<Tag, Index, Gen> handle, Fn&& fn) const
+  {
+    if (has(handle)) {
+      const auto lookup = handles_.lookup(handle);
+      std::apply(
+        [&fn, lookup](const auto&... columns) { fn(columns[lookup]...); },
+        columns_);
+    }
+  }
+
+  template<typename Tag, typename Index, typename Gen, typename... Ts>
+  template<typename Fn>
+  decltype(auto) handle_soa_vector_t<Tag, Index, Gen, Ts...>::call_return(
+    const typed_handle_t<Tag, Index, Gen> handle, Fn&& fn)
+  {
+    if (has(handle)) {
+      const auto lookup = handles_.lookup(handle);
+      return std::apply(
+        [&fn, lookup](auto&... columns) {
+          return std::optional(fn(columns[lookup]...));
+        },
+        columns_);
+    }
+    return std::optional<decltype(fn(std::declval<Ts&>()...))>{};
+  }
+
+  template<typename Tag, typename Index, typename Gen, typename... Ts>
+  template<typename Fn>
+  decltype(auto) handle_soa_vector_t<Tag, Index, Gen, Ts...>::call_return(
+    const typed_handle_t<Tag, Index, Gen> handle, Fn&& fn) const
+  {
+    if (has(handle)) {
+      const auto lookup = handles_.lookup(handle);
+      return std::apply(
+        [&fn, lookup](const auto&... columns) {
+          return std::optional(fn(columns[lookup]...));
+        },
+        columns_);
+    }
+    return std::optional<decltype(fn(std::declval<const Ts&>()...))>{};
+  }
+
+  template<typename Tag, typename Index, typename Gen, typename... Ts>
+  bool handle_soa_vector_t<Tag, Index, Gen, Ts...>::remove(
+    const typed_handle_t<Tag, Index, Gen> handle)
+  {
+    if (!has(handle)) {
+      return false;
+    }
+
+    // swap the last element with the element being removed in every column
+    // and then pop_back
+    const auto lookup = handles_.remove(handle);
+    for_each_column([lookup](auto& column) {
+      using std::swap;
+      swap(column[lookup], column.back());
+      column.pop_back();
+    });
+
+    return true;
+  }
+
+  template<typename Tag, typename Index, typename Gen, typename... Ts>
+  template<typename InputIt>
+  Index handle_soa_vector_t<Tag, Index, Gen, Ts...>::remove(
+    InputIt first, InputIt last)
+  {
+    const auto removed = handles_.remove(
+      first, last, [this](const Index lhs, const Index rhs) {
+        for_each_column([lhs, rhs](auto& column) {
+          using std::swap;
+          swap(column[lhs], column[rhs]);
+        });
+      });
+    const auto remaining = handles_.size();
+    for_each_column([remaining](auto& column) {
+      column.erase(column.begin() + remaining, column.end());
+    });
+
+    return removed;
+  }
+
+  template<typename Tag, typename Index, typename Gen, typename... Ts>
+  bool handle_soa_vector_t<Tag, Index, Gen, Ts...>::has(
+    const typed_handle_t<Tag, Index, Gen> handle) const
+  {
+    return handles_.has(handle);
+  }
+
+  template<typename Tag, typename Index, typename Gen, typename... Ts>
+  Index handle_soa_vector_t<Tag, Index, Gen, Ts...>::size() const
+  {
+    assert(
+      std::get<0>(columns_).size() == static_cast<size_t>(handles_.size()));
+    return handles_.size();
+  }
+
+  template<typename Tag, typename Index, typename Gen, typename... Ts>
+  Index handle_soa_vector_t<Tag, Index, Gen, Ts...>::capacity() const
+  {
+    return handles_.capacity();
+  }
+
+  template<typename Tag, typename Index, typename Gen, typename... Ts>
+  void handle_soa_vector_t<Tag, Index, Gen, Ts...>::reserve(
+    const Index capacity)
+  {
+    assert(capacity > 0);
+
+    for_each_column([capacity](auto& column) { column.reserve(capacity); });
+    handles_.reserve(element_capacity());
+  }
+
+  template<typename Tag, typename Index, typename Gen, typename... Ts>
+  void handle_soa_vector_t<Tag, Index, Gen, Ts...>::clear()
+  {
+    for_each_column([](auto& column) { column.clear(); });
+    handles_.clear();
+  }
+
+  template<typename Tag, typename Index, typename Gen, typename... Ts>
+  void handle_soa_vector_t<Tag, Index, Gen, Ts...>::shrink_to_fit()
+  {
+    for_each_column([](auto& column) { column.shrink_to_fit(); });
+    handles_.shrink_to_fit();
+  }
+
+  template<typename Tag, typename Index, typename Gen, typename... Ts>
+  memory_usage_t handle_soa_vector_t<Tag, Index, Gen, Ts...>::memory_usage()
+    const
+  {
+    auto memory_usage = handles_.memory_usage();
+    std::apply(
+      [&memory_usage](const auto&... columns) {
+        memory_usage.element_bytes_ =
+          ((columns.capacity() * sizeof(columns[0])) + ...);
+      },
+      columns_);
+    return memory_usage;
+  }
+
+  template<typename Tag, typename Index, typename Gen, typename... Ts>
+  typed_handle_t<Tag, Index, Gen> handle_soa_vector_t<
+    Tag, Index, Gen, Ts...>::handle_from_index(const Index index) const
+  {
+    return handles_.handle_from_index(index);
+  }
+
+  template<typename Tag, typename Index, typename Gen, typename... Ts>
+  std::optional<Index> handle_soa_vector_t<Tag, Index, Gen, Ts...>::
+    index_from_handle(const typed_handle_t<Tag, Index, Gen> handle) const
+  {
+    return handles_.index_from_handle(handle);
+  }
+
+  template<typename Tag, typename Index, typename Gen, typename... Ts>
+  bool handle_soa_vector_t<Tag, Index, Gen, Ts...>::empty() const
+  {
+    return size() == 0;
+  }
+
+  template<typename Tag, typename Index, typename Gen, typename... Ts>
+  template<std::size_t I>
+  auto handle_soa_vector_t<Tag, Index, Gen, Ts...>::column()
+    -> column_t<column_type<I>, Index>
+  {
+    return {std::get<I>(columns_).data(), size()};
+  }
+
+  template<typename Tag, typename Index, typename Gen, typename... Ts>
+  template<std::size_t I>
+  auto handle_soa_vector_t<Tag, Index, Gen, Ts...>::column() const
+    -> column_t<const column_type<I>, Index>
+  {
+    return {std::get<I>(columns_).data(), size()};
+  }
+
+  template<typename Tag, typename Index, typename Gen, typename... Ts>
+  template<typename Fn>
+  void handle_soa_vector_t<Tag, Index, Gen, Ts...>::for_each(Fn&& fn)
+  {
+    std::apply(
+      [&fn, count = size()](auto&... columns) {
+        for (Index i = 0; i < count; i++) {
+          fn(columns[i]...);
+        }
+      },
+      columns_);
+  }
+
+  template<typename Tag, typename Index, typename Gen, typename... Ts>
+  template<typename Fn>
+  void handle_soa_vector_t<Tag, Index, Gen, Ts...>::for_each(Fn&& fn) const
+  {
+    std::apply(
+      [&fn, count = size()](const auto&... columns) {
+        for (Index i = 0; i < count; i++) {
+          fn(columns[i]...);
+        }
+      },
+      columns_);
+  }
+
+  template<typename Tag, typename Index, typename Gen, typename... Ts>
+  template<typename Compare>
+  void handle_soa_vector_t<Tag, Index, Gen, Ts...>::sort(Compare&& compare)
+  {
+    sort(Index(0), size(), std::forward<Compare>(compare));
+  }
+
+  template<typename Tag, typename Index, typename Gen, typename... Ts>
+  template<typename Compare>
+  void handle_soa_vector_t<Tag, Index, Gen, Ts...>::sort(
+    const Index begin, const Index end, Compare&& compare)
+  {
+    const auto range = std::min(size() - begin, end - begin);
+    auto* indices = handles_.scratch_positions(begin, range);
+    std::sort(indices, indices + range, std::forward<Compare>(compare));
+    std::apply(
+      [this, begin, range, &indices](auto&... columns) {
+        handles_.permute(begin, begin + range, indices, columns.begin()...);
+      },
+      columns_);
+  }
+
+  template<typename Tag, typename Index, typename Gen, typename... Ts>
+  template<typename Predicate>
+  Index handle_soa_vector_t<Tag, Index, Gen, Ts...>::partition(
+    Predicate&& predicate)
+  {
+    auto* indices = handles_.scratch_positions(Index(0), size());
+    const auto second = std::partition(
+      indices, indices + size(), std::forward<Predicate>(predicate));
+    std::apply(
+      [this, &indices](auto&... columns) {
+        handles_.permute(Index(0), size(), indices, columns.begin()...);
+      },
+      columns_);
+    return Index(second - indices);
+  }
+
+  template<typename Tag, typename Index, typename Gen, typename... Ts>
+  std::string debug_handles(
+    const handle_soa_vector_t<Tag, Index, Gen, Ts...>& handle_soa_vector)
+  {
+    return handle_soa_vector.handles_.debug_string();
+  }
+} // namespace thh
@@ -1,26 +1,55 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
+#include <bitset>
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <istream>
 #include <limits>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <new>
 #include <numeric>
 #include <optional>
+#include <ostream>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <type_traits>
 #include <utility>
 #include <vector>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#endif
+
 namespace thh
 {
   // forward declare handle_vector_t
-  template<typename T, typename Tag, typename Index, typename Gen>
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
   class handle_vector_t;
 
   // forward declare debug_handles friend function
-  template<typename T, typename Tag, typename Index, typename Gen>
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
   [[nodiscard]] std::string debug_handles(
-    const handle_vector_t<T, Tag, Index, Gen>& handle_vector);
+    const handle_vector_t<T, Tag, Index, Gen, Allocator>& handle_vector);
 
   // default tag to circumvent type safety
   struct default_tag_t
@@ -74,44 +103,684 @@ namespace thh
 
   using handle_t = typed_handle_t<default_tag_t, int32_t, int32_t>;
 
+  // requests that an operation (e.g. sort) is split across several threads
+  // note: a thread count of zero uses std::thread::hardware_concurrency
+  struct parallel_t
+  {
+    int32_t thread_count_ = 0;
+  };
+
+  // bytes of memory reserved by a container (based on capacity, not size)
+  struct memory_usage_t
+  {
+    size_t element_bytes_ = 0; // element storage
+    // element ids (tombstone bitmap, sort scratch and change tracking)
+    size_t id_bytes_ = 0;
+    size_t handle_bytes_ = 0; // internal handles
+
+    // returns the combined size of elements, ids and handles
+    [[nodiscard]] size_t total_bytes() const
+    {
+      return element_bytes_ + id_bytes_ + handle_bytes_;
+    }
+  };
+
+  namespace detail
+  {
+    // largest index and generation handles for a container with Tag may use,
+    // a handle is retired once its generation reaches max_gen
+    // note: specialized for containers that store handles in fewer bits (see
+    // packed-handle.hpp)
+    template<typename Tag, typename Index, typename Gen>
+    struct handle_limits_t
+    {
+      static constexpr Index max_index = std::numeric_limits<Index>::max();
+      static constexpr Gen max_gen = std::numeric_limits<Gen>::max();
+    };
+
+    // callable that accepts and ignores any arguments (the default for
+    // optional callbacks)
+    struct ignore_t
+    {
+      template<typename... Args>
+      void operator()(const Args&...) const
+      {
+      }
+    };
+
+    // elements small and trivial enough to be moved directly while sorting
+    // (instead of sorting indices and permuting the elements afterwards)
+    template<typename T>
+    constexpr bool cheap_to_swap_v =
+      std::is_trivially_copyable_v<T> && sizeof(T) <= 16;
+
+    // elements that can be gathered into their new positions by copying
+    // their bytes through reusable storage while reordering
+    template<typename T>
+    constexpr bool copy_gatherable_v =
+      std::is_trivially_copyable_v<T>
+      && alignof(T) <= alignof(std::max_align_t);
+
+    // random access iterator over an element and its id, moving one moves
+    // both (allows sorting elements and ids together with no indirection)
+    template<typename T, typename Index>
+    class zip_iterator_t
+    {
+      T* element_ = nullptr;
+      Index* id_ = nullptr;
+
+    public:
+      using iterator_category = std::random_access_iterator_tag;
+      using difference_type = std::ptrdiff_t;
+      using value_type = std::pair<T, Index>;
+      using pointer = void;
+
+      // proxy to an element and its id that assigns and swaps through to
+      // the underlying values
+      struct reference
+      {
+        T& element_;
+        Index& id_;
+
+        reference& operator=(const reference& other)
+        {
+          element_ = other.element_;
+          id_ = other.id_;
+          return *this;
+        }
+        reference& operator=(value_type&& value)
+        {
+          element_ = std::move(value.first);
+          id_ = value.second;
+          return *this;
+        }
+        operator value_type() const { return {element_, id_}; }
+
+        friend void swap(const reference lhs, const reference rhs)
+        {
+          using std::swap;
+          swap(lhs.element_, rhs.element_);
+          swap(lhs.id_, rhs.id_);
+        }
+      };
+
+      zip_iterator_t() = default;
+      zip_iterator_t(T* element, Index* id) : element_(element), id_(id) {}
+
+      // returns the element of a value or reference (for comparisons)
+      static const T& element(const reference& ref) { return ref.element_; }
+      static const T& element(const value_type& value) { return value.first; }
+
+      reference operator*() const { return {*element_, *id_}; }
+      reference operator[](const difference_type n) const
+      {
+        return {element_[n], id_[n]};
+      }
+      zip_iterator_t& operator++()
+      {
+        ++element_;
+        ++id_;
+        return *this;
+      }
+      zip_iterator_t operator++(int)
+      {
+        auto it = *this;
+        ++*this;
+        return it;
+      }
+      zip_iterator_t& operator--()
+      {
+        --element_;
+        --id_;
+        return *this;
+      }
+      zip_iterator_t operator--(int)
+      {
+        auto it = *this;
+        --*this;
+        return it;
+      }
+      zip_iterator_t& operator+=(const difference_type n)
+      {
+        element_ += n;
+        id_ += n;
+        return *this;
+      }
+      zip_iterator_t& operator-=(const difference_type n)
+      {
+        return *this += -n;
+      }
+      friend zip_iterator_t operator+(zip_iterator_t it, difference_type n)
+      {
+        return it += n;
+      }
+      friend zip_iterator_t operator+(difference_type n, zip_iterator_t it)
+      {
+        return it += n;
+      }
+      friend zip_iterator_t operator-(zip_iterator_t it, difference_type n)
+      {
+        return it -= n;
+      }
+      friend difference_type operator-(
+        const zip_iterator_t& lhs, const zip_iterator_t& rhs)
+      {
+        return lhs.id_ - rhs.id_;
+      }
+      friend bool operator==(
+        const zip_iterator_t& lhs, const zip_iterator_t& rhs)
+      {
+        return lhs.id_ == rhs.id_;
+      }
+      friend bool operator!=(
+        const zip_iterator_t& lhs, const zip_iterator_t& rhs)
+      {
+        return lhs.id_ != rhs.id_;
+      }
+      friend bool operator<(
+        const zip_iterator_t& lhs, const zip_iterator_t& rhs)
+      {
+        return lhs.id_ < rhs.id_;
+      }
+      friend bool operator>(
+        const zip_iterator_t& lhs, const zip_iterator_t& rhs)
+      {
+        return lhs.id_ > rhs.id_;
+      }
+      friend bool operator<=(
+        const zip_iterator_t& lhs, const zip_iterator_t& rhs)
+      {
+        return lhs.id_ <= rhs.id_;
+      }
+      friend bool operator>=(
+        const zip_iterator_t& lhs, const zip_iterator_t& rhs)
+      {
+        return lhs.id_ >= rhs.id_;
+      }
+    };
+
+    // generations and the free list of handles, shared by handle_table_t
+    // (which binds each handle in use to an element) and handle_registry_t
+    // (which hands out handles independently of any elements)
+    // note: freed handles are reused in the order they were freed, handles
+    // whose generation has reached its limit are skipped (depleted)
+    template<
+      typename Tag, typename Index, typename Gen,
+      typename Allocator = std::allocator<Index>>
+    class handle_pool_t
+    {
+      template<typename, typename, typename, typename>
+      friend class handle_table_t;
+
+    public:
+      // generation of a handle and what it refers to while it is in use
+      // (chosen by the owner), maintains a reference to the next free handle
+      struct internal_handle_t
+      {
+        Gen gen_ = -1; // generation of handle to be looked up
+        // value bound to the handle while it is in use (never negative),
+        // otherwise the index of the next available handle bitwise negated
+        // (always negative so a free handle never resolves)
+        Index lookup_ = -1;
+
+        [[nodiscard]] Index next() const { return ~lookup_; }
+        void set_next(const Index index) { lookup_ = ~index; }
+      };
+
+      // the lookup and the free list link share a field so an internal handle
+      // is no larger than an external one (sizeof(Index) + sizeof(Gen) when
+      // both are the same width)
+      static_assert(
+        sizeof(internal_handle_t) == sizeof(typed_handle_t<Tag, Index, Gen>));
+      static_assert(
+        sizeof(Index) != sizeof(Gen)
+        || sizeof(internal_handle_t) == sizeof(Index) + sizeof(Gen));
+
+    private:
+      using limits_t = handle_limits_t<Tag, Index, Gen>;
+      using handle_allocator_t = typename std::allocator_traits<
+        Allocator>::template rebind_alloc<internal_handle_t>;
+
+      // generation and lookup (or free list link) of every handle
+      std::vector<internal_handle_t, handle_allocator_t> handles_;
+      // index of the next handle to be allocated and the last handle freed
+      // (the free list is empty when dequeue_ is one past the last handle)
+      Index dequeue_ = 0;
+      Index enqueue_ = 0;
+      // number of handles that are depleted (generation is at its limit)
+      Index depleted_handles_ = 0;
+
+    public:
+      handle_pool_t() = default;
+      // uses a copy of allocator (rebound) for internal handles
+      explicit handle_pool_t(const Allocator& allocator);
+
+      // increases the number of handles so at least count are not depleted
+      // (new handles are appended to the free list)
+      void try_allocate_handles(size_t count);
+      // binds lookup to the next available handle (skipping any handles that
+      // have been depleted) and advances its generation, handles are created
+      // first so at least count are not depleted
+      // returns the id of the handle
+      [[nodiscard]] Index allocate(size_t count, Index lookup);
+      // binds n consecutive lookups (starting from first_lookup) to the next
+      // available handles in turn, handles are created once up front so at
+      // least count are not depleted
+      // ids - the id of each handle (must have space for n ids)
+      void allocate_n(size_t count, Index first_lookup, Index n, Index* ids);
+      // returns a handle to the back of the free list so it may be reused
+      void free_handle(Index id);
+      // returns if the handle is in use and its generation matches
+      [[nodiscard]] bool has(typed_handle_t<Tag, Index, Gen> handle) const;
+      // frees all handles (generations are kept so existing handles never
+      // become valid again)
+      void clear();
+      // releases any handles at the back that have never been used (handles
+      // that have been used keep their generation) and unused memory
+      void shrink_to_fit();
+      // reserves memory for the number of handles specified
+      void reserve(size_t capacity);
+      // exchanges handles and the free list with other
+      void swap(handle_pool_t& other) noexcept;
+      // returns if generations and the free list are consistent with each
+      // other (every free handle is either on the free list or depleted)
+      [[nodiscard]] bool valid() const;
+      // returns the number of handles
+      [[nodiscard]] size_t size() const;
+      // returns if there are no handles
+      [[nodiscard]] bool empty() const;
+      // returns the number of handles memory is reserved for
+      [[nodiscard]] size_t capacity() const;
+      // returns a pointer to the underlying internal handles
+      [[nodiscard]] const internal_handle_t* data() const;
+      // returns the internal handle with id
+      // note: id must be in range (0 <= id < size)
+      internal_handle_t& operator[](Index id);
+      // returns the internal handle with id (const overload)
+      const internal_handle_t& operator[](Index id) const;
+    };
+
+    // bookkeeping shared by the handle containers
+    // maps external handles to the position of elements in tightly packed
+    // storage (and from elements back to their handles)
+    // note: the owning container is responsible for the element storage, which
+    // must be kept in sync with element ids
+    template<
+      typename Tag, typename Index, typename Gen,
+      typename Allocator = std::allocator<Index>>
+    class handle_table_t
+    {
+      using pool_t = handle_pool_t<Tag, Index, Gen, Allocator>;
+      // internal mapping from external handle to internal element (the
+      // lookup is the position of the element)
+      using internal_handle_t = typename pool_t::internal_handle_t;
+
+      using limits_t = handle_limits_t<Tag, Index, Gen>;
+      using allocator_traits = std::allocator_traits<Allocator>;
+      using id_allocator_t =
+        typename allocator_traits::template rebind_alloc<Index>;
+      using live_allocator_t =
+        typename allocator_traits::template rebind_alloc<uint64_t>;
+      // unit of the storage elements are gathered into while reordering
+      // (aligned for any element that is not over-aligned)
+      struct gather_block_t
+      {
+        alignas(std::max_align_t)
+          unsigned char bytes_[alignof(std::max_align_t)];
+      };
+      using gather_allocator_t =
+        typename allocator_traits::template rebind_alloc<gather_block_t>;
+
+      // parallel vector of ids that map from elements back to the
+      // corresponding handle
+      std::vector<Index, id_allocator_t> element_ids_;
+      // sparse vector of handles to elements (and the free list)
+      pool_t handles_;
+      // bitmap of element positions that are not tombstones (only allocated
+      // while tombstones are waiting to be compacted)
+      std::vector<uint64_t, live_allocator_t> live_;
+      // number of elements removed with remove_deferred not yet compacted
+      Index tombstones_ = 0;
+      // storage for the indices used while sorting and partitioning (kept
+      // between calls so reordering does not allocate once it has grown)
+      std::vector<Index, id_allocator_t> scratch_;
+      // storage for the keys used while radix sorting (kept between calls)
+      std::vector<uint64_t, live_allocator_t> key_scratch_;
+      // storage for the elements (and ids) gathered into their new positions
+      // while reordering (kept between calls)
+      std::vector<gather_block_t, gather_allocator_t> gather_scratch_;
+
+      // returns if ids, handles, the free list and tombstones are consistent
+      // with each other (used to reject corrupted streams when loading)
+      [[nodiscard]] bool valid() const;
+#if defined(__AVX2__)
+      // resolves handles eight at a time using AVX2 gathers (only available
+      // when Index and Gen are both 32 bit), returns the number of handles
+      // processed
+      Index indices_from_handles_avx2(
+        const typed_handle_t<Tag, Index, Gen>* handles, Index count,
+        Index* indices, Index& resolved) const;
+      // writes handles for elements eight at a time using AVX2 gathers (only
+      // available when Index and Gen are both 32 bit), returns the number of
+      // handles written
+      Index handles_at_avx2(
+        Index first, Index count,
+        typed_handle_t<Tag, Index, Gen>* handles) const;
+#endif
+
+    public:
+      handle_table_t() = default;
+      // uses a copy of allocator (rebound) for ids and internal handles
+      explicit handle_table_t(const Allocator& allocator);
+
+      // binds a newly added element (at the back of element storage) to the
+      // next available handle (skipping any handles that have been depleted)
+      // note: element_capacity is the capacity of element storage after the
+      // element was added
+      [[nodiscard]] typed_handle_t<Tag, Index, Gen> add(
+        size_t element_capacity);
+      // binds count newly added elements (at the back of element storage) to
+      // the next available handles, writing each handle to the output
+      // iterator
+      // returns the output iterator one past the last handle written
+      template<typename OutputIt>
+      OutputIt add_n(size_t element_capacity, Index count, OutputIt handles);
+      // frees the handle and moves the id of the last element into the
+      // position of the element being removed
+      // returns the position of the removed element (the owning container
+      // must swap the last element into it and pop the back)
+      // note: handle must be valid (has(handle) returns true)
+      Index remove(typed_handle_t<Tag, Index, Gen> handle);
+      // frees the range of handles and compacts element ids in a single pass
+      // swap_elements(lhs, rhs) is invoked for each element moved, after which
+      // the owning container must erase the elements past the new size
+      // removed(handle, position) is invoked for each handle before it is
+      // freed
+      // returns the number of elements removed
+      template<
+        typename InputIt, typename SwapElements, typename Removed = ignore_t>
+      Index remove(
+        InputIt first, InputIt last, SwapElements&& swap_elements,
+        Removed&& removed = Removed());
+      // frees the handle and marks the element it referenced as a tombstone
+      // (element positions do not change until compact is called)
+      // note: handle must be valid (has(handle) returns true)
+      void remove_deferred(typed_handle_t<Tag, Index, Gen> handle);
+      // returns the number of tombstones waiting to be compacted
+      [[nodiscard]] Index tombstones() const;
+      // invokes fn with the position of each element that is not a tombstone
+      template<typename Fn>
+      void for_each_live(Fn&& fn) const;
+      // removes all tombstones in a single pass, move_element(to, from) is
+      // invoked for each live element that moves, after which the owning
+      // container must erase the elements past the new size
+      template<typename MoveElement>
+      void compact(MoveElement&& move_element);
+      // frees the handle and shifts the ids of all following elements down by
+      // one (preserving their order)
+      // returns the position of the removed element (the owning container
+      // must erase the element at that position)
+      // note: handle must be valid (has(handle) returns true)
+      Index erase_stable(typed_handle_t<Tag, Index, Gen> handle);
+      // frees the range of handles and shifts the remaining ids down in a
+      // single pass (preserving their order), move_element(to, from) is
+      // invoked for each element moved, after which the owning container must
+      // erase the elements past the new size, removed(handle, position) is
+      // invoked for each handle before it is freed
+      // returns the number of elements removed
+      template<
+        typename InputIt, typename MoveElement, typename Removed = ignore_t>
+      Index erase_stable(
+        InputIt first, InputIt last, MoveElement&& move_element,
+        Removed&& removed = Removed());
+      // returns if the handle references a valid element
+      [[nodiscard]] bool has(typed_handle_t<Tag, Index, Gen> handle) const;
+      // returns the position of the element referenced by the handle
+      // note: handle must be valid (has(handle) returns true)
+      [[nodiscard]] Index lookup(typed_handle_t<Tag, Index, Gen> handle) const;
+      // returns the number of elements with a handle bound to them
+      [[nodiscard]] Index size() const;
+      // returns the number of allocated handles
+      [[nodiscard]] Index capacity() const;
+      // reserves ids and handles to match the capacity of element storage
+      void reserve(size_t element_capacity);
+      // unbinds all elements and invalidates all handles
+      void clear();
+      // releases unused id capacity and any handles at the back that have
+      // never been used (handles that have been used keep their generation)
+      void shrink_to_fit();
+      // returns the bytes reserved for ids and handles
+      [[nodiscard]] memory_usage_t memory_usage() const;
+      // returns the handle for a value at the given index
+      [[nodiscard]] typed_handle_t<Tag, Index, Gen> handle_from_index(
+        Index index) const;
+      // returns the handle bound to the element at position (an invalid handle
+      // for a tombstone)
+      // note: position must be in range (0 <= position < size)
+      [[nodiscard]] typed_handle_t<Tag, Index, Gen> handle_at(
+        Index position) const;
+      // returns the id of the handle bound to each element in order (-1 for a
+      // tombstone)
+      [[nodiscard]] const Index* element_ids() const;
+      // returns the current generation of the handle with id
+      // note: id must be in range (0 <= id < capacity)
+      [[nodiscard]] Gen generation(Index id) const;
+      // writes the handle bound to each element in [first, first + count) to
+      // handles (an invalid handle for a tombstone)
+      void handles_at(
+        Index first, Index count,
+        typed_handle_t<Tag, Index, Gen>* handles) const;
+      // returns the index (position) of a value for a given handle
+      [[nodiscard]] std::optional<Index> index_from_handle(
+        typed_handle_t<Tag, Index, Gen> handle) const;
+      // writes the index (position) of each handle to indices, or -1 if the
+      // handle is invalid, returns the number successfully resolved
+      Index indices_from_handles(
+        const typed_handle_t<Tag, Index, Gen>* handles, Index count,
+        Index* indices) const;
+      // reorders element ids (and the elements referenced by iters) in the
+      // range according to indices, updating the handles of elements that
+      // move so they refer to the same value as before
+      // begin - inclusive, end - exclusive
+      template<typename... Iter>
+      void permute(Index begin, Index end, Index* indices, Iter... iters);
+      // reorders element ids (and the elements referenced by iters) in the
+      // range according to indices across several threads and then ensures
+      // handles refer to the same value as before
+      // note: elements are moved into reusable storage and back rather than
+      // swapped in place (over-aligned elements use a temporary buffer)
+      template<typename... Iter>
+      void permute(
+        parallel_t parallel, Index begin, Index end, const Index* indices,
+        Iter... iters);
+      // reorders element ids (and the elements referenced by iters) in the
+      // range according to indices on this thread and then ensures handles
+      // refer to the same value as before
+      // note: trivially copyable values are copied into reusable storage and
+      // back (faster than following permutation cycles when most elements
+      // move), other values are swapped in place as with permute
+      template<typename... Iter>
+      void gather(Index begin, Index end, Index* indices, Iter... iters);
+      // sorts elements (starting at elements) and their ids in the range
+      // together and then ensures handles refer to the same value as before
+      // note: compare is passed references to the elements to compare
+      template<typename T, typename Compare>
+      void sort_elements(
+        Index begin, Index end, T* elements, Compare& compare);
+      // returns reusable storage for count indices (contents unspecified)
+      // note: invalidated by the next call
+      [[nodiscard]] Index* scratch(size_t count);
+      // returns reusable storage for count indices holding the positions
+      // [begin, begin + count)
+      [[nodiscard]] Index* scratch_positions(Index begin, Index count);
+      // returns reusable storage for count radix sort keys (contents
+      // unspecified)
+      // note: invalidated by the next call
+      [[nodiscard]] uint64_t* key_scratch(size_t count);
+      // returns reusable uninitialized storage for count values of type U, or
+      // nullptr if U is over-aligned (the caller must allocate instead)
+      // note: invalidated by the next call
+      template<typename U>
+      [[nodiscard]] void* gather_scratch(size_t count);
+      // sorts the range by swapping adjacent elements into place (insertion
+      // sort), swap_elements(lhs, rhs) is invoked for each swap and only the
+      // handles of elements that move are updated
+      // returns false if more than max_swaps swaps were needed, in which case
+      // the range is left partially sorted (but handles remain valid)
+      template<typename Compare, typename SwapElements>
+      bool insertion_sort(
+        Index begin, Index end, Compare& compare,
+        SwapElements&& swap_elements, size_t max_swaps);
+      // after sorting or partitioning the container, ensures handles refer to
+      // the same value as before
+      // begin - inclusive, end - exclusive
+      void fixup_handles(Index begin, Index end);
+      // exchanges ids and handles with other
+      // note: follows the same allocator propagation rules as std::vector
+      void swap(handle_table_t& other) noexcept;
+      // writes ids, handles and free list state to the stream
+      void save(std::ostream& stream) const;
+      // replaces ids, handles and free list state with those read from the
+      // stream, returns false if the stream could not be read or its contents
+      // are inconsistent (the table must then be reset by the caller)
+      [[nodiscard]] bool load(std::istream& stream);
+      // returns an ascii representation of the currently allocated handles
+      [[nodiscard]] std::string debug_string() const;
+    };
+
+    // changes made to a container since they were last cleared, two bits per
+    // element position (modified and added) that move along with elements
+    // and the handles of elements removed in the meantime
+    // note: every operation does nothing until change tracking is enabled
+    template<
+      typename Tag, typename Index, typename Gen,
+      typename Allocator = std::allocator<Index>>
+    class change_set_t
+    {
+      // handle and bits of a changed element while it is being reordered
+      struct moving_t
+      {
+        typed_handle_t<Tag, Index, Gen> handle_;
+        uint64_t bits_;
+      };
+
+      using allocator_traits = std::allocator_traits<Allocator>;
+      using bits_allocator_t =
+        typename allocator_traits::template rebind_alloc<uint64_t>;
+      using handle_allocator_t = typename allocator_traits::template
+        rebind_alloc<typed_handle_t<Tag, Index, Gen>>;
+      using moving_allocator_t =
+        typename allocator_traits::template rebind_alloc<moving_t>;
+
+      static constexpr uint64_t modified_bit = 1;
+      static constexpr uint64_t added_bit = 2;
+      // low bit of every element (selects the modified bits)
+      static constexpr uint64_t modified_mask = 0x5555555555555555;
+      // high bit of every element (selects the added bits)
+      static constexpr uint64_t added_mask = ~modified_mask;
+
+      // modified and added bits for each element position (covers every
+      // element while enabled, empty otherwise)
+      std::vector<uint64_t, bits_allocator_t> bits_;
+      // handles of elements removed (that were not also added)
+      std::vector<typed_handle_t<Tag, Index, Gen>, handle_allocator_t>
+        removed_;
+      // changed elements in a range that is being reordered
+      std::vector<moving_t, moving_allocator_t> moving_;
+      bool enabled_ = false;
+      // modify records nothing while a range is being reordered (comparators
+      // may use the mutable operator[] and run concurrently)
+      bool paused_ = false;
+
+      // returns the bits of the element at position
+      [[nodiscard]] uint64_t get(Index position) const;
+      // replaces the bits of the element at position
+      void set(Index position, uint64_t bits);
+
+    public:
+      change_set_t() = default;
+      // uses a copy of allocator (rebound) for bits and handles
+      explicit change_set_t(const Allocator& allocator);
+
+      // starts or stops recording changes for a container of size elements
+      // (stopping releases all changes)
+      void enable(bool enabled, Index size);
+      // returns if changes are being recorded
+      [[nodiscard]] bool enabled() const;
+      // records that the element at position was modified (unless paused)
+      void modify(Index position);
+      // stops or resumes recording modifications (stash and restore pause
+      // and resume recording themselves)
+      void pause(bool paused);
+      // records that the element at position was added
+      void add(Index position);
+      // records that count elements starting at position were added
+      void add_n(Index position, Index count);
+      // records that the element referenced by handle (at position) was
+      // removed, unless it was added since changes were last cleared
+      // note: the element is marked as added so removing it again (e.g. from
+      // a range with duplicate handles) is not recorded twice
+      void remove(typed_handle_t<Tag, Index, Gen> handle, Index position);
+      // moves the bits of the element at from to to (e.g. swap-remove)
+      void move(Index to, Index from);
+      // exchanges the bits of the elements at lhs and rhs
+      void exchange(Index lhs, Index rhs);
+      // removes the bits of the element at position, shifting the bits of
+      // all following elements down by one
+      void erase(Index position);
+      // discards the bits of elements at positions size and above
+      void truncate(Index size);
+      // records the handles of changed elements in the range before they are
+      // reordered (restore moves their bits to their new positions) and
+      // pauses recording modifications until restore
+      // begin - inclusive, end - exclusive
+      void stash(
+        const handle_table_t<Tag, Index, Gen, Allocator>& handles, Index begin,
+        Index end);
+      // moves the bits of elements recorded by stash to their new positions
+      // and resumes recording modifications
+      void restore(const handle_table_t<Tag, Index, Gen, Allocator>& handles);
+      // invokes fn with the position of each element modified (and not
+      // added) in element order
+      template<typename Fn>
+      void for_each_modified(Fn&& fn) const;
+      // invokes fn with the position of each element added in element order
+      template<typename Fn>
+      void for_each_added(Fn&& fn) const;
+      // invokes fn with the handle of each element removed
+      template<typename Fn>
+      void for_each_removed(Fn&& fn) const;
+      // forgets all recorded changes for a container of size elements
+      void clear(Index size);
+      // releases unused capacity
+      void shrink_to_fit();
+      // returns the bytes reserved for bits and handles
+      [[nodiscard]] size_t memory_usage() const;
+      // exchanges recorded changes with other
+      void swap(change_set_t& other) noexcept;
+    };
+  } // namespace detail
+
   // storage for type T that is created in-place
   // may be accessed by resolving the returned typed_handle_t from add()
   // note: provide a custom tag to create a type-safe container-handle pair
+  // note: Allocator is used (rebound) for elements, element ids and handles
   template<
     typename T, typename Tag = default_tag_t, typename Index = int32_t,
-    typename Gen = int32_t>
+    typename Gen = int32_t, typename Allocator = std::allocator<T>>
   class handle_vector_t
   {
-    // internal mapping from external handle to internal element
-    // maintains a reference to the next free handle
-    struct internal_handle_t
-    {
-      Gen gen_ = -1; // generation of handle to be looked up
-      Index lookup_ = -1; // mapping to element
-      Index next_ = -1; // index of next available handle
-    };
+    static_assert(
+      std::is_same<typename Allocator::value_type, T>::value,
+      "Allocator::value_type must be the same as T.");
 
     // backing container for elements (vector remains tightly packed)
-    std::vector<T> elements_;
-    // parallel vector of ids that map from elements back to the corresponding
-    // handle
-    std::vector<Index> element_ids_;
-    // sparse vector of handles to elements
-    std::vector<internal_handle_t> handles_;
-
-    // index of the next handle to be allocated
-    Index dequeue_ = 0;
-    Index enqueue_ = 0;
-    // number of handles that are depleted (generation is at its limit)
-    Index depleted_handles_ = 0;
-
-    // increases the number of available handles when the underlying container
-    // of elements (T) grows (the capacity increases)
-    void try_allocate_handles();
-    // after sorting or partitioning the container, ensures handles refer to the
-    // same value as before
-    // begin - inclusive, end - exclusive
-    void fixup_handles(Index begin, Index end);
+    std::vector<T, Allocator> elements_;
+    // mapping from handles to elements (and elements back to handles)
+    detail::handle_table_t<Tag, Index, Gen, Allocator> handles_;
+    // elements modified, added and removed (only while tracking changes)
+    detail::change_set_t<Tag, Index, Gen, Allocator> changes_;
+
     // returns a mutable pointer to the underlying element T referenced by the
     // handle
     [[nodiscard]] T* resolve(typed_handle_t<Tag, Index, Gen> handle);
@@ -119,6 +788,12 @@ namespace thh
     // handle
     [[nodiscard]] const T* resolve(
       typed_handle_t<Tag, Index, Gen> handle) const;
+    // fills scratch storage with the positions in the range, invokes
+    // order(first, last) to rearrange them (e.g. with std::sort) and then
+    // moves elements into that order (only handles of elements that move are
+    // updated)
+    template<typename Order>
+    void reorder(Index begin, Index end, Order&& order);
 
   public:
     using iterator = typename decltype(elements_)::iterator;
@@ -129,12 +804,144 @@ namespace thh
     using value_type = typename decltype(elements_)::value_type;
     using reference = typename decltype(elements_)::reference;
     using const_reference = typename decltype(elements_)::const_reference;
+    using allocator_type = Allocator;
+
+    // forward iterator over (handle, element) pairs in element order,
+    // skipping tombstones
+    // note: dereferencing returns the pair by value (holding a reference to
+    // the element) so it may be used with structured bindings
+    template<typename V>
+    class item_iterator_t
+    {
+      const detail::handle_table_t<Tag, Index, Gen, Allocator>* handles_ =
+        nullptr;
+      // element and its id at the current position (walked in lockstep)
+      V* element_ = nullptr;
+      const Index* id_ = nullptr;
+      const Index* last_id_ = nullptr;
+      // only check for tombstones when there are some to skip
+      bool tombstones_ = false;
+
+      void skip_tombstones()
+      {
+        if (tombstones_) {
+          while (id_ != last_id_ && *id_ == -1) {
+            ++id_;
+            ++element_;
+          }
+        }
+      }
+
+    public:
+      using iterator_category = std::forward_iterator_tag;
+      using value_type = std::pair<typed_handle_t<Tag, Index, Gen>, V&>;
+      using difference_type = std::ptrdiff_t;
+      using pointer = void;
+      using reference = value_type;
+
+      item_iterator_t() = default;
+      item_iterator_t(
+        const detail::handle_table_t<Tag, Index, Gen, Allocator>* handles,
+        V* elements, const Index position)
+        : handles_(handles),
+          element_(elements + position),
+          id_(handles->element_ids() + position),
+          last_id_(handles->element_ids() + handles->size()),
+          tombstones_(handles->tombstones() > 0)
+      {
+        skip_tombstones();
+      }
+
+      reference operator*() const
+      {
+        return {{*id_, handles_->generation(*id_)}, *element_};
+      }
+      item_iterator_t& operator++()
+      {
+        ++id_;
+        ++element_;
+        skip_tombstones();
+        return *this;
+      }
+      item_iterator_t operator++(int)
+      {
+        auto it = *this;
+        ++*this;
+        return it;
+      }
+      friend bool operator==(
+        const item_iterator_t& lhs, const item_iterator_t& rhs)
+      {
+        return lhs.id_ == rhs.id_;
+      }
+      friend bool operator!=(
+        const item_iterator_t& lhs, const item_iterator_t& rhs)
+      {
+        return !(lhs == rhs);
+      }
+    };
+
+    // view of (handle, element) pairs returned by items()
+    // note: invalidated by any operation that adds, removes or reorders
+    // elements
+    template<typename V>
+    class items_t
+    {
+      item_iterator_t<V> begin_;
+      item_iterator_t<V> end_;
+
+    public:
+      items_t(item_iterator_t<V> begin, item_iterator_t<V> end)
+        : begin_(begin), end_(end)
+      {
+      }
+
+      item_iterator_t<V> begin() const { return begin_; }
+      item_iterator_t<V> end() const { return end_; }
+    };
+
+    handle_vector_t() = default;
+    // constructs an empty container using the allocator provided
+    explicit handle_vector_t(const Allocator& allocator);
+
+    // returns a copy of the allocator associated with the container
+    [[nodiscard]] allocator_type get_allocator() const;
+    // exchanges the contents of the container with other
+    // note: if the allocators do not propagate on swap and compare unequal,
+    // the elements are moved between containers instead (as with std::swap)
+    void swap(handle_vector_t& other);
+
+    // writes the container (elements, element ids, handles and free list) to
+    // the stream in a versioned binary format so existing handles can be
+    // used after it is loaded again
+    // returns true if the stream was written successfully
+    // note: elements are copied in bulk so T must be trivially copyable
+    bool save(std::ostream& stream) const;
+    // writes the container to the stream, serialize(stream, element) is
+    // invoked to write each element
+    template<typename Serialize>
+    bool save(std::ostream& stream, Serialize&& serialize) const;
+    // replaces the contents of the container with those read from the stream
+    // returns false if the stream could not be read or was written by an
+    // incompatible container (the container is left empty)
+    // note: elements are copied in bulk so T must be trivially copyable
+    [[nodiscard]] bool load(std::istream& stream);
+    // replaces the contents of the container with those read from the stream,
+    // deserialize(stream) is invoked to read (and return) each element
+    template<typename Deserialize>
+    [[nodiscard]] bool load(std::istream& stream, Deserialize&& deserialize);
 
     // creates an element T in-place and returns a handle to it
     // note: args allow arguments to be passed directly to the type constructor
     // useful if the type does not support a default constructor
     template<typename... Args>
     [[nodiscard]] typed_handle_t<Tag, Index, Gen> add(Args&&... args);
+    // creates count elements T in-place and writes a handle to each one to the
+    // output iterator (returns the output iterator one past the last handle)
+    // note: storage is reserved once up front and args are copied to every
+    // element (they are not forwarded)
+    template<typename OutputIt, typename... Args>
+    OutputIt add_n(Index count, OutputIt handles, const Args&... args);
     // invokes a callable object (usually a lambda) on a particular element in
     // the container
     template<typename Fn>
@@ -161,6 +968,86 @@ namespace thh
     // returns true if the element was removed, false otherwise (the handle was
     // invalid or could not be found in the container)
     bool remove(typed_handle_t<Tag, Index, Gen> handle);
+    // removes the elements referenced by the range of handles
+    // returns the number of elements removed (invalid or duplicate handles are
+    // ignored)
+    // note: removed elements are compacted in a single pass so the resulting
+    // order may differ from calling remove for each handle in turn
+    template<typename InputIt>
+    Index remove(InputIt first, InputIt last);
+    // removes the element referenced by the handle without moving any other
+    // elements, the element is left in place as a tombstone until compact is
+    // called (the handle is invalidated immediately)
+    // returns true if the element was removed, false otherwise
+    // note: size, operator[] and iterators include tombstones until compact is
+    // called (use for_each to visit only live elements), remove, sort and
+    // partition call compact first
+    bool remove_deferred(typed_handle_t<Tag, Index, Gen> handle);
+    // removes all tombstones in a single pass (live elements keep their
+    // relative order)
+    void compact();
+    // removes the element referenced by the handle and shifts the following
+    // elements down by one so the order of the container is preserved
+    // returns true if the element was removed, false otherwise
+    bool erase_stable(typed_handle_t<Tag, Index, Gen> handle);
+    // removes the elements referenced by the range of handles, remaining
+    // elements are shifted down in a single pass so the order of the container
+    // is preserved (invalid or duplicate handles are ignored)
+    // returns the number of elements removed
+    template<typename InputIt>
+    Index erase_stable(InputIt first, InputIt last);
+    // returns the number of elements removed with remove_deferred that are
+    // waiting to be compacted
+    [[nodiscard]] Index tombstone_count() const;
+    // invokes a callable object (usually a lambda) on every element, skipping
+    // tombstones
+    template<typename Fn>
+    void for_each(Fn&& fn);
+    // invokes a callable object (usually a lambda) on every element, skipping
+    // tombstones (const overload)
+    template<typename Fn>
+    void for_each(Fn&& fn) const;
+    // invokes fn(handle, element) on every element (skipping tombstones)
+    // across several threads, elements are split into chunks of grain
+    // elements that each thread claims in turn
+    // note: fn is invoked concurrently and must not add, remove or reorder
+    // elements, if fn throws the remaining chunks are skipped and the first
+    // exception is rethrown once every thread has finished
+    template<typename Fn>
+    void parallel_for_each(
+      parallel_t parallel, Fn&& fn, Index grain = Index(1024));
+    // invokes fn(handle, element) on every element across several threads
+    // (const overload)
+    template<typename Fn>
+    void parallel_for_each(
+      parallel_t parallel, Fn&& fn, Index grain = Index(1024)) const;
+    // invokes fn(handle, element) on every element with each chunk of grain
+    // elements run as a task by executor(task_count, task), the executor
+    // must invoke task(i) once for every i in [0, task_count) and return once
+    // all have finished (e.g. by handing them to an existing thread pool)
+    template<typename Executor, typename Fn>
+    void parallel_for_each(
+      Executor&& executor, Fn&& fn, Index grain = Index(1024));
+    // invokes fn(handle, element) on every element with each chunk run by
+    // executor (const overload)
+    template<typename Executor, typename Fn>
+    void parallel_for_each(
+      Executor&& executor, Fn&& fn, Index grain = Index(1024)) const;
+    // combines init with transform(handle, element) for every element
+    // (skipping tombstones) using reduce, each chunk of grain elements is
+    // reduced on a single thread and the results are combined in order
+    // note: reduce must be associative, transform and reduce are invoked
+    // concurrently, exceptions are rethrown as with parallel_for_each
+    template<typename U, typename Reduce, typename Transform>
+    [[nodiscard]] U parallel_transform_reduce(
+      parallel_t parallel, U init, Reduce&& reduce, Transform&& transform,
+      Index grain = Index(1024)) const;
+    // combines init with transform(handle, element) for every element with
+    // each chunk reduced as a task run by executor (see parallel_for_each)
+    template<typename Executor, typename U, typename Reduce, typename Transform>
+    [[nodiscard]] U parallel_transform_reduce(
+      Executor&& executor, U init, Reduce&& reduce, Transform&& transform,
+      Index grain = Index(1024)) const;
     // returns if the container still has the element referenced by the handle
     [[nodiscard]] bool has(typed_handle_t<Tag, Index, Gen> handle) const;
     // returns the number of elements currently stored in the container
@@ -173,6 +1060,13 @@ namespace thh
     // removes all elements and invalidates all handles
     // note: capacity remains unchanged, internal handles are not cleared
     void clear();
+    // compacts tombstones and releases unused element and id capacity, handles
+    // at the back that have never been used are released too
+    // note: handles that have been used are kept so existing handles can
+    // never resolve to a different element
+    void shrink_to_fit();
+    // returns the bytes reserved for elements, ids and handles
+    [[nodiscard]] memory_usage_t memory_usage() const;
     // returns the handle for a value at the given index
     // note: will return an invalid handle if the index is out of range
     [[nodiscard]] typed_handle_t<Tag, Index, Gen> handle_from_index(
@@ -181,6 +1075,32 @@ namespace thh
     // note: will return an empty optional if the handle is invalid
     [[nodiscard]] std::optional<Index> index_from_handle(
       typed_handle_t<Tag, Index, Gen> handle) const;
+    // writes the index (position) of each handle to indices, or -1 if the
+    // handle is invalid (the output doubles as a validity mask)
+    // returns the number of handles that were successfully resolved
+    // note: indices must have space for count values
+    Index indices_from_handles(
+      const typed_handle_t<Tag, Index, Gen>* handles, Index count,
+      Index* indices) const;
+    // writes the handle of each element in positions [first, first + count)
+    // to handles (an invalid handle for a tombstone)
+    // note: the positions must be in range and handles must have space for
+    // count values
+    void handles_from_indices(
+      Index first, Index count, typed_handle_t<Tag, Index, Gen>* handles) const;
+    // writes a pointer to the element referenced by each handle to elements,
+    // or nullptr if the handle is invalid
+    // returns the number of handles that were successfully resolved
+    // note: pointers are invalidated by any operation that adds, removes or
+    // reorders elements (prefer call where possible, see README Gotchas)
+    Index resolve_many(
+      const typed_handle_t<Tag, Index, Gen>* handles, Index count,
+      T** elements);
+    // writes a const pointer to the element referenced by each handle to
+    // elements, or nullptr if the handle is invalid (const overload)
+    Index resolve_many(
+      const typed_handle_t<Tag, Index, Gen>* handles, Index count,
+      const T** elements) const;
     // returns if the container has any elements or not
     [[nodiscard]] bool empty() const;
     // returns mutable reference to element at position
@@ -217,6 +1137,20 @@ namespace thh
     auto rend() const -> const_reverse_iterator;
     // returns a const reverse iterator to one before the first element
     auto crend() const -> const_reverse_iterator;
+    // returns a view of (handle, element) pairs for every element (skipping
+    // tombstones), e.g. for (auto [handle, element] : container.items())
+    [[nodiscard]] auto items() -> items_t<T>;
+    // returns a view of (handle, const element) pairs for every element
+    [[nodiscard]] auto items() const -> items_t<const T>;
+    // invokes fn(handles, elements, count) for consecutive chunks of elements
+    // with an array of the handle for each one (an invalid handle for a
+    // tombstone), handles are written for a whole chunk at once
+    template<typename Fn>
+    void for_each_item_chunk(Fn&& fn);
+    // invokes fn(handles, elements, count) for consecutive chunks of elements
+    // (const overload)
+    template<typename Fn>
+    void for_each_item_chunk(Fn&& fn) const;
     // sorts elements in the container according to the provided comparison
     template<typename Compare>
     void sort(Compare&& compare);
@@ -229,12 +1163,135 @@ namespace thh
     // returns index of the first element for the second group
     template<typename Predicate>
     Index partition(Predicate&& predicate);
+    // sorts elements in the container according to the provided comparison,
+    // sorting, reordering elements and updating handles are split across
+    // several threads
+    // note: compare is invoked concurrently and must not throw
+    template<typename Compare>
+    void sort(parallel_t parallel, Compare&& compare);
+    // sorts elements in the container in the specified range according to the
+    // provided comparison across several threads
+    // begin - inclusive, end - exclusive
+    template<typename Compare>
+    void sort(parallel_t parallel, Index begin, Index end, Compare&& compare);
+    // sorts elements in the container according to the provided comparison
+    // note: compare is passed references to the elements to compare, small
+    // trivially copyable elements are sorted directly along with their ids
+    // (no index indirection)
+    template<typename Compare>
+    void sort_elements(Compare&& compare);
+    // sorts elements in the container in the specified range according to the
+    // provided comparison (passed references to the elements)
+    // begin - inclusive, end - exclusive
+    template<typename Compare>
+    void sort_elements(Index begin, Index end, Compare&& compare);
+    // sorts elements in the container according to the provided comparison,
+    // cheaper than sort when the elements are already close to sorted order
+    // (e.g. sorted last frame) as only elements out of order are moved and
+    // have their handles updated
+    // note: falls back to sort if too many elements are out of order
+    // note: compare is passed the indices of the elements to compare
+    template<typename Compare>
+    void incremental_sort(Compare&& compare);
+    // incrementally sorts elements in the container in the specified range
+    // begin - inclusive, end - exclusive
+    template<typename Compare>
+    void incremental_sort(Index begin, Index end, Compare&& compare);
+    // sorts elements in the container by the key returned from
+    // key_extractor(element) using a radix sort (keys are extracted once)
+    // the order of elements with equal keys is preserved (stable)
+    // note: the key must be an integer, enum or floating point type (up to
+    // 64 bits), negative values sort before positive ones
+    template<typename KeyExtractor>
+    void sort_by_key(KeyExtractor&& key_extractor);
+    // sorts elements in the container in the specified range by key
+    // begin - inclusive, end - exclusive
+    template<typename KeyExtractor>
+    void sort_by_key(Index begin, Index end, KeyExtractor&& key_extractor);
+    // sorts elements in the container according to the provided comparison,
+    // the order of equivalent elements is preserved
+    // note: compare is passed the indices of the elements to compare
+    template<typename Compare>
+    void stable_sort(Compare&& compare);
+    // stably sorts elements in the container in the specified range
+    // begin - inclusive, end - exclusive
+    template<typename Compare>
+    void stable_sort(Index begin, Index end, Compare&& compare);
+    // sorts the elements that belong in positions [0, middle) into order,
+    // the remaining elements are left in an unspecified order
+    // note: cheaper than sort when middle is small relative to size
+    template<typename Compare>
+    void partial_sort(Index middle, Compare&& compare);
+    // moves the element that belongs at position nth (if the container was
+    // sorted) there, elements before it are not greater and elements after it
+    // are not less (e.g. to find the k nearest elements)
+    template<typename Compare>
+    void nth_element(Index nth, Compare&& compare);
+    // partitions elements in the container according to the provided predicate
+    // the relative order of elements within each group is preserved
+    // returns index of the first element for the second group
+    template<typename Predicate>
+    Index stable_partition(Predicate&& predicate);
+    // partitions elements in the container according to the provided predicate
+    // across several threads
+    // returns index of the first element for the second group
+    // note: predicate is invoked concurrently and must not throw
+    template<typename Predicate>
+    Index partition(parallel_t parallel, Predicate&& predicate);
+    // starts or stops recording which elements are modified, added and
+    // removed (e.g. to only upload or replicate changed elements)
+    // modifications are recorded by the mutable overloads of call,
+    // call_return and operator[], use mark_dirty for any other changes
+    // note: operator[] records nothing while the container is being
+    // reordered (e.g. by a comparator or predicate passed to sort)
+    // note: stopping discards all changes recorded so far
+    void track_changes(bool enabled);
+    // returns if changes are being recorded
+    [[nodiscard]] bool tracking_changes() const;
+    // records that the element referenced by the handle was modified (e.g.
+    // through an iterator, data() or for_each)
+    void mark_dirty(typed_handle_t<Tag, Index, Gen> handle);
+    // invokes fn(handle, element) on every element modified since clear_dirty
+    // was last called in element order (elements added in that time are only
+    // visited by for_each_added)
+    template<typename Fn>
+    void for_each_dirty(Fn&& fn) const;
+    // invokes fn(handle, element) on every element added since clear_dirty
+    // was last called in element order
+    template<typename Fn>
+    void for_each_added(Fn&& fn) const;
+    // invokes fn(handle) for every element removed since clear_dirty was last
+    // called (elements added and removed in that time are not included)
+    template<typename Fn>
+    void for_each_removed(Fn&& fn) const;
+    // forgets all recorded changes (e.g. once they have been flushed)
+    void clear_dirty();
 
     // returns an ascii representation of the currently allocated handles
     // (useful for debugging purposes)
-    friend std::string debug_handles<T, Tag, Index, Gen>(
-      const handle_vector_t<T, Tag, Index, Gen>& handle_vector);
+    friend std::string debug_handles<T, Tag, Index, Gen, Allocator>(
+      const handle_vector_t<T, Tag, Index, Gen, Allocator>& handle_vector);
   };
+
+  // exchanges the contents of two containers (see handle_vector_t::swap)
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  void swap(
+    handle_vector_t<T, Tag, Index, Gen, Allocator>& lhs,
+    handle_vector_t<T, Tag, Index, Gen, Allocator>& rhs);
+
+#if __has_include(<memory_resource>)
+  namespace pmr
+  {
+    // handle_vector_t using a polymorphic allocator (e.g. to allocate all
+    // elements, ids and handles from a std::pmr::monotonic_buffer_resource)
+    template<
+      typename T, typename Tag = default_tag_t, typename Index = int32_t,
+      typename Gen = int32_t>
+    using handle_vector_t = thh::handle_vector_t<
+      T, Tag, Index, Gen, std::pmr::polymorphic_allocator<T>>;
+  } // namespace pmr
+#endif
 } // namespace thh
 
 #include "handle-vector.inl"
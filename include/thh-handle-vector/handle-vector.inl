@@ -51,91 +51,2276 @@ namespace thh
     return !(lhs < rhs);
   }
 
-  template<typename T, typename Tag, typename Index, typename Gen>
-  void handle_vector_t<T, Tag, Index, Gen>::try_allocate_handles()
-  {
-    if (handles_.size() - depleted_handles_ < elements_.capacity()) {
-      const auto last_handle_size = handles_.size();
-      const auto handle_count = elements_.capacity() + depleted_handles_;
-      assert(handle_count <= std::numeric_limits<Index>::max());
-      handles_.resize(handle_count);
-      for (size_t i = last_handle_size; i < handles_.size(); i++) {
-        assert(i <= std::numeric_limits<Index>::max());
-        const auto handle_index = static_cast<Index>(i);
-        handles_[handle_index].gen_ = -1;
-        handles_[handle_index].lookup_ = -1;
-        handles_[handle_index].next_ = handle_index + 1;
-      }
-      dequeue_ = static_cast<Index>(last_handle_size);
+  namespace detail
+  {
+    // inspired by Raymond Chen, OldNewThing blog
+    // https://devblogs.microsoft.com/oldnewthing/20170102-00/?p=95095
+    // placed(position) is invoked once each position that moves holds its
+    // final value (positions that do not move are skipped)
+    template<typename Index, typename Placed, typename... Iter>
+    void apply_permutation(
+      const Index begin, const Index end, Index* indices, Placed&& placed,
+      Iter... iters)
+    {
+      using std::swap;
+      for (Index i = begin; i < end; i++) {
+        if (i == indices[i - begin]) {
+          continue;
+        }
+        auto current = i;
+        while (i != indices[current - begin]) {
+          const auto next = indices[current - begin];
+          ([&](const auto it) { swap(it[current], it[next]); }(iters), ...);
+          indices[current - begin] = current;
+          placed(current);
+          current = next;
+        }
+        indices[current - begin] = current;
+        placed(current);
+      }
+    }
+
+    // maps key to an unsigned integer of the same size with the same order
+    // (signed integers have their sign bit flipped, negative floating point
+    // values have all their bits flipped and positive values their sign bit)
+    template<typename Key>
+    auto radix_key(const Key key)
+    {
+      if constexpr (std::is_enum_v<Key>) {
+        return radix_key(static_cast<std::underlying_type_t<Key>>(key));
+      } else if constexpr (std::is_same_v<Key, bool>) {
+        return static_cast<uint8_t>(key);
+      } else if constexpr (std::is_floating_point_v<Key>) {
+        static_assert(
+          sizeof(Key) == 4 || sizeof(Key) == 8,
+          "Floating point keys must be 32 or 64 bit.");
+        using bits_t =
+          std::conditional_t<sizeof(Key) == 4, uint32_t, uint64_t>;
+        bits_t bits;
+        std::memcpy(&bits, &key, sizeof(Key));
+        constexpr auto sign = bits_t(1) << (sizeof(Key) * 8 - 1);
+        return (bits & sign) != 0 ? bits_t(~bits) : bits_t(bits | sign);
+      } else {
+        static_assert(
+          std::is_integral_v<Key>,
+          "Keys must be integers, enums or floating point values.");
+        using bits_t = std::make_unsigned_t<Key>;
+        if constexpr (std::is_signed_v<Key>) {
+          constexpr auto sign = bits_t(bits_t(1) << (sizeof(Key) * 8 - 1));
+          return bits_t(static_cast<bits_t>(key) ^ sign);
+        } else {
+          return static_cast<bits_t>(key);
+        }
+      }
+    }
+
+    // stable least significant digit radix sort of keys (and values, if not
+    // null) by the bytes of each key in [first_byte, last_byte), a byte that
+    // is the same for every key is skipped
+    // returns true if the sorted result was written to the buffers (rather
+    // than keys and values)
+    inline bool radix_sort(
+      uint64_t* keys, uint64_t* values, uint64_t* key_buffer,
+      uint64_t* value_buffer, const size_t count, const int first_byte,
+      const int last_byte)
+    {
+      // count the occurrences of every digit for all bytes in one pass
+      size_t counts[8][256] = {};
+      for (size_t i = 0; i < count; i++) {
+        for (int byte = first_byte; byte < last_byte; byte++) {
+          counts[byte][(keys[i] >> (byte * 8)) & 0xff]++;
+        }
+      }
+
+      bool in_buffer = false;
+      for (int byte = first_byte; byte < last_byte; byte++) {
+        const auto shift = byte * 8;
+        auto& offsets = counts[byte];
+        if (count == 0 || offsets[(keys[0] >> shift) & 0xff] == count) {
+          continue;
+        }
+        size_t offset = 0;
+        for (auto& digit_offset : offsets) {
+          offset += std::exchange(digit_offset, offset);
+        }
+        for (size_t i = 0; i < count; i++) {
+          const auto position = offsets[(keys[i] >> shift) & 0xff]++;
+          key_buffer[position] = keys[i];
+          if (values != nullptr) {
+            value_buffer[position] = values[i];
+          }
+        }
+        std::swap(keys, key_buffer);
+        std::swap(values, value_buffer);
+        in_buffer = !in_buffer;
+      }
+
+      return in_buffer;
+    }
+
+    // smallest number of elements worth handing to another thread
+    constexpr int64_t parallel_grain_size = 1 << 14;
+
+    // returns the number of threads to use for count elements (at least
+    // grain elements per thread)
+    inline int32_t parallel_thread_count(
+      const parallel_t parallel, const int64_t count,
+      const int64_t grain = parallel_grain_size)
+    {
+      const auto requested =
+        parallel.thread_count_ > 0
+          ? parallel.thread_count_
+          : static_cast<int32_t>(
+            std::max(1u, std::thread::hardware_concurrency()));
+      return static_cast<int32_t>(
+        std::clamp<int64_t>(count / grain, 1, requested));
+    }
+
+    // invokes fn(task) for each task in [0, task_count), each task on its own
+    // thread (task zero runs on the calling thread)
+    // note: every thread is joined before the first exception thrown by a
+    // task (or by starting a thread) is rethrown, tasks whose thread could
+    // not be started are not run
+    template<typename Fn>
+    void run_in_parallel(const int32_t task_count, Fn&& fn)
+    {
+      std::exception_ptr exception;
+      std::mutex exception_mutex;
+      const auto capture = [&exception, &exception_mutex] {
+        std::lock_guard<std::mutex> lock(exception_mutex);
+        if (!exception) {
+          exception = std::current_exception();
+        }
+      };
+      const auto run = [&fn, &capture](const int32_t task) {
+        try {
+          fn(task);
+        } catch (...) {
+          capture();
+        }
+      };
+
+      std::vector<std::thread> threads;
+      try {
+        threads.reserve(task_count > 0 ? task_count - 1 : 0);
+        for (int32_t task = 1; task < task_count; task++) {
+          threads.emplace_back([&run, task] { run(task); });
+        }
+      } catch (...) {
+        capture();
+      }
+      if (task_count > 0) {
+        run(0);
+      }
+      for (auto& thread : threads) {
+        thread.join();
+      }
+      if (exception) {
+        std::rethrow_exception(exception);
+      }
+    }
+
+    // returns the start of sub-range part (of parts) when splitting count
+    // elements as evenly as possible
+    template<typename Index>
+    Index split_point(
+      const Index count, const int32_t part, const int32_t parts)
+    {
+      return static_cast<Index>(int64_t(count) * part / parts);
+    }
+
+    // splits [begin, end) into contiguous sub-ranges and invokes
+    // fn(first, last) for each one on its own thread
+    template<typename Index, typename Fn>
+    void parallel_for(
+      const parallel_t parallel, const Index begin, const Index end, Fn&& fn)
+    {
+      const auto count = end - begin;
+      const auto parts = parallel_thread_count(parallel, count);
+      run_in_parallel(parts, [&fn, begin, count, parts](const int32_t part) {
+        fn(
+          begin + split_point(count, part, parts),
+          begin + split_point(count, part + 1, parts));
+      });
+    }
+
+    // runs tasks on threads started for each call (the default when a
+    // parallel_t is given), each thread claims tasks one at a time so threads
+    // that finish early take on more of them
+    struct thread_executor_t
+    {
+      parallel_t parallel_;
+
+      template<typename Fn>
+      void operator()(const int64_t task_count, Fn&& fn) const
+      {
+        std::atomic<int64_t> next_task{0};
+        run_in_parallel(
+          parallel_thread_count(parallel_, task_count, 1), [&](int32_t) {
+            for (auto task = next_task.fetch_add(1, std::memory_order_relaxed);
+                 task < task_count;
+                 task = next_task.fetch_add(1, std::memory_order_relaxed)) {
+              try {
+                fn(task);
+              } catch (...) {
+                // stop the other threads claiming further tasks
+                next_task.store(task_count, std::memory_order_relaxed);
+                throw;
+              }
+            }
+          });
+      }
+    };
+
+    // splits [0, count) into chunks of grain elements and invokes
+    // fn(chunk, first, last) for each one, executor(chunk_count, task) decides
+    // where each chunk runs
+    template<typename Index, typename Executor, typename Fn>
+    void parallel_chunks(
+      Executor& executor, const Index count, const Index grain, Fn&& fn)
+    {
+      assert(grain > 0);
+      const int64_t chunk_count = (int64_t(count) + grain - 1) / grain;
+      if (chunk_count == 0) {
+        return;
+      }
+      executor(chunk_count, [&fn, count, grain](const int64_t chunk) {
+        const auto first = static_cast<Index>(chunk * grain);
+        fn(chunk, first, std::min<Index>(count, first + grain));
+      });
+    }
+
+    // sorts runs of indices on separate threads and then merges pairs of
+    // runs (also in parallel) until a single sorted run remains
+    // returns the sorted indices (either indices or buffer, the two are
+    // swapped after each round of merging)
+    template<typename Index, typename Compare>
+    const Index* parallel_sort(
+      const parallel_t parallel, Index* indices, Index* buffer,
+      const Index count, Compare& compare)
+    {
+      const auto runs = parallel_thread_count(parallel, count);
+      const auto less = [&compare](const Index lhs, const Index rhs) {
+        return compare(lhs, rhs);
+      };
+
+      run_in_parallel(runs, [&](const int32_t run) {
+        std::sort(
+          indices + split_point(count, run, runs),
+          indices + split_point(count, run + 1, runs), less);
+      });
+
+      for (int32_t width = 1; width < runs; width *= 2) {
+        const int32_t pairs = (runs + width * 2 - 1) / (width * 2);
+        run_in_parallel(pairs, [&](const int32_t pair) {
+          const auto first = split_point(count, pair * width * 2, runs);
+          const auto middle =
+            split_point(count, std::min(pair * width * 2 + width, runs), runs);
+          const auto last = split_point(
+            count, std::min(pair * width * 2 + width * 2, runs), runs);
+          std::merge(
+            indices + first, indices + middle, indices + middle,
+            indices + last, buffer + first, less);
+        });
+        std::swap(indices, buffer);
+      }
+
+      return indices;
+    }
+
+    // partitions runs of indices on separate threads and then gathers the
+    // first group of every run followed by the second group of every run
+    // into partitioned
+    // offsets must have room for three values per run (see
+    // parallel_thread_count)
+    // returns the number of indices in the first group
+    template<typename Index, typename Predicate>
+    Index parallel_partition(
+      const parallel_t parallel, Index* indices, Index* partitioned,
+      Index* offsets, const Index count, Predicate& predicate)
+    {
+      const auto runs = parallel_thread_count(parallel, count);
+
+      auto* firsts = offsets;
+      run_in_parallel(runs, [&](const int32_t run) {
+        const auto begin = indices + split_point(count, run, runs);
+        const auto second = std::partition(
+          begin, indices + split_point(count, run + 1, runs),
+          [&predicate](const Index index) { return predicate(index); });
+        firsts[run] = static_cast<Index>(second - begin);
+      });
+
+      // offsets of each run's groups in the combined result
+      auto* first_offsets = offsets + runs;
+      auto* second_offsets = offsets + runs * 2;
+      const auto first_count = std::accumulate(firsts, firsts + runs, Index(0));
+      Index first_offset = 0;
+      Index second_offset = first_count;
+      for (int32_t run = 0; run < runs; run++) {
+        first_offsets[run] = first_offset;
+        second_offsets[run] = second_offset;
+        first_offset += firsts[run];
+        second_offset += split_point(count, run + 1, runs)
+                       - split_point(count, run, runs) - firsts[run];
+      }
+
+      run_in_parallel(runs, [&](const int32_t run) {
+        const auto begin = indices + split_point(count, run, runs);
+        const auto second = begin + firsts[run];
+        const auto end = indices + split_point(count, run + 1, runs);
+        std::copy(begin, second, partitioned + first_offsets[run]);
+        std::copy(second, end, partitioned + second_offsets[run]);
+      });
+
+      return first_count;
+    }
+
+    // moves the values referenced by indices (absolute positions) into the
+    // range starting at begin, values are moved out to storage (uninitialized
+    // and with room for end - begin values) and then back so the work can be
+    // split across threads
+    // note: a temporary buffer is allocated if storage is nullptr
+    template<typename Index, typename Iter>
+    void parallel_gather(
+      const parallel_t parallel, const Index begin, const Index end,
+      const Index* indices, Iter it, void* storage)
+    {
+      using value_type = typename std::iterator_traits<Iter>::value_type;
+      // uninitialized storage so value_type need not be default constructible
+      struct slot_t
+      {
+        alignas(value_type) unsigned char storage_[sizeof(value_type)];
+      };
+
+      const auto count = end - begin;
+      if (count <= 0) {
+        return;
+      }
+      std::unique_ptr<slot_t[]> allocated;
+      if (storage == nullptr) {
+        allocated.reset(new slot_t[count]);
+        storage = allocated.get();
+      }
+      auto* buffer = static_cast<slot_t*>(storage);
+      parallel_for(parallel, Index(0), count, [&](Index first, Index last) {
+        for (Index i = first; i < last; i++) {
+          new (buffer[i].storage_) value_type(std::move(it[indices[i]]));
+        }
+      });
+      parallel_for(parallel, Index(0), count, [&](Index first, Index last) {
+        for (Index i = first; i < last; i++) {
+          auto* value =
+            std::launder(reinterpret_cast<value_type*>(buffer[i].storage_));
+          it[begin + i] = std::move(*value);
+          value->~value_type();
+        }
+      });
+    }
+
+    // copies the values referenced by indices (absolute positions) into the
+    // range starting at begin through storage (with room for end - begin
+    // values) on this thread
+    template<typename Index, typename Iter>
+    void gather(
+      const Index begin, const Index end, const Index* indices, Iter it,
+      void* storage)
+    {
+      using value_type = typename std::iterator_traits<Iter>::value_type;
+      static_assert(std::is_trivially_copyable_v<value_type>);
+      const auto count = end - begin;
+      if (count <= 0) {
+        return;
+      }
+      auto* buffer = static_cast<unsigned char*>(storage);
+      for (Index i = 0; i < count; i++) {
+        std::memcpy(
+          buffer + size_t(i) * sizeof(value_type), &it[indices[i]],
+          sizeof(value_type));
+      }
+      std::memcpy(&it[begin], buffer, size_t(count) * sizeof(value_type));
+    }
+
+    // number of handles to look ahead when prefetching internal handles
+    constexpr int resolve_prefetch_distance = 16;
+    // number of handles written at a time by for_each_item_chunk
+    constexpr int item_chunk_size = 256;
+
+    inline void prefetch(const void* address)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+      __builtin_prefetch(address);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+      _mm_prefetch(static_cast<const char*>(address), _MM_HINT_T0);
+#else
+      (void)address;
+#endif
+    }
+
+    // returns the position of the lowest set bit (bits must not be zero)
+    inline int count_trailing_zeros(const uint64_t bits)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+      return __builtin_ctzll(bits);
+#elif defined(_MSC_VER) && defined(_M_X64)
+      unsigned long position;
+      _BitScanForward64(&position, bits);
+      return static_cast<int>(position);
+#else
+      int position = 0;
+      while ((bits & (uint64_t(1) << position)) == 0) {
+        position++;
+      }
+      return position;
+#endif
+    }
+
+    // identifies the binary format written by handle_vector_t::save
+    constexpr char save_magic[4] = {'T', 'H', 'H', 'V'};
+    // incremented whenever the binary format changes
+    constexpr uint32_t save_version = 2;
+    // written in native byte order to detect a mismatch when loading
+    constexpr uint32_t save_byte_order = 0x01020304;
+
+    // writes the object representation of count values to the stream
+    template<typename T>
+    void write_values(std::ostream& stream, const T* values, const size_t count)
+    {
+      static_assert(std::is_trivially_copyable_v<T>);
+      stream.write(
+        reinterpret_cast<const char*>(values),
+        static_cast<std::streamsize>(sizeof(T) * count));
+    }
+
+    // reads the object representation of count values from the stream
+    // returns false if the stream did not contain enough data
+    template<typename T>
+    bool read_values(std::istream& stream, T* values, const size_t count)
+    {
+      static_assert(std::is_trivially_copyable_v<T>);
+      stream.read(
+        reinterpret_cast<char*>(values),
+        static_cast<std::streamsize>(sizeof(T) * count));
+      return static_cast<bool>(stream);
+    }
+
+    // returns the number of bytes left to read from the stream (or the largest
+    // value if the stream cannot report its length)
+    inline uint64_t bytes_remaining(std::istream& stream)
+    {
+      const auto position = stream.tellg();
+      if (position == std::istream::pos_type(-1)) {
+        return std::numeric_limits<uint64_t>::max();
+      }
+      stream.seekg(0, std::ios::end);
+      const auto end = stream.tellg();
+      stream.seekg(position);
+      if (end == std::istream::pos_type(-1) || end < position) {
+        return std::numeric_limits<uint64_t>::max();
+      }
+      return static_cast<uint64_t>(end - position);
+    }
+
+    // writes the format header (element_size is zero when elements are
+    // written by a user provided serializer)
+    inline void write_header(
+      std::ostream& stream, const uint32_t index_size, const uint32_t gen_size,
+      const uint32_t element_size)
+    {
+      const uint32_t header[] = {
+        save_version, save_byte_order, index_size, gen_size, element_size};
+      write_values(stream, save_magic, std::size(save_magic));
+      write_values(stream, header, std::size(header));
+    }
+
+    // reads the format header and checks it matches the container loading it
+    inline bool read_header(
+      std::istream& stream, const uint32_t index_size, const uint32_t gen_size,
+      const uint32_t element_size)
+    {
+      char magic[std::size(save_magic)];
+      uint32_t header[5];
+      if (
+        !read_values(stream, magic, std::size(magic))
+        || !read_values(stream, header, std::size(header))) {
+        return false;
+      }
+      return std::equal(std::begin(magic), std::end(magic), save_magic)
+          && header[0] == save_version && header[1] == save_byte_order
+          && header[2] == index_size && header[3] == gen_size
+          && header[4] == element_size;
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    handle_pool_t<Tag, Index, Gen, Allocator>::handle_pool_t(
+      const Allocator& allocator)
+      : handles_(handle_allocator_t(allocator))
+    {
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    void handle_pool_t<Tag, Index, Gen, Allocator>::try_allocate_handles(
+      const size_t count)
+    {
+      if (handles_.size() - depleted_handles_ < count) {
+        const auto last_handle_size = handles_.size();
+        const auto handle_count = count + depleted_handles_;
+        assert(handle_count <= static_cast<size_t>(limits_t::max_index));
+        // free handles may still be waiting to be reused if storage was
+        // reserved ahead of time (e.g. when adding elements in bulk)
+        const bool handles_available =
+          dequeue_ < static_cast<Index>(last_handle_size)
+          && handles_[dequeue_].lookup_ < 0;
+        handles_.resize(handle_count);
+        for (size_t i = last_handle_size; i < handles_.size(); i++) {
+          assert(i <= std::numeric_limits<Index>::max());
+          const auto handle_index = static_cast<Index>(i);
+          handles_[handle_index].gen_ = -1;
+          handles_[handle_index].set_next(handle_index + 1);
+        }
+        if (handles_available) {
+          // append new handles to the end of the existing free list
+          handles_[enqueue_].set_next(static_cast<Index>(last_handle_size));
+        } else {
+          dequeue_ = static_cast<Index>(last_handle_size);
+        }
+        enqueue_ = static_cast<Index>(handles_.size() - 1);
+      }
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    Index handle_pool_t<Tag, Index, Gen, Allocator>::allocate(
+      const size_t count, const Index lookup)
+    {
+      Index id;
+      allocate_n(count, lookup, 1, &id);
+      return id;
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    void handle_pool_t<Tag, Index, Gen, Allocator>::allocate_n(
+      const size_t count, const Index first_lookup, const Index n, Index* ids)
+    {
+      assert(first_lookup >= 0 && n >= 0);
+
+      // at least n free handles are not known to be depleted from here on so
+      // the free list is never empty
+      try_allocate_handles(count);
+
+      for (Index i = 0; i < n; i++) {
+        if (handles_[dequeue_].gen_ == limits_t::max_gen) {
+          while (dequeue_ < static_cast<Index>(handles_.size())
+                 && handles_[dequeue_].gen_ == limits_t::max_gen) {
+            // skip handle for allocation if generation has reached its limit
+            const auto dequeue_before = dequeue_;
+            dequeue_ = handles_[dequeue_].next();
+            depleted_handles_++;
+            // ensure we don't get stuck in an infinite loop (may happen if
+            // we currently only have one handle and it uses up all its
+            // generations)
+            if (dequeue_before == dequeue_) {
+              dequeue_++;
+              break;
+            }
+          }
+          // if several handles have been depleted, create additional handles
+          try_allocate_handles(count);
+        }
+
+        const auto id = dequeue_;
+        // increment the generation of the handle
+        auto& internal_handle = handles_[id];
+        assert(internal_handle.lookup_ < 0); // ensure handle is free
+        internal_handle.gen_++;
+
+        // update the next available handle (before the link is overwritten)
+        dequeue_ = internal_handle.next();
+
+        internal_handle.lookup_ = first_lookup + i;
+        ids[i] = id;
+      }
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    void handle_pool_t<Tag, Index, Gen, Allocator>::free_handle(const Index id)
+    {
+      handles_[id].set_next(static_cast<Index>(handles_.size()));
+
+      // if the free list is empty the freed handle becomes the head, otherwise
+      // it is appended to the tail (the tail may be the handle being freed if
+      // it was the last one allocated, so it must not be linked to itself)
+      if (dequeue_ == static_cast<Index>(handles_.size())) {
+        dequeue_ = id;
+      } else {
+        assert(handles_[enqueue_].lookup_ < 0);
+        handles_[enqueue_].set_next(id);
+      }
+      enqueue_ = id;
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    bool handle_pool_t<Tag, Index, Gen, Allocator>::has(
+      const typed_handle_t<Tag, Index, Gen> handle) const
+    {
+      return handle.id_ >= 0
+          && handle.id_ < static_cast<Index>(handles_.size())
+          && handles_[handle.id_].gen_ == handle.gen_
+          && handles_[handle.id_].lookup_ >= 0;
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    void handle_pool_t<Tag, Index, Gen, Allocator>::clear()
+    {
+      assert(handles_.size() <= std::numeric_limits<Index>::max());
+
+      for (size_t i = 0; i < handles_.size(); i++) {
+        handles_[i].set_next(static_cast<Index>(i) + 1);
+      }
+
+      depleted_handles_ = 0;
+      dequeue_ = 0;
       enqueue_ = static_cast<Index>(handles_.size() - 1);
     }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    void handle_pool_t<Tag, Index, Gen, Allocator>::shrink_to_fit()
+    {
+      // only handles that have never been used can be released (a used handle
+      // must keep its generation so it is not handed out again from -1)
+      auto handle_count = handles_.size();
+      while (handle_count > 0 && handles_[handle_count - 1].gen_ == -1) {
+        handle_count--;
+      }
+
+      if (handle_count < handles_.size()) {
+        // relink the free list without the released handles (preserving the
+        // order of those that remain)
+        const auto end = static_cast<Index>(handles_.size());
+        const auto new_end = static_cast<Index>(handle_count);
+        Index head = new_end;
+        Index tail = new_end;
+        for (Index id = dequeue_; id != end; id = handles_[id].next()) {
+          if (id < new_end) {
+            if (head == new_end) {
+              head = id;
+            } else {
+              handles_[tail].set_next(id);
+            }
+            tail = id;
+          }
+        }
+        if (tail != new_end) {
+          handles_[tail].set_next(new_end);
+        }
+        dequeue_ = head;
+        enqueue_ = tail;
+        handles_.resize(handle_count);
+      }
+
+      handles_.shrink_to_fit();
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    void handle_pool_t<Tag, Index, Gen, Allocator>::reserve(
+      const size_t capacity)
+    {
+      handles_.reserve(capacity);
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    void handle_pool_t<Tag, Index, Gen, Allocator>::swap(
+      handle_pool_t& other) noexcept
+    {
+      using std::swap;
+      handles_.swap(other.handles_);
+      swap(dequeue_, other.dequeue_);
+      swap(enqueue_, other.enqueue_);
+      swap(depleted_handles_, other.depleted_handles_);
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    bool handle_pool_t<Tag, Index, Gen, Allocator>::valid() const
+    {
+      const auto handle_count = static_cast<Index>(handles_.size());
+
+      Index free_handles = 0;
+      for (const auto& internal_handle : handles_) {
+        if (
+          internal_handle.gen_ < -1
+          || internal_handle.gen_ > limits_t::max_gen) {
+          return false;
+        }
+        free_handles += Index(internal_handle.lookup_ < 0);
+      }
+
+      // the free list must end at the sentinel without revisiting a handle,
+      // its last handle must be the tail and every free handle must either be
+      // on it or depleted (skipped once its generation reached the limit)
+      if (
+        dequeue_ < 0 || dequeue_ > handle_count || enqueue_ < -1
+        || enqueue_ > handle_count || depleted_handles_ < 0
+        || depleted_handles_ > free_handles) {
+        return false;
+      }
+      std::vector<bool> visited(handles_.size());
+      Index listed = 0;
+      Index tail = enqueue_;
+      for (Index id = dequeue_; id != handle_count; id = handles_[id].next()) {
+        if (
+          id < 0 || id > handle_count || visited[id]
+          || handles_[id].lookup_ >= 0) {
+          return false;
+        }
+        visited[id] = true;
+        tail = id;
+        listed++;
+      }
+      if (tail != enqueue_ || listed + depleted_handles_ != free_handles) {
+        return false;
+      }
+      for (Index id = 0; id < handle_count; id++) {
+        if (
+          handles_[id].lookup_ < 0 && !visited[id]
+          && handles_[id].gen_ != limits_t::max_gen) {
+          return false;
+        }
+      }
+
+      return true;
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    size_t handle_pool_t<Tag, Index, Gen, Allocator>::size() const
+    {
+      return handles_.size();
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    bool handle_pool_t<Tag, Index, Gen, Allocator>::empty() const
+    {
+      return handles_.empty();
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    size_t handle_pool_t<Tag, Index, Gen, Allocator>::capacity() const
+    {
+      return handles_.capacity();
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    auto handle_pool_t<Tag, Index, Gen, Allocator>::data() const
+      -> const internal_handle_t*
+    {
+      return handles_.data();
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    auto handle_pool_t<Tag, Index, Gen, Allocator>::operator[](const Index id)
+      -> internal_handle_t&
+    {
+      return handles_[id];
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    auto handle_pool_t<Tag, Index, Gen, Allocator>::operator[](
+      const Index id) const -> const internal_handle_t&
+    {
+      return handles_[id];
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    handle_table_t<Tag, Index, Gen, Allocator>::handle_table_t(
+      const Allocator& allocator)
+      : element_ids_(id_allocator_t(allocator)),
+        handles_(allocator),
+        live_(live_allocator_t(allocator)),
+        scratch_(id_allocator_t(allocator)),
+        key_scratch_(live_allocator_t(allocator)),
+        gather_scratch_(gather_allocator_t(allocator))
+    {
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    typed_handle_t<Tag, Index, Gen> handle_table_t<
+      Tag, Index, Gen, Allocator>::add(const size_t element_capacity)
+    {
+      const auto lookup = static_cast<Index>(element_ids_.size());
+
+      assert(lookup <= std::numeric_limits<Index>::max());
+
+      element_ids_.emplace_back();
+
+      // keep the live bitmap in sync while tombstones are waiting
+      if (!live_.empty()) {
+        const auto word = static_cast<size_t>(lookup) / 64;
+        if (word == live_.size()) {
+          live_.push_back(0);
+        }
+        live_[word] |= uint64_t(1) << (lookup % 64);
+      }
+
+      // bind the next available handle to the element (if backing store
+      // increased, additional handles are created for newly available
+      // elements first)
+      const auto index = handles_.allocate(element_capacity, lookup);
+
+      // map the element back to the handle it's bound to
+      element_ids_[lookup] = index;
+
+      return {index, handles_[index].gen_};
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    template<typename OutputIt>
+    OutputIt handle_table_t<Tag, Index, Gen, Allocator>::add_n(
+      const size_t element_capacity, const Index count, OutputIt handles)
+    {
+      const auto first = static_cast<Index>(element_ids_.size());
+      const auto last = element_ids_.size() + static_cast<size_t>(count);
+
+      assert(last <= static_cast<size_t>(std::numeric_limits<Index>::max()));
+
+      element_ids_.resize(last);
+
+      // keep the live bitmap in sync while tombstones are waiting (setting
+      // up to a word of bits at a time)
+      if (!live_.empty()) {
+        live_.resize((last + 63) / 64);
+        for (auto position = static_cast<size_t>(first); position < last;) {
+          const auto bit = position % 64;
+          const auto bits = std::min(64 - bit, last - position);
+          live_[position / 64] |=
+            (bits == 64 ? ~uint64_t(0) : (uint64_t(1) << bits) - 1) << bit;
+          position += bits;
+        }
+      }
+
+      // bind the elements to handles, mapping each element back to the
+      // handle it's bound to as the free list is walked
+      handles_.allocate_n(
+        element_capacity, first, count, element_ids_.data() + first);
+
+      for (auto position = static_cast<size_t>(first); position < last;
+           position++) {
+        const auto index = element_ids_[position];
+        *handles++ = typed_handle_t<Tag, Index, Gen>{
+          index, handles_[index].gen_};
+      }
+
+      return handles;
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    Index handle_table_t<Tag, Index, Gen, Allocator>::remove(
+      const typed_handle_t<Tag, Index, Gen> handle)
+    {
+      assert(has(handle));
+      assert(tombstones_ == 0);
+
+      using std::swap;
+      const auto lookup = handles_[handle.id_].lookup_;
+      // find the handle of the last element currently stored and have it
+      // point to the look-up of the element about to be removed
+      handles_[element_ids_.back()].lookup_ = lookup;
+      // swap the last element id with the element id being removed and then
+      // pop_back (the owning container does the same for its elements)
+      swap(element_ids_[lookup], element_ids_.back());
+      element_ids_.pop_back();
+
+      // free handle being removed (make ready for reuse)
+      handles_.free_handle(handle.id_);
+
+      return lookup;
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    template<typename InputIt, typename SwapElements, typename Removed>
+    Index handle_table_t<Tag, Index, Gen, Allocator>::remove(
+      InputIt first, InputIt last, SwapElements&& swap_elements,
+      Removed&& removed)
+    {
+      assert(tombstones_ == 0);
+
+      // free each handle and mark the element it referenced as removed
+      // (freeing the handle straight away ensures duplicates are skipped)
+      Index removed_count = 0;
+      for (; first != last; ++first) {
+        const typed_handle_t<Tag, Index, Gen> handle = *first;
+        if (!has(handle)) {
+          continue;
+        }
+        const auto lookup = handles_[handle.id_].lookup_;
+        removed(handle, lookup);
+        element_ids_[lookup] = -1;
+        handles_.free_handle(handle.id_);
+        removed_count++;
+      }
+
+      if (removed_count == 0) {
+        return removed_count;
+      }
+
+      // fill holes left in the front of the container with live elements from
+      // the back (removed elements end up at the back and are then erased)
+      using std::swap;
+      const auto remaining = size() - removed_count;
+      auto back = size() - 1;
+      for (Index hole = 0; hole < remaining; hole++) {
+        if (element_ids_[hole] != -1) {
+          continue;
+        }
+        while (element_ids_[back] == -1) {
+          back--;
+        }
+        swap_elements(hole, back);
+        swap(element_ids_[hole], element_ids_[back]);
+        handles_[element_ids_[hole]].lookup_ = hole;
+        back--;
+      }
+
+      element_ids_.erase(element_ids_.begin() + remaining, element_ids_.end());
+
+      return removed_count;
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    void handle_table_t<Tag, Index, Gen, Allocator>::remove_deferred(
+      const typed_handle_t<Tag, Index, Gen> handle)
+    {
+      assert(has(handle));
+
+      // all elements are live before the first tombstone is added
+      if (live_.empty()) {
+        const auto count = element_ids_.size();
+        live_.assign((count + 63) / 64, ~uint64_t(0));
+        if (count % 64 != 0) {
+          live_.back() = (uint64_t(1) << (count % 64)) - 1;
+        }
+      }
+
+      const auto lookup = handles_[handle.id_].lookup_;
+      live_[lookup / 64] &= ~(uint64_t(1) << (lookup % 64));
+      element_ids_[lookup] = -1;
+      tombstones_++;
+
+      handles_.free_handle(handle.id_);
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    Index handle_table_t<Tag, Index, Gen, Allocator>::tombstones() const
+    {
+      return tombstones_;
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    template<typename Fn>
+    void handle_table_t<Tag, Index, Gen, Allocator>::for_each_live(
+      Fn&& fn) const
+    {
+      if (live_.empty()) {
+        for (Index i = 0; i < size(); i++) {
+          fn(i);
+        }
+        return;
+      }
+
+      // visit the set bits of each word (skips runs of tombstones)
+      for (size_t word = 0; word < live_.size(); word++) {
+        for (uint64_t bits = live_[word]; bits != 0; bits &= bits - 1) {
+          fn(static_cast<Index>(word * 64 + count_trailing_zeros(bits)));
+        }
+      }
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    template<typename MoveElement>
+    void handle_table_t<Tag, Index, Gen, Allocator>::compact(
+      MoveElement&& move_element)
+    {
+      if (tombstones_ == 0) {
+        return;
+      }
+
+      // stream live elements down over tombstones, updating the handle of
+      // each element that moves
+      Index write = 0;
+      for_each_live([&](const Index read) {
+        if (read != write) {
+          move_element(write, read);
+          element_ids_[write] = element_ids_[read];
+          handles_[element_ids_[write]].lookup_ = write;
+        }
+        write++;
+      });
+
+      element_ids_.erase(element_ids_.begin() + write, element_ids_.end());
+      live_.clear();
+      tombstones_ = 0;
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    Index handle_table_t<Tag, Index, Gen, Allocator>::erase_stable(
+      const typed_handle_t<Tag, Index, Gen> handle)
+    {
+      assert(has(handle));
+      assert(tombstones_ == 0);
+
+      const auto lookup = handles_[handle.id_].lookup_;
+      element_ids_.erase(element_ids_.begin() + lookup);
+      fixup_handles(lookup, size());
+
+      handles_.free_handle(handle.id_);
+
+      return lookup;
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    template<typename InputIt, typename MoveElement, typename Removed>
+    Index handle_table_t<Tag, Index, Gen, Allocator>::erase_stable(
+      InputIt first, InputIt last, MoveElement&& move_element,
+      Removed&& removed)
+    {
+      assert(tombstones_ == 0);
+
+      // free each handle and mark the element it referenced as removed
+      // (freeing the handle straight away ensures duplicates are skipped)
+      Index removed_count = 0;
+      Index first_hole = size();
+      for (; first != last; ++first) {
+        const typed_handle_t<Tag, Index, Gen> handle = *first;
+        if (!has(handle)) {
+          continue;
+        }
+        const auto lookup = handles_[handle.id_].lookup_;
+        removed(handle, lookup);
+        first_hole = std::min(first_hole, lookup);
+        element_ids_[lookup] = -1;
+        handles_.free_handle(handle.id_);
+        removed_count++;
+      }
+
+      if (removed_count == 0) {
+        return removed_count;
+      }
+
+      // shift everything after the first hole down over the removed elements
+      // (elements before the first hole are untouched)
+      Index write = first_hole;
+      for (Index read = first_hole; read < size(); read++) {
+        if (element_ids_[read] == -1) {
+          continue;
+        }
+        move_element(write, read);
+        element_ids_[write] = element_ids_[read];
+        write++;
+      }
+
+      element_ids_.erase(element_ids_.begin() + write, element_ids_.end());
+      fixup_handles(first_hole, write);
+
+      return removed_count;
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    bool handle_table_t<Tag, Index, Gen, Allocator>::has(
+      const typed_handle_t<Tag, Index, Gen> handle) const
+    {
+      assert(handles_.size() <= std::numeric_limits<Index>::max());
+
+      if (handle.id_ < 0 || handle.id_ >= static_cast<Index>(handles_.size())) {
+        return false;
+      }
+
+      // ensure the handle matches the one stored internally
+      // and is referencing a valid element
+      const internal_handle_t& ih = handles_[handle.id_];
+      return ih.gen_ == handle.gen_ && ih.lookup_ >= 0
+          && ih.lookup_ < static_cast<Index>(element_ids_.size());
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    Index handle_table_t<Tag, Index, Gen, Allocator>::lookup(
+      const typed_handle_t<Tag, Index, Gen> handle) const
+    {
+      assert(has(handle));
+      return handles_[handle.id_].lookup_;
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    Index handle_table_t<Tag, Index, Gen, Allocator>::size() const
+    {
+      assert(element_ids_.size() <= std::numeric_limits<Index>::max());
+      return static_cast<Index>(element_ids_.size());
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    Index handle_table_t<Tag, Index, Gen, Allocator>::capacity() const
+    {
+      assert(handles_.size() <= std::numeric_limits<Index>::max());
+      return static_cast<Index>(handles_.size());
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    void handle_table_t<Tag, Index, Gen, Allocator>::reserve(
+      const size_t element_capacity)
+    {
+      element_ids_.reserve(element_capacity);
+      handles_.try_allocate_handles(element_capacity);
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    void handle_table_t<Tag, Index, Gen, Allocator>::clear()
+    {
+      assert(handles_.size() <= std::numeric_limits<Index>::max());
+
+      element_ids_.clear();
+      live_.clear();
+      tombstones_ = 0;
+
+      // reset handles but leave generation untouched (ensures existing
+      // external handles cannot be used again with the container)
+      handles_.clear();
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    void handle_table_t<Tag, Index, Gen, Allocator>::shrink_to_fit()
+    {
+      assert(tombstones_ == 0);
+
+      element_ids_.shrink_to_fit();
+      live_.shrink_to_fit();
+      scratch_.clear();
+      scratch_.shrink_to_fit();
+      key_scratch_.clear();
+      key_scratch_.shrink_to_fit();
+      gather_scratch_.clear();
+      gather_scratch_.shrink_to_fit();
+
+      handles_.shrink_to_fit();
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    memory_usage_t handle_table_t<Tag, Index, Gen, Allocator>::memory_usage()
+      const
+    {
+      memory_usage_t memory_usage;
+      memory_usage.id_bytes_ = element_ids_.capacity() * sizeof(Index)
+                             + live_.capacity() * sizeof(uint64_t)
+                             + scratch_.capacity() * sizeof(Index)
+                             + key_scratch_.capacity() * sizeof(uint64_t)
+                             + gather_scratch_.capacity()
+                                 * sizeof(gather_block_t);
+      memory_usage.handle_bytes_ =
+        handles_.capacity() * sizeof(internal_handle_t);
+      return memory_usage;
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    typed_handle_t<Tag, Index, Gen> handle_table_t<
+      Tag, Index, Gen, Allocator>::handle_from_index(const Index index) const
+    {
+      if (index < 0 || index >= static_cast<Index>(element_ids_.size())) {
+        return typed_handle_t<Tag, Index, Gen>{};
+      }
+      const auto handle = element_ids_[index];
+      // tombstones are not bound to a handle
+      if (handle == -1) {
+        return typed_handle_t<Tag, Index, Gen>{};
+      }
+      return {handle, handles_[handle].gen_};
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    typed_handle_t<Tag, Index, Gen> handle_table_t<
+      Tag, Index, Gen, Allocator>::handle_at(const Index position) const
+    {
+      assert(position >= 0 && position < size());
+      const auto id = element_ids_[position];
+      return id == -1 ? typed_handle_t<Tag, Index, Gen>{}
+                      : typed_handle_t<Tag, Index, Gen>{id, handles_[id].gen_};
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    const Index* handle_table_t<Tag, Index, Gen, Allocator>::element_ids() const
+    {
+      return element_ids_.data();
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    Gen handle_table_t<Tag, Index, Gen, Allocator>::generation(
+      const Index id) const
+    {
+      assert(id >= 0 && id < capacity());
+      return handles_[id].gen_;
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    std::optional<Index> handle_table_t<Tag, Index, Gen, Allocator>::
+      index_from_handle(const typed_handle_t<Tag, Index, Gen> handle) const
+    {
+      if (!has(handle)) {
+        return std::nullopt;
+      }
+      return handles_[handle.id_].lookup_;
+    }
+
+#if defined(__AVX2__)
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    Index handle_table_t<Tag, Index, Gen, Allocator>::indices_from_handles_avx2(
+      const typed_handle_t<Tag, Index, Gen>* handles, const Index count,
+      Index* indices, Index& resolved) const
+    {
+      if constexpr (
+        std::is_same_v<Index, int32_t> && std::is_same_v<Gen, int32_t>) {
+        static_assert(sizeof(typed_handle_t<Tag, Index, Gen>) == 8);
+        static_assert(sizeof(internal_handle_t) == 8);
+
+        // gather offsets are scaled by two (internal handle stride) so
+        // ensure they cannot overflow
+        if (handles_.size() > std::numeric_limits<int32_t>::max() / 2) {
+          return 0;
+        }
+
+        const auto* base = reinterpret_cast<const int*>(handles_.data());
+        const __m256i handle_count =
+          _mm256_set1_epi32(static_cast<int32_t>(handles_.size()));
+        const __m256i element_count = _mm256_set1_epi32(size());
+        const __m256i minus_one = _mm256_set1_epi32(-1);
+        const __m256i deinterleave =
+          _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+
+        Index i = 0;
+        for (; i + 8 <= count; i += 8) {
+          // split eight handles into separate id and generation lanes
+          const __m256i lo = _mm256_permutevar8x32_epi32(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(handles + i)),
+            deinterleave);
+          const __m256i hi = _mm256_permutevar8x32_epi32(
+            _mm256_loadu_si256(
+              reinterpret_cast<const __m256i*>(handles + i + 4)),
+            deinterleave);
+          const __m256i ids = _mm256_permute2x128_si256(lo, hi, 0x20);
+          const __m256i gens = _mm256_permute2x128_si256(lo, hi, 0x31);
+
+          const __m256i in_range = _mm256_and_si256(
+            _mm256_cmpgt_epi32(ids, minus_one),
+            _mm256_cmpgt_epi32(handle_count, ids));
+          const __m256i offsets =
+            _mm256_and_si256(_mm256_add_epi32(ids, ids), in_range);
+
+          const __m256i internal_gens = _mm256_mask_i32gather_epi32(
+            minus_one, base, offsets, in_range, 4);
+          const __m256i lookups = _mm256_mask_i32gather_epi32(
+            minus_one, base + 1, offsets, in_range, 4);
+
+          const __m256i valid = _mm256_and_si256(
+            _mm256_and_si256(
+              in_range, _mm256_cmpeq_epi32(internal_gens, gens)),
+            _mm256_and_si256(
+              _mm256_cmpgt_epi32(lookups, minus_one),
+              _mm256_cmpgt_epi32(element_count, lookups)));
+
+          _mm256_storeu_si256(
+            reinterpret_cast<__m256i*>(indices + i),
+            _mm256_blendv_epi8(minus_one, lookups, valid));
+          resolved += static_cast<Index>(
+            std::bitset<8>(static_cast<unsigned>(
+                             _mm256_movemask_ps(_mm256_castsi256_ps(valid))))
+              .count());
+        }
+        return i;
+      } else {
+        (void)handles;
+        (void)count;
+        (void)indices;
+        (void)resolved;
+        return 0;
+      }
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    Index handle_table_t<Tag, Index, Gen, Allocator>::handles_at_avx2(
+      const Index first, const Index count,
+      typed_handle_t<Tag, Index, Gen>* handles) const
+    {
+      if constexpr (
+        std::is_same_v<Index, int32_t> && std::is_same_v<Gen, int32_t>) {
+        static_assert(sizeof(typed_handle_t<Tag, Index, Gen>) == 8);
+        static_assert(sizeof(internal_handle_t) == 8);
+
+        // gather offsets are scaled by two (internal handle stride) so
+        // ensure they cannot overflow
+        if (handles_.size() > std::numeric_limits<int32_t>::max() / 2) {
+          return 0;
+        }
+
+        const auto* base = reinterpret_cast<const int*>(handles_.data());
+        const __m256i minus_one = _mm256_set1_epi32(-1);
+
+        Index i = 0;
+        for (; i + 8 <= count; i += 8) {
+          const __m256i ids = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(element_ids_.data() + first + i));
+          // tombstones (-1) keep an id and generation of -1
+          const __m256i live = _mm256_cmpgt_epi32(ids, minus_one);
+          const __m256i offsets =
+            _mm256_and_si256(_mm256_add_epi32(ids, ids), live);
+          const __m256i gens =
+            _mm256_mask_i32gather_epi32(minus_one, base, offsets, live, 4);
+
+          // interleave ids and generations back into handles
+          const __m256i lo = _mm256_unpacklo_epi32(ids, gens);
+          const __m256i hi = _mm256_unpackhi_epi32(ids, gens);
+          _mm256_storeu_si256(
+            reinterpret_cast<__m256i*>(handles + i),
+            _mm256_permute2x128_si256(lo, hi, 0x20));
+          _mm256_storeu_si256(
+            reinterpret_cast<__m256i*>(handles + i + 4),
+            _mm256_permute2x128_si256(lo, hi, 0x31));
+        }
+        return i;
+      } else {
+        (void)first;
+        (void)count;
+        (void)handles;
+        return 0;
+      }
+    }
+#endif
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    void handle_table_t<Tag, Index, Gen, Allocator>::handles_at(
+      const Index first, const Index count,
+      typed_handle_t<Tag, Index, Gen>* handles) const
+    {
+      assert(first >= 0 && count >= 0 && first + count <= size());
+
+      Index i = 0;
+#if defined(__AVX2__)
+      i = handles_at_avx2(first, count, handles);
+#endif
+      const auto* ids = element_ids_.data() + first;
+      for (; i < count; i++) {
+        const auto id = ids[i];
+        handles[i] = {id, id == -1 ? Gen(-1) : handles_[id].gen_};
+      }
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    Index handle_table_t<Tag, Index, Gen, Allocator>::indices_from_handles(
+      const typed_handle_t<Tag, Index, Gen>* handles, const Index count,
+      Index* indices) const
+    {
+      assert(handles_.size() <= std::numeric_limits<Index>::max());
+
+      Index resolved = 0;
+      if (handles_.empty()) {
+        std::fill(indices, indices + count, Index(-1));
+        return resolved;
+      }
+
+      const auto handle_count = static_cast<Index>(handles_.size());
+      const auto element_count = size();
+
+      Index i = 0;
+#if defined(__AVX2__)
+      i = indices_from_handles_avx2(handles, count, indices, resolved);
+#endif
+      for (; i < count; i++) {
+        // warm the cache for handles that will be looked up shortly
+        if (i + resolve_prefetch_distance < count) {
+          const auto ahead = handles[i + resolve_prefetch_distance].id_;
+          if (ahead >= 0 && ahead < handle_count) {
+            prefetch(&handles_[ahead]);
+          }
+        }
+
+        const auto handle = handles[i];
+        // invalid ids are redirected to the first handle so the lookup is
+        // unconditional
+        const bool in_range = handle.id_ >= 0 && handle.id_ < handle_count;
+        const internal_handle_t& ih = handles_[in_range ? handle.id_ : 0];
+        const bool valid = in_range && ih.gen_ == handle.gen_
+                        && ih.lookup_ >= 0 && ih.lookup_ < element_count;
+        indices[i] = valid ? ih.lookup_ : Index(-1);
+        resolved += Index(valid);
+      }
+
+      return resolved;
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    template<typename... Iter>
+    void handle_table_t<Tag, Index, Gen, Allocator>::permute(
+      const Index begin, const Index end, Index* indices, Iter... iters)
+    {
+      assert(tombstones_ == 0);
+      // only handles of elements that move are updated
+      apply_permutation(
+        begin, end, indices,
+        [this](const Index position) {
+          handles_[element_ids_[position]].lookup_ = position;
+        },
+        element_ids_.begin(), iters...);
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    template<typename... Iter>
+    void handle_table_t<Tag, Index, Gen, Allocator>::permute(
+      const parallel_t parallel, const Index begin, const Index end,
+      const Index* indices, Iter... iters)
+    {
+      assert(tombstones_ == 0);
+      const auto count = size_t(end - begin);
+      // values are gathered one range at a time so the storage is shared
+      parallel_gather(
+        parallel, begin, end, indices, element_ids_.begin(),
+        gather_scratch<Index>(count));
+      (parallel_gather(
+         parallel, begin, end, indices, iters,
+         gather_scratch<typename std::iterator_traits<Iter>::value_type>(
+           count)),
+       ...);
+      // each position refers to a different handle so there is no overlap
+      // between threads
+      parallel_for(parallel, begin, end, [this](Index first, Index last) {
+        fixup_handles(first, last);
+      });
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    template<typename... Iter>
+    void handle_table_t<Tag, Index, Gen, Allocator>::gather(
+      const Index begin, const Index end, Index* indices, Iter... iters)
+    {
+      assert(tombstones_ == 0);
+      if constexpr ((
+                      copy_gatherable_v<
+                        typename std::iterator_traits<Iter>::value_type>
+                      && ...)) {
+        const auto count = size_t(end - begin);
+        // values are gathered one range at a time so the storage is shared
+        detail::gather(
+          begin, end, indices, element_ids_.begin(),
+          gather_scratch<Index>(count));
+        (detail::gather(
+           begin, end, indices, iters,
+           gather_scratch<typename std::iterator_traits<Iter>::value_type>(
+             count)),
+         ...);
+        fixup_handles(begin, end);
+      } else {
+        permute(begin, end, indices, iters...);
+      }
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    template<typename T, typename Compare>
+    void handle_table_t<Tag, Index, Gen, Allocator>::sort_elements(
+      const Index begin, const Index end, T* elements, Compare& compare)
+    {
+      assert(tombstones_ == 0);
+      using zip_iterator = zip_iterator_t<T, Index>;
+      std::sort(
+        zip_iterator(elements + begin, element_ids_.data() + begin),
+        zip_iterator(elements + end, element_ids_.data() + end),
+        [&compare](const auto& lhs, const auto& rhs) {
+          return compare(
+            zip_iterator::element(lhs), zip_iterator::element(rhs));
+        });
+      fixup_handles(begin, end);
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    Index* handle_table_t<Tag, Index, Gen, Allocator>::scratch(
+      const size_t count)
+    {
+      if (scratch_.size() < count) {
+        scratch_.resize(count);
+      }
+      return scratch_.data();
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    Index* handle_table_t<Tag, Index, Gen, Allocator>::scratch_positions(
+      const Index begin, const Index count)
+    {
+      auto* positions = scratch(count);
+      std::iota(positions, positions + count, begin);
+      return positions;
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    uint64_t* handle_table_t<Tag, Index, Gen, Allocator>::key_scratch(
+      const size_t count)
+    {
+      if (key_scratch_.size() < count) {
+        key_scratch_.resize(count);
+      }
+      return key_scratch_.data();
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    template<typename U>
+    void* handle_table_t<Tag, Index, Gen, Allocator>::gather_scratch(
+      const size_t count)
+    {
+      if constexpr (alignof(U) > alignof(gather_block_t)) {
+        return nullptr;
+      } else {
+        const auto blocks = (count * sizeof(U) + sizeof(gather_block_t) - 1)
+                          / sizeof(gather_block_t);
+        if (gather_scratch_.size() < blocks) {
+          gather_scratch_.resize(blocks);
+        }
+        return gather_scratch_.data();
+      }
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    template<typename Compare, typename SwapElements>
+    bool handle_table_t<Tag, Index, Gen, Allocator>::insertion_sort(
+      const Index begin, const Index end, Compare& compare,
+      SwapElements&& swap_elements, const size_t max_swaps)
+    {
+      assert(tombstones_ == 0);
+
+      size_t swaps = 0;
+      for (Index i = begin + 1; i < end; i++) {
+        for (Index j = i; j > begin && compare(j, j - 1); j--) {
+          if (swaps++ == max_swaps) {
+            return false;
+          }
+          swap_elements(j - 1, j);
+          std::swap(element_ids_[j - 1], element_ids_[j]);
+          handles_[element_ids_[j - 1]].lookup_ = j - 1;
+          handles_[element_ids_[j]].lookup_ = j;
+        }
+      }
+
+      return true;
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    void handle_table_t<Tag, Index, Gen, Allocator>::fixup_handles(
+      const Index begin, const Index end)
+    {
+      for (Index i = begin; i < end; ++i) {
+        handles_[element_ids_[i]].lookup_ = i;
+      }
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    void handle_table_t<Tag, Index, Gen, Allocator>::swap(
+      handle_table_t& other) noexcept
+    {
+      using std::swap;
+      element_ids_.swap(other.element_ids_);
+      handles_.swap(other.handles_);
+      live_.swap(other.live_);
+      swap(tombstones_, other.tombstones_);
+      scratch_.swap(other.scratch_);
+      key_scratch_.swap(other.key_scratch_);
+      gather_scratch_.swap(other.gather_scratch_);
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    void handle_table_t<Tag, Index, Gen, Allocator>::save(
+      std::ostream& stream) const
+    {
+      const uint64_t sizes[] = {
+        element_ids_.size(), handles_.size(), live_.size()};
+      const Index state[] = {
+        handles_.dequeue_, handles_.enqueue_, handles_.depleted_handles_,
+        tombstones_};
+      write_values(stream, sizes, std::size(sizes));
+      write_values(stream, state, std::size(state));
+      write_values(stream, element_ids_.data(), element_ids_.size());
+      write_values(stream, handles_.data(), handles_.size());
+      write_values(stream, live_.data(), live_.size());
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    bool handle_table_t<Tag, Index, Gen, Allocator>::load(std::istream& stream)
+    {
+      uint64_t sizes[3];
+      Index state[4];
+      if (
+        !read_values(stream, sizes, std::size(sizes))
+        || !read_values(stream, state, std::size(state))) {
+        return false;
+      }
+
+      // reject sizes that cannot have been written by a valid table (or that
+      // need more data than the stream holds, before allocating for them)
+      const auto [id_count, handle_count, live_count] = sizes;
+      if (
+        handle_count > static_cast<uint64_t>(limits_t::max_index)
+        || id_count > handle_count || live_count > (id_count + 63) / 64
+        || id_count * sizeof(Index) + handle_count * sizeof(internal_handle_t)
+               + live_count * sizeof(uint64_t)
+             > bytes_remaining(stream)) {
+        return false;
+      }
+
+      element_ids_.resize(id_count);
+      handles_.handles_.resize(handle_count);
+      live_.resize(live_count);
+      if (
+        !read_values(stream, element_ids_.data(), element_ids_.size())
+        || !read_values(
+          stream, handles_.handles_.data(), handles_.handles_.size())
+        || !read_values(stream, live_.data(), live_.size())) {
+        return false;
+      }
+
+      handles_.dequeue_ = state[0];
+      handles_.enqueue_ = state[1];
+      handles_.depleted_handles_ = state[2];
+      tombstones_ = state[3];
+
+      return valid();
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    bool handle_table_t<Tag, Index, Gen, Allocator>::valid() const
+    {
+      const auto id_count = static_cast<Index>(element_ids_.size());
+      const auto handle_count = static_cast<Index>(handles_.size());
+
+      // the live bitmap only exists while there are tombstones and then covers
+      // every element (with no bits set past the last one)
+      if (
+        live_.empty() != (tombstones_ == 0)
+        || (!live_.empty()
+            && live_.size() != (static_cast<size_t>(id_count) + 63) / 64)) {
+        return false;
+      }
+      if (
+        id_count % 64 != 0 && !live_.empty()
+        && (live_.back() >> (id_count % 64)) != 0) {
+        return false;
+      }
+
+      // each element maps to a distinct handle that maps back to it (or is a
+      // tombstone with its live bit clear)
+      Index tombstones = 0;
+      for (Index position = 0; position < id_count; position++) {
+        const auto id = element_ids_[position];
+        const bool live = live_.empty()
+                       || (live_[position / 64] >> (position % 64)) & 1;
+        if (id == -1) {
+          if (live) {
+            return false;
+          }
+          tombstones++;
+        } else if (
+          !live || id < 0 || id >= handle_count
+          || handles_[id].lookup_ != position) {
+          return false;
+        }
+      }
+      if (tombstones != tombstones_) {
+        return false;
+      }
+
+      // every handle in use is bound to an element
+      for (Index id = 0; id < handle_count; id++) {
+        const auto lookup = handles_[id].lookup_;
+        if (
+          lookup >= 0
+          && (lookup >= id_count || element_ids_[lookup] != id)) {
+          return false;
+        }
+      }
+
+      return handles_.valid();
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    std::string handle_table_t<Tag, Index, Gen, Allocator>::debug_string() const
+    {
+      constexpr std::string_view filled_glyph = "[o]";
+      constexpr std::string_view empty_glyph = "[x]";
+      constexpr std::string_view depleted_glyph = "[!]";
+
+      std::string buffer;
+      for (Index i = 0; i < capacity(); i++) {
+        std::string_view glyph;
+        if (handles_[i].gen_ == limits_t::max_gen) {
+          glyph = depleted_glyph;
+        } else if (handles_[i].lookup_ < 0) {
+          glyph = empty_glyph;
+        } else {
+          glyph = filled_glyph;
+        }
+        buffer.append(glyph);
+      }
+
+      return buffer;
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    change_set_t<Tag, Index, Gen, Allocator>::change_set_t(
+      const Allocator& allocator)
+      : bits_(bits_allocator_t(allocator)),
+        removed_(handle_allocator_t(allocator)),
+        moving_(moving_allocator_t(allocator))
+    {
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    uint64_t change_set_t<Tag, Index, Gen, Allocator>::get(
+      const Index position) const
+    {
+      const auto word = static_cast<size_t>(position) / 32;
+      if (word >= bits_.size()) {
+        return 0;
+      }
+      return (bits_[word] >> (position % 32 * 2)) & 3;
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    void change_set_t<Tag, Index, Gen, Allocator>::set(
+      const Index position, const uint64_t bits)
+    {
+      const auto word = static_cast<size_t>(position) / 32;
+      if (word >= bits_.size()) {
+        if (bits == 0) {
+          return;
+        }
+        bits_.resize(word + 1);
+      }
+      const auto shift = position % 32 * 2;
+      bits_[word] = (bits_[word] & ~(uint64_t(3) << shift)) | (bits << shift);
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    void change_set_t<Tag, Index, Gen, Allocator>::enable(
+      const bool enabled, const Index size)
+    {
+      if (enabled == enabled_) {
+        return;
+      }
+      enabled_ = enabled;
+      clear(size);
+      if (!enabled) {
+        shrink_to_fit();
+      }
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    bool change_set_t<Tag, Index, Gen, Allocator>::enabled() const
+    {
+      return enabled_;
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    void change_set_t<Tag, Index, Gen, Allocator>::modify(const Index position)
+    {
+      // kept to a single store (bits are allocated for every element while
+      // enabled) as this is invoked by operator[]
+      if (enabled_ && !paused_) {
+        assert(static_cast<size_t>(position) / 32 < bits_.size());
+        bits_[static_cast<size_t>(position) / 32] |= modified_bit
+                                                   << (position % 32 * 2);
+      }
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    void change_set_t<Tag, Index, Gen, Allocator>::pause(const bool paused)
+    {
+      paused_ = paused;
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    void change_set_t<Tag, Index, Gen, Allocator>::add(const Index position)
+    {
+      if (enabled_) {
+        set(position, added_bit);
+      }
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    void change_set_t<Tag, Index, Gen, Allocator>::add_n(
+      const Index position, const Index count)
+    {
+      if (!enabled_ || count == 0) {
+        return;
+      }
+      const auto first = static_cast<size_t>(position);
+      const auto last = first + static_cast<size_t>(count);
+      if (bits_.size() < (last + 31) / 32) {
+        bits_.resize((last + 31) / 32);
+      }
+      // replace the bits of up to a word of elements at a time
+      for (auto element = first; element < last;) {
+        const auto shift = element % 32 * 2;
+        const auto elements = std::min(32 - element % 32, last - element);
+        const auto mask =
+          (elements == 32 ? ~uint64_t(0) : (uint64_t(1) << elements * 2) - 1)
+          << shift;
+        auto& word = bits_[element / 32];
+        word = (word & ~mask) | (added_mask & mask);
+        element += elements;
+      }
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    void change_set_t<Tag, Index, Gen, Allocator>::remove(
+      const typed_handle_t<Tag, Index, Gen> handle, const Index position)
+    {
+      if (!enabled_) {
+        return;
+      }
+      // an element added and removed again never needs to be reported
+      if ((get(position) & added_bit) == 0) {
+        removed_.push_back(handle);
+      }
+      set(position, 0);
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    void change_set_t<Tag, Index, Gen, Allocator>::move(
+      const Index to, const Index from)
+    {
+      if (enabled_) {
+        set(to, get(from));
+      }
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    void change_set_t<Tag, Index, Gen, Allocator>::exchange(
+      const Index lhs, const Index rhs)
+    {
+      if (enabled_) {
+        const auto lhs_bits = get(lhs);
+        set(lhs, get(rhs));
+        set(rhs, lhs_bits);
+      }
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    void change_set_t<Tag, Index, Gen, Allocator>::erase(const Index position)
+    {
+      const auto first = static_cast<size_t>(position) / 32;
+      if (!enabled_ || first >= bits_.size()) {
+        return;
+      }
+
+      // shift the bits above position down by one element, then carry the
+      // first element of each following word into the word before it
+      const auto below = (uint64_t(1) << (position % 32 * 2)) - 1;
+      bits_[first] = (bits_[first] & below) | ((bits_[first] >> 2) & ~below);
+      for (size_t word = first + 1; word < bits_.size(); word++) {
+        bits_[word - 1] |= (bits_[word] & 3) << 62;
+        bits_[word] >>= 2;
+      }
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    void change_set_t<Tag, Index, Gen, Allocator>::truncate(const Index size)
+    {
+      const auto words = (static_cast<size_t>(size) + 31) / 32;
+      if (!enabled_ || words > bits_.size()) {
+        return;
+      }
+      bits_.resize(words);
+      if (size % 32 != 0) {
+        bits_.back() &= (uint64_t(1) << (size % 32 * 2)) - 1;
+      }
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    void change_set_t<Tag, Index, Gen, Allocator>::stash(
+      const handle_table_t<Tag, Index, Gen, Allocator>& handles,
+      const Index begin, const Index end)
+    {
+      paused_ = true;
+      if (!enabled_) {
+        return;
+      }
+
+      moving_.clear();
+      for (Index position = begin; position < end; position++) {
+        const auto word = static_cast<size_t>(position) / 32;
+        if (word >= bits_.size()) {
+          break;
+        }
+        // skip words with no changes
+        if (bits_[word] == 0) {
+          position = static_cast<Index>(word * 32 + 31);
+          continue;
+        }
+        if (const auto bits = get(position); bits != 0) {
+          moving_.push_back({handles.handle_at(position), bits});
+          set(position, 0);
+        }
+      }
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    void change_set_t<Tag, Index, Gen, Allocator>::restore(
+      const handle_table_t<Tag, Index, Gen, Allocator>& handles)
+    {
+      for (const auto& moving : moving_) {
+        set(handles.lookup(moving.handle_), moving.bits_);
+      }
+      moving_.clear();
+      paused_ = false;
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    template<typename Fn>
+    void change_set_t<Tag, Index, Gen, Allocator>::for_each_modified(
+      Fn&& fn) const
+    {
+      for (size_t word = 0; word < bits_.size(); word++) {
+        const auto bits = bits_[word];
+        for (uint64_t modified = bits & ~(bits >> 1) & modified_mask;
+             modified != 0; modified &= modified - 1) {
+          fn(static_cast<Index>(
+            word * 32 + count_trailing_zeros(modified) / 2));
+        }
+      }
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    template<typename Fn>
+    void change_set_t<Tag, Index, Gen, Allocator>::for_each_added(
+      Fn&& fn) const
+    {
+      for (size_t word = 0; word < bits_.size(); word++) {
+        for (uint64_t added = (bits_[word] >> 1) & modified_mask; added != 0;
+             added &= added - 1) {
+          fn(static_cast<Index>(word * 32 + count_trailing_zeros(added) / 2));
+        }
+      }
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    template<typename Fn>
+    void change_set_t<Tag, Index, Gen, Allocator>::for_each_removed(
+      Fn&& fn) const
+    {
+      for (const auto& handle : removed_) {
+        fn(handle);
+      }
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    void change_set_t<Tag, Index, Gen, Allocator>::clear(const Index size)
+    {
+      bits_.assign(enabled_ ? (static_cast<size_t>(size) + 31) / 32 : 0, 0);
+      removed_.clear();
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    void change_set_t<Tag, Index, Gen, Allocator>::shrink_to_fit()
+    {
+      bits_.shrink_to_fit();
+      removed_.shrink_to_fit();
+      moving_.shrink_to_fit();
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    size_t change_set_t<Tag, Index, Gen, Allocator>::memory_usage() const
+    {
+      return bits_.capacity() * sizeof(uint64_t)
+           + removed_.capacity() * sizeof(typed_handle_t<Tag, Index, Gen>)
+           + moving_.capacity() * sizeof(moving_t);
+    }
+
+    template<
+      typename Tag, typename Index, typename Gen, typename Allocator>
+    void change_set_t<Tag, Index, Gen, Allocator>::swap(
+      change_set_t& other) noexcept
+    {
+      using std::swap;
+      bits_.swap(other.bits_);
+      removed_.swap(other.removed_);
+      moving_.swap(other.moving_);
+      swap(enabled_, other.enabled_);
+      swap(paused_, other.paused_);
+    }
+  } // namespace detail
+
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  handle_vector_t<T, Tag, Index, Gen, Allocator>::handle_vector_t(
+    const Allocator& allocator)
+    : elements_(allocator), handles_(allocator), changes_(allocator)
+  {
+  }
+
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  auto handle_vector_t<T, Tag, Index, Gen, Allocator>::get_allocator() const
+    -> allocator_type
+  {
+    return elements_.get_allocator();
+  }
+
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  void handle_vector_t<T, Tag, Index, Gen, Allocator>::swap(
+    handle_vector_t& other)
+  {
+    using allocator_traits = std::allocator_traits<Allocator>;
+    if (
+      allocator_traits::propagate_on_container_swap::value
+      || get_allocator() == other.get_allocator()) {
+      elements_.swap(other.elements_);
+      handles_.swap(other.handles_);
+      changes_.swap(other.changes_);
+    } else {
+      // swapping vectors with unequal allocators that do not propagate is
+      // undefined, fallback to moving elements (each container keeps its
+      // allocator)
+      handle_vector_t temp(std::move(*this));
+      *this = std::move(other);
+      other = std::move(temp);
+    }
+  }
+
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  void swap(
+    handle_vector_t<T, Tag, Index, Gen, Allocator>& lhs,
+    handle_vector_t<T, Tag, Index, Gen, Allocator>& rhs)
+  {
+    lhs.swap(rhs);
+  }
+
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  bool handle_vector_t<T, Tag, Index, Gen, Allocator>::save(
+    std::ostream& stream) const
+  {
+    static_assert(
+      std::is_trivially_copyable_v<T>,
+      "T must be trivially copyable (provide a serializer otherwise).");
+
+    detail::write_header(stream, sizeof(Index), sizeof(Gen), sizeof(T));
+    handles_.save(stream);
+    detail::write_values(stream, elements_.data(), elements_.size());
+
+    return static_cast<bool>(stream);
   }
 
-  template<typename T, typename Tag, typename Index, typename Gen>
-  template<typename... Args>
-  typed_handle_t<Tag, Index, Gen> handle_vector_t<T, Tag, Index, Gen>::add(
-    Args&&... args)
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  template<typename Serialize>
+  bool handle_vector_t<T, Tag, Index, Gen, Allocator>::save(
+    std::ostream& stream, Serialize&& serialize) const
   {
-    const auto lookup = static_cast<Index>(elements_.size());
+    detail::write_header(stream, sizeof(Index), sizeof(Gen), 0);
+    handles_.save(stream);
+    for (const auto& element : elements_) {
+      serialize(stream, element);
+    }
+
+    return static_cast<bool>(stream);
+  }
 
-    assert(lookup <= std::numeric_limits<Index>::max());
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  bool handle_vector_t<T, Tag, Index, Gen, Allocator>::load(
+    std::istream& stream)
+  {
+    static_assert(
+      std::is_trivially_copyable_v<T>,
+      "T must be trivially copyable (provide a deserializer otherwise).");
 
-    // allocate new element
-    elements_.emplace_back(std::forward<Args>(args)...);
-    element_ids_.emplace_back();
+    elements_.clear();
+    changes_.clear(0);
+    if (
+      detail::read_header(stream, sizeof(Index), sizeof(Gen), sizeof(T))
+      && handles_.load(stream)) {
+      elements_.resize(handles_.size());
+      if (detail::read_values(stream, elements_.data(), elements_.size())) {
+        changes_.clear(size());
+        return true;
+      }
+    }
 
-    // if backing store increased, create additional
-    // handles for newly available elements
-    try_allocate_handles();
+    elements_.clear();
+    handles_ = decltype(handles_)(elements_.get_allocator());
+    return false;
+  }
 
-    while (dequeue_ < static_cast<Index>(handles_.size())
-           && handles_[dequeue_].gen_ == std::numeric_limits<Gen>::max()) {
-      // skip handle for allocation if generation has reached its limit
-      const auto dequeue_before = dequeue_;
-      dequeue_ = handles_[dequeue_].next_;
-      depleted_handles_++;
-      // ensure we don't get stuck in an infinite loop (may happen if we
-      // currently only have one handle and it uses up all its generations)
-      if (dequeue_before == dequeue_) {
-        dequeue_++;
-        break;
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  template<typename Deserialize>
+  bool handle_vector_t<T, Tag, Index, Gen, Allocator>::load(
+    std::istream& stream, Deserialize&& deserialize)
+  {
+    elements_.clear();
+    changes_.clear(0);
+    if (
+      detail::read_header(stream, sizeof(Index), sizeof(Gen), 0)
+      && handles_.load(stream)) {
+      elements_.reserve(handles_.size());
+      for (Index i = 0; i < handles_.size() && stream; i++) {
+        elements_.push_back(deserialize(stream));
+      }
+      if (stream) {
+        changes_.clear(size());
+        return true;
       }
     }
 
-    // if several handles have been depleted, create additional handles for
-    // available element capacity
-    try_allocate_handles();
+    elements_.clear();
+    handles_ = decltype(handles_)(elements_.get_allocator());
+    return false;
+  }
+
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  template<typename... Args>
+  typed_handle_t<Tag, Index, Gen> handle_vector_t<
+    T, Tag, Index, Gen, Allocator>::add(Args&&... args)
+  {
+    // allocate new element
+    elements_.emplace_back(std::forward<Args>(args)...);
+    changes_.add(static_cast<Index>(elements_.size() - 1));
 
-    const auto index = dequeue_;
-    // increment the generation of the handle
-    auto& internal_handle = handles_[index];
-    assert(internal_handle.lookup_ == -1); // ensure handle is free
-    internal_handle.gen_++;
+    return handles_.add(elements_.capacity());
+  }
 
-    // map handle to newly allocated element
-    internal_handle.lookup_ = lookup;
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  template<typename OutputIt, typename... Args>
+  OutputIt handle_vector_t<T, Tag, Index, Gen, Allocator>::add_n(
+    const Index count, OutputIt handles, const Args&... args)
+  {
+    assert(count >= 0);
+    assert(
+      elements_.size() + count
+      <= static_cast<size_t>(std::numeric_limits<Index>::max()));
+
+    // grow storage once so elements are not reallocated part way through
+    const auto required = elements_.size() + count;
+    if (required > elements_.capacity()) {
+      elements_.reserve(std::max(required, elements_.capacity() * 2));
+      handles_.reserve(elements_.capacity());
+    }
 
-    // map the element back to the handle it's bound to
-    element_ids_[lookup] = index;
-    // update the next available handle
-    dequeue_ = internal_handle.next_;
+    // construct every element before binding handles (removing the elements
+    // constructed so far if one throws so ids and elements stay in step)
+    const auto first = static_cast<Index>(elements_.size());
+    try {
+      for (Index i = 0; i < count; i++) {
+        elements_.emplace_back(args...);
+      }
+    } catch (...) {
+      while (elements_.size() > static_cast<size_t>(first)) {
+        elements_.pop_back();
+      }
+      throw;
+    }
 
-    return {index, internal_handle.gen_};
+    changes_.add_n(first, count);
+    return handles_.add_n(elements_.capacity(), count, handles);
   }
 
-  template<typename T, typename Tag, typename Index, typename Gen>
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
   template<typename Fn>
-  void handle_vector_t<T, Tag, Index, Gen>::call(
+  void handle_vector_t<T, Tag, Index, Gen, Allocator>::call(
     const typed_handle_t<Tag, Index, Gen> handle, Fn&& fn)
   {
     if (T* element = resolve(handle)) {
+      changes_.modify(static_cast<Index>(element - elements_.data()));
       fn(*element);
     }
   }
 
-  template<typename T, typename Tag, typename Index, typename Gen>
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
   template<typename Fn>
-  void handle_vector_t<T, Tag, Index, Gen>::call(
+  void handle_vector_t<T, Tag, Index, Gen, Allocator>::call(
     const typed_handle_t<Tag, Index, Gen> handle, Fn&& fn) const
   {
     if (const T* element = resolve(handle)) {
@@ -143,20 +2328,23 @@ namespace thh
     }
   }
 
-  template<typename T, typename Tag, typename Index, typename Gen>
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
   template<typename Fn>
-  decltype(auto) handle_vector_t<T, Tag, Index, Gen>::call_return(
+  decltype(auto) handle_vector_t<T, Tag, Index, Gen, Allocator>::call_return(
     typed_handle_t<Tag, Index, Gen> handle, Fn&& fn)
   {
     if (T* element = resolve(handle)) {
+      changes_.modify(static_cast<Index>(element - elements_.data()));
       return std::optional(fn(*element));
     }
     return std::optional<decltype(fn(*(static_cast<T*>(nullptr))))>{};
   }
 
-  template<typename T, typename Tag, typename Index, typename Gen>
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
   template<typename Fn>
-  decltype(auto) handle_vector_t<T, Tag, Index, Gen>::call_return(
+  decltype(auto) handle_vector_t<T, Tag, Index, Gen, Allocator>::call_return(
     typed_handle_t<Tag, Index, Gen> handle, Fn&& fn) const
   {
     if (const T* element = resolve(handle)) {
@@ -165,347 +2353,962 @@ namespace thh
     return std::optional<decltype(fn(*(static_cast<const T*>(nullptr))))>{};
   }
 
-  template<typename T, typename Tag, typename Index, typename Gen>
-  bool handle_vector_t<T, Tag, Index, Gen>::has(
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  bool handle_vector_t<T, Tag, Index, Gen, Allocator>::has(
     const typed_handle_t<Tag, Index, Gen> handle) const
   {
-    assert(handles_.size() <= std::numeric_limits<Index>::max());
-
-    if (handle.id_ < 0 || handle.id_ >= static_cast<Index>(handles_.size())) {
-      return false;
-    }
-
-    // ensure the handle matches the one stored internally
-    // and is referencing a valid element
-    const internal_handle_t& ih = handles_[handle.id_];
-    return ih.gen_ == handle.gen_ && ih.lookup_ >= 0
-        && ih.lookup_ < static_cast<Index>(elements_.size());
+    return handles_.has(handle);
   }
 
-  template<typename T, typename Tag, typename Index, typename Gen>
-  bool handle_vector_t<T, Tag, Index, Gen>::remove(
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  bool handle_vector_t<T, Tag, Index, Gen, Allocator>::remove(
     const typed_handle_t<Tag, Index, Gen> handle)
   {
-    assert(element_ids_.size() == elements_.size());
+    assert(handles_.size() == static_cast<Index>(elements_.size()));
 
     if (!has(handle)) {
       return false;
     }
 
-    using std::swap;
-    auto& internal_handle = handles_[handle.id_];
-    const auto lookup = internal_handle.lookup_;
-    // find the handle of the last element currently stored and have it
-    // point to the look-up of the element about to be removed
-    handles_[element_ids_.back()].lookup_ = lookup;
+    compact();
+
     // swap the last element with the element being removed and then pop_back
     // (the element and element_ids vector have a one to one mapping)
+    using std::swap;
+    changes_.remove(handle, handles_.lookup(handle));
+    const auto lookup = handles_.remove(handle);
     swap(elements_[lookup], elements_.back());
     elements_.pop_back();
-    swap(element_ids_[lookup], element_ids_.back());
-    element_ids_.pop_back();
+    changes_.move(lookup, size());
+    changes_.truncate(size());
+
+    return true;
+  }
+
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  template<typename InputIt>
+  Index handle_vector_t<T, Tag, Index, Gen, Allocator>::remove(
+    InputIt first, InputIt last)
+  {
+    assert(handles_.size() == static_cast<Index>(elements_.size()));
+
+    compact();
+
+    using std::swap;
+    const auto removed = handles_.remove(
+      first, last,
+      [this](const Index lhs, const Index rhs) {
+        swap(elements_[lhs], elements_[rhs]);
+        changes_.exchange(lhs, rhs);
+      },
+      [this](
+        const typed_handle_t<Tag, Index, Gen> handle, const Index position) {
+        changes_.remove(handle, position);
+      });
+    elements_.erase(elements_.begin() + handles_.size(), elements_.end());
+    changes_.truncate(size());
+
+    return removed;
+  }
+
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  bool handle_vector_t<T, Tag, Index, Gen, Allocator>::remove_deferred(
+    const typed_handle_t<Tag, Index, Gen> handle)
+  {
+    if (!has(handle)) {
+      return false;
+    }
+
+    changes_.remove(handle, handles_.lookup(handle));
+    handles_.remove_deferred(handle);
+
+    return true;
+  }
 
-    // free handle being removed (make ready for reuse)
-    internal_handle.lookup_ = -1;
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  void handle_vector_t<T, Tag, Index, Gen, Allocator>::compact()
+  {
+    if (handles_.tombstones() == 0) {
+      return;
+    }
 
-    handles_[handle.id_].next_ = handles_[enqueue_].next_;
-    handles_[enqueue_].next_ = handle.id_;
-    enqueue_ = handle.id_;
+    handles_.compact([this](const Index to, const Index from) {
+      elements_[to] = std::move(elements_[from]);
+      changes_.move(to, from);
+    });
+    elements_.erase(elements_.begin() + handles_.size(), elements_.end());
+    changes_.truncate(size());
+  }
 
-    if (dequeue_ == static_cast<Index>(handles_.size())) {
-      dequeue_ = enqueue_;
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  bool handle_vector_t<T, Tag, Index, Gen, Allocator>::erase_stable(
+    const typed_handle_t<Tag, Index, Gen> handle)
+  {
+    if (!has(handle)) {
+      return false;
     }
 
+    compact();
+
+    changes_.remove(handle, handles_.lookup(handle));
+    const auto lookup = handles_.erase_stable(handle);
+    elements_.erase(elements_.begin() + lookup);
+    changes_.erase(lookup);
+
     return true;
   }
 
-  template<typename T, typename Tag, typename Index, typename Gen>
-  Index handle_vector_t<T, Tag, Index, Gen>::size() const
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  template<typename InputIt>
+  Index handle_vector_t<T, Tag, Index, Gen, Allocator>::erase_stable(
+    InputIt first, InputIt last)
+  {
+    compact();
+
+    const auto removed = handles_.erase_stable(
+      first, last,
+      [this](const Index to, const Index from) {
+        elements_[to] = std::move(elements_[from]);
+        changes_.move(to, from);
+      },
+      [this](
+        const typed_handle_t<Tag, Index, Gen> handle, const Index position) {
+        changes_.remove(handle, position);
+      });
+    elements_.erase(elements_.begin() + handles_.size(), elements_.end());
+    changes_.truncate(size());
+
+    return removed;
+  }
+
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  Index handle_vector_t<T, Tag, Index, Gen, Allocator>::tombstone_count() const
+  {
+    return handles_.tombstones();
+  }
+
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  template<typename Fn>
+  void handle_vector_t<T, Tag, Index, Gen, Allocator>::for_each(Fn&& fn)
+  {
+    handles_.for_each_live(
+      [this, &fn](const Index position) { fn(elements_[position]); });
+  }
+
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  template<typename Fn>
+  void handle_vector_t<T, Tag, Index, Gen, Allocator>::for_each(Fn&& fn) const
+  {
+    handles_.for_each_live(
+      [this, &fn](const Index position) { fn(elements_[position]); });
+  }
+
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  template<typename Fn>
+  void handle_vector_t<T, Tag, Index, Gen, Allocator>::parallel_for_each(
+    const parallel_t parallel, Fn&& fn, const Index grain)
+  {
+    parallel_for_each(
+      detail::thread_executor_t{parallel}, std::forward<Fn>(fn), grain);
+  }
+
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  template<typename Fn>
+  void handle_vector_t<T, Tag, Index, Gen, Allocator>::parallel_for_each(
+    const parallel_t parallel, Fn&& fn, const Index grain) const
+  {
+    parallel_for_each(
+      detail::thread_executor_t{parallel}, std::forward<Fn>(fn), grain);
+  }
+
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  template<typename Executor, typename Fn>
+  void handle_vector_t<T, Tag, Index, Gen, Allocator>::parallel_for_each(
+    Executor&& executor, Fn&& fn, const Index grain)
+  {
+    detail::parallel_chunks(
+      executor, size(), grain, [this, &fn](int64_t, Index first, Index last) {
+        for (Index position = first; position < last; position++) {
+          if (const auto handle = handles_.handle_at(position);
+              handle.id_ != -1) {
+            fn(handle, elements_[position]);
+          }
+        }
+      });
+  }
+
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  template<typename Executor, typename Fn>
+  void handle_vector_t<T, Tag, Index, Gen, Allocator>::parallel_for_each(
+    Executor&& executor, Fn&& fn, const Index grain) const
+  {
+    detail::parallel_chunks(
+      executor, size(), grain, [this, &fn](int64_t, Index first, Index last) {
+        for (Index position = first; position < last; position++) {
+          if (const auto handle = handles_.handle_at(position);
+              handle.id_ != -1) {
+            fn(handle, elements_[position]);
+          }
+        }
+      });
+  }
+
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  template<typename U, typename Reduce, typename Transform>
+  U handle_vector_t<T, Tag, Index, Gen, Allocator>::parallel_transform_reduce(
+    const parallel_t parallel, U init, Reduce&& reduce, Transform&& transform,
+    const Index grain) const
+  {
+    return parallel_transform_reduce(
+      detail::thread_executor_t{parallel}, std::move(init),
+      std::forward<Reduce>(reduce), std::forward<Transform>(transform), grain);
+  }
+
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  template<typename Executor, typename U, typename Reduce, typename Transform>
+  U handle_vector_t<T, Tag, Index, Gen, Allocator>::parallel_transform_reduce(
+    Executor&& executor, U init, Reduce&& reduce, Transform&& transform,
+    const Index grain) const
+  {
+    // each chunk is reduced separately and the results are then combined in
+    // order (so the result does not depend on which thread ran which chunk)
+    std::vector<std::optional<U>> partials(
+      size() == 0 ? 0 : (size_t(size()) + grain - 1) / grain);
+    detail::parallel_chunks(
+      executor, size(), grain,
+      [this, &reduce, &transform, &partials](
+        const int64_t chunk, const Index first, const Index last) {
+        auto& partial = partials[chunk];
+        for (Index position = first; position < last; position++) {
+          if (const auto handle = handles_.handle_at(position);
+              handle.id_ != -1) {
+            auto value = transform(handle, elements_[position]);
+            partial = partial.has_value()
+                      ? reduce(std::move(*partial), std::move(value))
+                      : std::move(value);
+          }
+        }
+      });
+    for (auto& partial : partials) {
+      if (partial.has_value()) {
+        init = reduce(std::move(init), std::move(*partial));
+      }
+    }
+    return init;
+  }
+
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  Index handle_vector_t<T, Tag, Index, Gen, Allocator>::size() const
   {
-    assert(element_ids_.size() == elements_.size());
-    assert(elements_.size() <= std::numeric_limits<Index>::max());
-    return static_cast<Index>(elements_.size());
+    assert(handles_.size() == static_cast<Index>(elements_.size()));
+    return handles_.size();
   }
 
-  template<typename T, typename Tag, typename Index, typename Gen>
-  Index handle_vector_t<T, Tag, Index, Gen>::capacity() const
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  Index handle_vector_t<T, Tag, Index, Gen, Allocator>::capacity() const
   {
-    assert(handles_.size() <= std::numeric_limits<Index>::max());
-    return static_cast<Index>(handles_.size());
+    return handles_.capacity();
   }
 
-  template<typename T, typename Tag, typename Index, typename Gen>
-  const T* handle_vector_t<T, Tag, Index, Gen>::resolve(
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  const T* handle_vector_t<T, Tag, Index, Gen, Allocator>::resolve(
     const typed_handle_t<Tag, Index, Gen> handle) const
   {
     if (!has(handle)) {
       return nullptr;
     }
-    return &elements_[handles_[handle.id_].lookup_];
+    return &elements_[handles_.lookup(handle)];
   }
 
-  template<typename T, typename Tag, typename Index, typename Gen>
-  T* handle_vector_t<T, Tag, Index, Gen>::resolve(
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  T* handle_vector_t<T, Tag, Index, Gen, Allocator>::resolve(
     const typed_handle_t<Tag, Index, Gen> handle)
   {
     return const_cast<T*>(
       static_cast<const handle_vector_t&>(*this).resolve(handle));
   }
 
-  template<typename T, typename Tag, typename Index, typename Gen>
-  void handle_vector_t<T, Tag, Index, Gen>::reserve(const Index capacity)
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  template<typename Order>
+  void handle_vector_t<T, Tag, Index, Gen, Allocator>::reorder(
+    const Index begin, const Index end, Order&& order)
+  {
+    compact();
+    const auto range = std::min(size() - begin, end - begin);
+    changes_.stash(handles_, begin, begin + range);
+    auto* indices = handles_.scratch_positions(begin, range);
+    order(indices, indices + range);
+    handles_.permute(begin, begin + range, indices, elements_.begin());
+    changes_.restore(handles_);
+  }
+
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  void handle_vector_t<T, Tag, Index, Gen, Allocator>::reserve(
+    const Index capacity)
   {
     assert(capacity > 0);
 
     elements_.reserve(capacity);
-    element_ids_.reserve(capacity);
-
-    try_allocate_handles();
+    handles_.reserve(elements_.capacity());
   }
 
-  template<typename T, typename Tag, typename Index, typename Gen>
-  void handle_vector_t<T, Tag, Index, Gen>::clear()
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  void handle_vector_t<T, Tag, Index, Gen, Allocator>::clear()
   {
-    assert(handles_.size() <= std::numeric_limits<Index>::max());
-
+    if (changes_.enabled()) {
+      handles_.for_each_live([this](const Index position) {
+        changes_.remove(handles_.handle_at(position), position);
+      });
+      changes_.truncate(0);
+    }
     elements_.clear();
-    element_ids_.clear();
+    handles_.clear();
+  }
 
-    // reset handles but leave generation untouched (ensures existing external
-    // handles cannot be used again with the container)
-    for (size_t i = 0; i < handles_.size(); i++) {
-      handles_[i].lookup_ = -1;
-      handles_[i].next_ = static_cast<Index>(i) + 1;
-    }
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  void handle_vector_t<T, Tag, Index, Gen, Allocator>::shrink_to_fit()
+  {
+    compact();
+    elements_.shrink_to_fit();
+    handles_.shrink_to_fit();
+    changes_.shrink_to_fit();
+  }
 
-    depleted_handles_ = 0;
-    dequeue_ = 0;
-    enqueue_ = static_cast<Index>(handles_.size() - 1);
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  memory_usage_t handle_vector_t<T, Tag, Index, Gen, Allocator>::memory_usage()
+    const
+  {
+    auto memory_usage = handles_.memory_usage();
+    memory_usage.element_bytes_ = elements_.capacity() * sizeof(T);
+    memory_usage.id_bytes_ += changes_.memory_usage();
+    return memory_usage;
   }
 
-  template<typename T, typename Tag, typename Index, typename Gen>
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
   typed_handle_t<Tag, Index, Gen> handle_vector_t<
-    T, Tag, Index, Gen>::handle_from_index(const Index index) const
+    T, Tag, Index, Gen, Allocator>::handle_from_index(const Index index) const
   {
-    if (index < 0 || index >= static_cast<Index>(element_ids_.size())) {
-      return typed_handle_t<Tag, Index, Gen>{};
-    }
-    const auto handle = element_ids_[index];
-    return {handle, handles_[handle].gen_};
+    return handles_.handle_from_index(index);
   }
 
-  template<typename T, typename Tag, typename Index, typename Gen>
-  std::optional<Index> handle_vector_t<T, Tag, Index, Gen>::index_from_handle(
-    const typed_handle_t<Tag, Index, Gen> handle) const
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  std::optional<Index> handle_vector_t<T, Tag, Index, Gen, Allocator>::
+    index_from_handle(const typed_handle_t<Tag, Index, Gen> handle) const
   {
-    if (!has(handle)) {
-      return std::nullopt;
+    return handles_.index_from_handle(handle);
+  }
+
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  Index handle_vector_t<T, Tag, Index, Gen, Allocator>::indices_from_handles(
+    const typed_handle_t<Tag, Index, Gen>* handles, const Index count,
+    Index* indices) const
+  {
+    return handles_.indices_from_handles(handles, count, indices);
+  }
+
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  void handle_vector_t<T, Tag, Index, Gen, Allocator>::handles_from_indices(
+    const Index first, const Index count,
+    typed_handle_t<Tag, Index, Gen>* handles) const
+  {
+    handles_.handles_at(first, count, handles);
+  }
+
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  Index handle_vector_t<T, Tag, Index, Gen, Allocator>::resolve_many(
+    const typed_handle_t<Tag, Index, Gen>* handles, const Index count,
+    const T** elements) const
+  {
+    // resolve indices in fixed size blocks to avoid allocating
+    constexpr Index block_size = 64;
+    Index indices[block_size];
+
+    Index resolved = 0;
+    for (Index begin = 0; begin < count; begin += block_size) {
+      const auto block_count = std::min(block_size, Index(count - begin));
+      resolved += indices_from_handles(handles + begin, block_count, indices);
+      for (Index i = 0; i < block_count; i++) {
+        elements[begin + i] =
+          indices[i] == -1 ? nullptr : elements_.data() + indices[i];
+      }
     }
-    return handles_[handle.id_].lookup_;
+
+    return resolved;
+  }
+
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  Index handle_vector_t<T, Tag, Index, Gen, Allocator>::resolve_many(
+    const typed_handle_t<Tag, Index, Gen>* handles, const Index count,
+    T** elements)
+  {
+    return static_cast<const handle_vector_t&>(*this).resolve_many(
+      handles, count, const_cast<const T**>(elements));
   }
 
-  template<typename T, typename Tag, typename Index, typename Gen>
-  bool handle_vector_t<T, Tag, Index, Gen>::empty() const
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  bool handle_vector_t<T, Tag, Index, Gen, Allocator>::empty() const
   {
-    assert(elements_.empty() == element_ids_.empty());
+    assert(elements_.size() == static_cast<size_t>(handles_.size()));
     return elements_.empty();
   }
 
-  template<typename T, typename Tag, typename Index, typename Gen>
-  T& handle_vector_t<T, Tag, Index, Gen>::operator[](const Index position)
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  T& handle_vector_t<T, Tag, Index, Gen, Allocator>::operator[](
+    const Index position)
   {
+    changes_.modify(position);
     return const_cast<T&>(
-      static_cast<const handle_vector_t<T, Tag, Index, Gen>&>(*this).operator[](
-        position));
+      static_cast<const handle_vector_t&>(*this).operator[](position));
   }
 
-  template<typename T, typename Tag, typename Index, typename Gen>
-  const T& handle_vector_t<T, Tag, Index, Gen>::operator[](
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  const T& handle_vector_t<T, Tag, Index, Gen, Allocator>::operator[](
     const Index position) const
   {
     assert(position <= static_cast<int64_t>(elements_.size()));
     return elements_[position];
   }
 
-  template<typename T, typename Tag, typename Index, typename Gen>
-  T* handle_vector_t<T, Tag, Index, Gen>::data()
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  T* handle_vector_t<T, Tag, Index, Gen, Allocator>::data()
   {
-    return const_cast<T*>(
-      static_cast<const handle_vector_t<T, Tag, Index, Gen>&>(*this).data());
+    return const_cast<T*>(static_cast<const handle_vector_t&>(*this).data());
   }
 
-  template<typename T, typename Tag, typename Index, typename Gen>
-  const T* handle_vector_t<T, Tag, Index, Gen>::data() const
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  const T* handle_vector_t<T, Tag, Index, Gen, Allocator>::data() const
   {
     return elements_.data();
   }
 
-  template<typename T, typename Tag, typename Index, typename Gen>
-  auto handle_vector_t<T, Tag, Index, Gen>::begin() -> iterator
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  auto handle_vector_t<T, Tag, Index, Gen, Allocator>::begin() -> iterator
   {
     return elements_.begin();
   }
 
-  template<typename T, typename Tag, typename Index, typename Gen>
-  auto handle_vector_t<T, Tag, Index, Gen>::begin() const -> const_iterator
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  auto handle_vector_t<T, Tag, Index, Gen, Allocator>::begin() const
+    -> const_iterator
   {
     return elements_.begin();
   }
 
-  template<typename T, typename Tag, typename Index, typename Gen>
-  auto handle_vector_t<T, Tag, Index, Gen>::cbegin() const -> const_iterator
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  auto handle_vector_t<T, Tag, Index, Gen, Allocator>::cbegin() const
+    -> const_iterator
   {
     return elements_.cbegin();
   }
 
-  template<typename T, typename Tag, typename Index, typename Gen>
-  auto handle_vector_t<T, Tag, Index, Gen>::rbegin() -> reverse_iterator
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  auto handle_vector_t<T, Tag, Index, Gen, Allocator>::rbegin()
+    -> reverse_iterator
   {
     return elements_.rbegin();
   }
 
-  template<typename T, typename Tag, typename Index, typename Gen>
-  auto handle_vector_t<T, Tag, Index, Gen>::rbegin() const
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  auto handle_vector_t<T, Tag, Index, Gen, Allocator>::rbegin() const
     -> const_reverse_iterator
   {
     return elements_.rbegin();
   }
 
-  template<typename T, typename Tag, typename Index, typename Gen>
-  auto handle_vector_t<T, Tag, Index, Gen>::crbegin() const
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  auto handle_vector_t<T, Tag, Index, Gen, Allocator>::crbegin() const
     -> const_reverse_iterator
   {
     return elements_.crbegin();
   }
 
-  template<typename T, typename Tag, typename Index, typename Gen>
-  auto handle_vector_t<T, Tag, Index, Gen>::end() -> iterator
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  auto handle_vector_t<T, Tag, Index, Gen, Allocator>::end() -> iterator
   {
     return elements_.end();
   }
 
-  template<typename T, typename Tag, typename Index, typename Gen>
-  auto handle_vector_t<T, Tag, Index, Gen>::end() const -> const_iterator
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  auto handle_vector_t<T, Tag, Index, Gen, Allocator>::end() const
+    -> const_iterator
   {
     return elements_.end();
   }
 
-  template<typename T, typename Tag, typename Index, typename Gen>
-  auto handle_vector_t<T, Tag, Index, Gen>::cend() const -> const_iterator
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  auto handle_vector_t<T, Tag, Index, Gen, Allocator>::cend() const
+    -> const_iterator
   {
     return elements_.cend();
   }
 
-  template<typename T, typename Tag, typename Index, typename Gen>
-  auto handle_vector_t<T, Tag, Index, Gen>::rend() -> reverse_iterator
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  auto handle_vector_t<T, Tag, Index, Gen, Allocator>::rend()
+    -> reverse_iterator
   {
     return elements_.rend();
   }
 
-  template<typename T, typename Tag, typename Index, typename Gen>
-  auto handle_vector_t<T, Tag, Index, Gen>::rend() const
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  auto handle_vector_t<T, Tag, Index, Gen, Allocator>::rend() const
     -> const_reverse_iterator
   {
     return elements_.rend();
   }
 
-  template<typename T, typename Tag, typename Index, typename Gen>
-  auto handle_vector_t<T, Tag, Index, Gen>::crend() const
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  auto handle_vector_t<T, Tag, Index, Gen, Allocator>::crend() const
     -> const_reverse_iterator
   {
     return elements_.crend();
   }
 
-  namespace detail
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  auto handle_vector_t<T, Tag, Index, Gen, Allocator>::items() -> items_t<T>
   {
-    // inspired by Raymond Chen, OldNewThing blog
-    // https://devblogs.microsoft.com/oldnewthing/20170102-00/?p=95095
-    template<typename Index, typename... Iter>
-    void apply_permutation(
-      const Index begin, const Index end, std::vector<Index>& indices,
-      Iter... iters)
-    {
-      using std::swap;
-      for (Index i = begin; i < end; i++) {
-        auto current = i;
-        while (i != indices[current - begin]) {
-          const auto next = indices[current - begin];
-          ([&](const auto it) { swap(it[current], it[next]); }(iters), ...);
-          indices[current - begin] = current;
-          current = next;
-        }
-        indices[current - begin] = current;
-      }
+    return {
+      item_iterator_t<T>(&handles_, elements_.data(), 0),
+      item_iterator_t<T>(&handles_, elements_.data(), size())};
+  }
+
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  auto handle_vector_t<T, Tag, Index, Gen, Allocator>::items() const
+    -> items_t<const T>
+  {
+    return {
+      item_iterator_t<const T>(&handles_, elements_.data(), 0),
+      item_iterator_t<const T>(&handles_, elements_.data(), size())};
+  }
+
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  template<typename Fn>
+  void handle_vector_t<T, Tag, Index, Gen, Allocator>::for_each_item_chunk(
+    Fn&& fn)
+  {
+    typed_handle_t<Tag, Index, Gen> handles[detail::item_chunk_size];
+    for (Index first = 0; first < size();
+         first += Index(detail::item_chunk_size)) {
+      const auto count =
+        std::min(Index(detail::item_chunk_size), size() - first);
+      handles_.handles_at(first, count, handles);
+      fn(static_cast<const typed_handle_t<Tag, Index, Gen>*>(handles),
+         elements_.data() + first, count);
     }
-  } // namespace detail
+  }
 
-  template<typename T, typename Tag, typename Index, typename Gen>
-  void handle_vector_t<T, Tag, Index, Gen>::fixup_handles(
-    const Index begin, const Index end)
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  template<typename Fn>
+  void handle_vector_t<T, Tag, Index, Gen, Allocator>::for_each_item_chunk(
+    Fn&& fn) const
   {
-    for (Index i = begin; i < end; ++i) {
-      handles_[element_ids_[i - begin]].lookup_ = i - begin;
+    typed_handle_t<Tag, Index, Gen> handles[detail::item_chunk_size];
+    for (Index first = 0; first < size();
+         first += Index(detail::item_chunk_size)) {
+      const auto count =
+        std::min(Index(detail::item_chunk_size), size() - first);
+      handles_.handles_at(first, count, handles);
+      fn(static_cast<const typed_handle_t<Tag, Index, Gen>*>(handles),
+         elements_.data() + first, count);
     }
   }
 
-  template<typename T, typename Tag, typename Index, typename Gen>
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
   template<typename Compare>
-  void handle_vector_t<T, Tag, Index, Gen>::sort(Compare&& compare)
+  void handle_vector_t<T, Tag, Index, Gen, Allocator>::sort(Compare&& compare)
   {
     sort(Index(0), size(), std::forward<Compare>(compare));
   }
 
-  template<typename T, typename Tag, typename Index, typename Gen>
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  template<typename Compare>
+  void handle_vector_t<T, Tag, Index, Gen, Allocator>::sort(
+    const Index begin, const Index end, Compare&& compare)
+  {
+    reorder(begin, end, [&compare](Index* first, Index* last) {
+      std::sort(first, last, compare);
+    });
+  }
+
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  template<typename Predicate>
+  Index handle_vector_t<T, Tag, Index, Gen, Allocator>::partition(
+    Predicate&& predicate)
+  {
+    Index second = 0;
+    reorder(Index(0), size(), [&predicate, &second](Index* first, Index* last) {
+      second = Index(std::partition(first, last, predicate) - first);
+    });
+    return second;
+  }
+
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  template<typename Compare>
+  void handle_vector_t<T, Tag, Index, Gen, Allocator>::stable_sort(
+    Compare&& compare)
+  {
+    stable_sort(Index(0), size(), std::forward<Compare>(compare));
+  }
+
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
   template<typename Compare>
-  void handle_vector_t<T, Tag, Index, Gen>::sort(
+  void handle_vector_t<T, Tag, Index, Gen, Allocator>::stable_sort(
     const Index begin, const Index end, Compare&& compare)
   {
+    reorder(begin, end, [&compare](Index* first, Index* last) {
+      std::stable_sort(first, last, compare);
+    });
+  }
+
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  template<typename Compare>
+  void handle_vector_t<T, Tag, Index, Gen, Allocator>::partial_sort(
+    const Index middle, Compare&& compare)
+  {
+    reorder(Index(0), size(), [&compare, middle](Index* first, Index* last) {
+      const auto count = Index(last - first);
+      std::partial_sort(first, first + std::min(middle, count), last, compare);
+    });
+  }
+
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  template<typename Compare>
+  void handle_vector_t<T, Tag, Index, Gen, Allocator>::nth_element(
+    const Index nth, Compare&& compare)
+  {
+    reorder(Index(0), size(), [&compare, nth](Index* first, Index* last) {
+      if (nth < last - first) {
+        std::nth_element(first, first + nth, last, compare);
+      }
+    });
+  }
+
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  template<typename Predicate>
+  Index handle_vector_t<T, Tag, Index, Gen, Allocator>::stable_partition(
+    Predicate&& predicate)
+  {
+    Index second = 0;
+    reorder(Index(0), size(), [&predicate, &second](Index* first, Index* last) {
+      second = Index(std::stable_partition(first, last, predicate) - first);
+    });
+    return second;
+  }
+
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  template<typename Compare>
+  void handle_vector_t<T, Tag, Index, Gen, Allocator>::sort(
+    const parallel_t parallel, Compare&& compare)
+  {
+    sort(parallel, Index(0), size(), std::forward<Compare>(compare));
+  }
+
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  template<typename Compare>
+  void handle_vector_t<T, Tag, Index, Gen, Allocator>::sort(
+    const parallel_t parallel, const Index begin, const Index end,
+    Compare&& compare)
+  {
+    compact();
     const auto range = std::min(size() - begin, end - begin);
-    std::vector<Index> indices(range);
-    std::iota(indices.begin(), indices.end(), begin);
-    std::sort(indices.begin(), indices.end(), std::forward<Compare>(compare));
-    detail::apply_permutation<Index>(
-      begin, begin + range, indices, elements_.begin(), element_ids_.begin());
-    fixup_handles(begin, begin + range);
+    // first half holds the indices and the second is used while merging
+    changes_.stash(handles_, begin, begin + range);
+    auto* indices = handles_.scratch(size_t(range) * 2);
+    std::iota(indices, indices + range, begin);
+    const auto* sorted = detail::parallel_sort(
+      parallel, indices, indices + range, range, compare);
+    handles_.permute(
+      parallel, begin, begin + range, sorted, elements_.begin());
+    changes_.restore(handles_);
   }
 
-  template<typename T, typename Tag, typename Index, typename Gen>
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
   template<typename Predicate>
-  Index handle_vector_t<T, Tag, Index, Gen>::partition(Predicate&& predicate)
+  Index handle_vector_t<T, Tag, Index, Gen, Allocator>::partition(
+    const parallel_t parallel, Predicate&& predicate)
   {
-    std::vector<Index> indices(size());
-    std::iota(indices.begin(), indices.end(), 0);
-    const auto second = std::partition(
-      indices.begin(), indices.end(), std::forward<Predicate>(predicate));
-    detail::apply_permutation(
-      Index(0), size(), indices, elements_.begin(), element_ids_.begin());
-    fixup_handles(Index(0), size());
-    return Index(second - indices.begin());
+    compact();
+    const auto count = size();
+    changes_.stash(handles_, Index(0), count);
+    // the indices are followed by the partitioned result and then the
+    // offsets of each run
+    const auto runs = detail::parallel_thread_count(parallel, count);
+    auto* indices = handles_.scratch(size_t(count) * 2 + size_t(runs) * 3);
+    std::iota(indices, indices + count, Index(0));
+    const auto second = detail::parallel_partition(
+      parallel, indices, indices + count, indices + size_t(count) * 2, count,
+      predicate);
+    handles_.permute(
+      parallel, Index(0), count, indices + count, elements_.begin());
+    changes_.restore(handles_);
+    return second;
   }
 
-  template<typename T, typename Tag, typename Index, typename Gen>
-  std::string debug_handles(
-    const handle_vector_t<T, Tag, Index, Gen>& handle_vector)
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  template<typename Compare>
+  void handle_vector_t<T, Tag, Index, Gen, Allocator>::sort_elements(
+    Compare&& compare)
+  {
+    sort_elements(Index(0), size(), std::forward<Compare>(compare));
+  }
+
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  template<typename Compare>
+  void handle_vector_t<T, Tag, Index, Gen, Allocator>::sort_elements(
+    const Index begin, const Index end, Compare&& compare)
+  {
+    compact();
+    const auto range = std::min(size() - begin, end - begin);
+    changes_.stash(handles_, begin, begin + range);
+    if constexpr (detail::cheap_to_swap_v<T>) {
+      handles_.sort_elements(begin, begin + range, elements_.data(), compare);
+    } else {
+      auto* indices = handles_.scratch_positions(begin, range);
+      std::sort(
+        indices, indices + range,
+        [this, &compare](const Index lhs, const Index rhs) {
+          return compare(elements_[lhs], elements_[rhs]);
+        });
+      handles_.permute(begin, begin + range, indices, elements_.begin());
+    }
+    changes_.restore(handles_);
+  }
+
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  template<typename Compare>
+  void handle_vector_t<T, Tag, Index, Gen, Allocator>::incremental_sort(
+    Compare&& compare)
   {
-    constexpr std::string_view filled_glyph = "[o]";
-    constexpr std::string_view empty_glyph = "[x]";
-    constexpr std::string_view depleted_glyph = "[!]";
+    incremental_sort(Index(0), size(), std::forward<Compare>(compare));
+  }
+
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  template<typename Compare>
+  void handle_vector_t<T, Tag, Index, Gen, Allocator>::incremental_sort(
+    const Index begin, const Index end, Compare&& compare)
+  {
+    compact();
+    const auto range = std::min(size() - begin, end - begin);
+    // allow as many swaps as there are elements so the work before falling
+    // back to a full sort is linear in the size of the range
+    changes_.pause(true);
+    const bool sorted = handles_.insertion_sort(
+      begin, begin + range, compare,
+      [this](const Index lhs, const Index rhs) {
+        using std::swap;
+        swap(elements_[lhs], elements_[rhs]);
+        changes_.exchange(lhs, rhs);
+      },
+      static_cast<size_t>(range));
+    changes_.pause(false);
+    if (!sorted) {
+      sort(begin, begin + range, std::forward<Compare>(compare));
+    }
+  }
+
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  template<typename KeyExtractor>
+  void handle_vector_t<T, Tag, Index, Gen, Allocator>::sort_by_key(
+    KeyExtractor&& key_extractor)
+  {
+    sort_by_key(
+      Index(0), size(), std::forward<KeyExtractor>(key_extractor));
+  }
+
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  template<typename KeyExtractor>
+  void handle_vector_t<T, Tag, Index, Gen, Allocator>::sort_by_key(
+    const Index begin, const Index end, KeyExtractor&& key_extractor)
+  {
+    compact();
+    const auto range = std::min(size() - begin, end - begin);
+    const auto count = static_cast<size_t>(range);
+    changes_.stash(handles_, begin, begin + range);
+
+    using key_bits_t = decltype(detail::radix_key(
+      key_extractor(std::declval<const T&>())));
+    // keys of up to 32 bits are stored in the upper half of a single word
+    // with the position of the element in the lower half, otherwise keys and
+    // positions are stored separately
+    constexpr bool packed = sizeof(key_bits_t) <= 4 && sizeof(Index) <= 4;
+    auto* keys = handles_.key_scratch(count * (packed ? 2 : 4));
+    auto* key_buffer = keys + count;
+    auto* values = packed ? nullptr : keys + count * 2;
+    auto* value_buffer = packed ? nullptr : keys + count * 3;
+    for (size_t i = 0; i < count; i++) {
+      const auto position = begin + static_cast<Index>(i);
+      const uint64_t key = detail::radix_key(
+        key_extractor(std::as_const(elements_[position])));
+      if constexpr (packed) {
+        keys[i] = (key << 32) | static_cast<uint32_t>(position);
+      } else {
+        keys[i] = key;
+        values[i] = static_cast<uint64_t>(position);
+      }
+    }
 
-    const auto& handles = handle_vector.handles_;
+    constexpr int first_byte = packed ? 4 : 0;
+    constexpr int last_byte = first_byte + int(sizeof(key_bits_t));
+    if (detail::radix_sort(
+          keys, values, key_buffer, value_buffer, count, first_byte,
+          last_byte)) {
+      std::swap(keys, key_buffer);
+      std::swap(values, value_buffer);
+    }
 
-    std::string buffer;
-    for (Index i = 0; i < handle_vector.capacity(); i++) {
-      std::string_view glyph;
-      if (handles[i].gen_ == std::numeric_limits<Gen>::max()) {
-        glyph = depleted_glyph;
-      } else if (handles[i].lookup_ == -1) {
-        glyph = empty_glyph;
+    auto* indices = handles_.scratch(count);
+    for (size_t i = 0; i < count; i++) {
+      if constexpr (packed) {
+        indices[i] = static_cast<Index>(static_cast<uint32_t>(keys[i]));
       } else {
-        glyph = filled_glyph;
+        indices[i] = static_cast<Index>(values[i]);
       }
-      buffer.append(glyph);
     }
+    // gathering elements through a buffer is faster than following
+    // permutation cycles for the scattered order a sort produces
+    handles_.gather(begin, begin + range, indices, elements_.begin());
+    changes_.restore(handles_);
+  }
+
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  void handle_vector_t<T, Tag, Index, Gen, Allocator>::track_changes(
+    const bool enabled)
+  {
+    changes_.enable(enabled, size());
+  }
+
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  bool handle_vector_t<T, Tag, Index, Gen, Allocator>::tracking_changes() const
+  {
+    return changes_.enabled();
+  }
+
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  void handle_vector_t<T, Tag, Index, Gen, Allocator>::mark_dirty(
+    const typed_handle_t<Tag, Index, Gen> handle)
+  {
+    if (has(handle)) {
+      changes_.modify(handles_.lookup(handle));
+    }
+  }
+
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  template<typename Fn>
+  void handle_vector_t<T, Tag, Index, Gen, Allocator>::for_each_dirty(
+    Fn&& fn) const
+  {
+    changes_.for_each_modified([this, &fn](const Index position) {
+      // skip tombstones (accessed through operator[] after removal)
+      if (const auto handle = handles_.handle_at(position); handle.id_ != -1) {
+        fn(handle, elements_[position]);
+      }
+    });
+  }
+
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  template<typename Fn>
+  void handle_vector_t<T, Tag, Index, Gen, Allocator>::for_each_added(
+    Fn&& fn) const
+  {
+    changes_.for_each_added([this, &fn](const Index position) {
+      fn(handles_.handle_at(position), elements_[position]);
+    });
+  }
+
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  template<typename Fn>
+  void handle_vector_t<T, Tag, Index, Gen, Allocator>::for_each_removed(
+    Fn&& fn) const
+  {
+    changes_.for_each_removed(std::forward<Fn>(fn));
+  }
+
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  void handle_vector_t<T, Tag, Index, Gen, Allocator>::clear_dirty()
+  {
+    changes_.clear(size());
+  }
 
-    return buffer;
+  template<
+    typename T, typename Tag, typename Index, typename Gen, typename Allocator>
+  std::string debug_handles(
+    const handle_vector_t<T, Tag, Index, Gen, Allocator>& handle_vector)
+  {
+    return handle_vector.handles_.debug_string();
   }
 } // namespace thh
@@ -0,0 +1,236 @@
+#pragma once
+
+#include "handle-registry.hpp"
+#include "handle-vector.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace thh
+{
+  namespace detail
+  {
+    // number of driving elements resolved at a time by a join (lookups for a
+    // whole block are issued before any element is visited)
+    constexpr int join_block_size = 64;
+
+    // single pass iterator over the rows of a join, advancing the iterator
+    // advances the join itself (so only one iterator may be in use at a time)
+    template<typename Join>
+    class join_iterator_t
+    {
+      Join* join_ = nullptr;
+
+    public:
+      using iterator_category = std::input_iterator_tag;
+      using value_type = typename Join::row_t;
+      using difference_type = std::ptrdiff_t;
+      using pointer = void;
+      using reference = value_type;
+
+      join_iterator_t() = default;
+      // moves to the first row of the join (or the end if there are none)
+      explicit join_iterator_t(Join* join)
+        : join_(join->next() ? join : nullptr)
+      {
+      }
+
+      reference operator*() const { return join_->row(); }
+      join_iterator_t& operator++()
+      {
+        if (!join_->next()) {
+          join_ = nullptr;
+        }
+        return *this;
+      }
+      void operator++(int) { ++*this; }
+
+      friend bool operator==(
+        const join_iterator_t& lhs, const join_iterator_t& rhs)
+      {
+        return lhs.join_ == rhs.join_;
+      }
+      friend bool operator!=(
+        const join_iterator_t& lhs, const join_iterator_t& rhs)
+      {
+        return !(lhs == rhs);
+      }
+    };
+  } // namespace detail
+
+  // view of the elements of several storages attached to the same registry
+  // that share a handle, yields (handle, element&...) tuples
+  // the smallest storage drives the join, the elements of the others are
+  // looked up a block at a time (prefetching ahead of use)
+  // note: rows are visited in the order of the driving storage
+  // note: invalidated by any operation that adds or removes elements
+  template<typename Tag, typename Index, typename Gen, typename... Ts>
+  class storage_join_t
+  {
+    static_assert(sizeof...(Ts) > 0, "At least one storage is required.");
+
+  public:
+    using row_t = std::tuple<typed_handle_t<Tag, Index, Gen>, Ts&...>;
+    using iterator = detail::join_iterator_t<storage_join_t>;
+
+  private:
+    friend iterator;
+    using positions_t = std::array<Index, sizeof...(Ts)>;
+
+    std::tuple<handle_storage_t<Ts, Tag, Index, Gen>&...> storages_;
+    // storage with the fewest elements (iterated in order)
+    std::size_t driver_ = 0;
+    // next element of the driving storage to resolve
+    Index driver_position_ = 0;
+    // handle and position in each storage of every row in the current block
+    // (only rows with an element in every storage are kept)
+    typed_handle_t<Tag, Index, Gen> handles_[detail::join_block_size];
+    positions_t positions_[detail::join_block_size];
+    int row_count_ = 0;
+    int row_ = 0;
+
+    // resets the join to the first driving element (choosing the driving
+    // storage)
+    void restart();
+    // looks up the elements of the next block of driving elements, keeping
+    // those with an element in every storage
+    // returns false if there are no driving elements left
+    template<std::size_t... Is>
+    bool resolve_block(std::index_sequence<Is...>);
+    // moves to the next row, returns false once all rows have been visited
+    bool next();
+    // returns the current row
+    [[nodiscard]] row_t row() const;
+    // returns the row at the given offset in the current block
+    template<std::size_t... Is>
+    [[nodiscard]] row_t row(int row, std::index_sequence<Is...>) const;
+
+  public:
+    explicit storage_join_t(handle_storage_t<Ts, Tag, Index, Gen>&... storages);
+
+    // returns an iterator to the first row (restarting the join)
+    [[nodiscard]] iterator begin();
+    // returns an iterator one past the last row
+    [[nodiscard]] iterator end();
+    // invokes fn(handle, element&...) for every row
+    template<typename Fn>
+    void for_each(Fn&& fn);
+  };
+
+  // view of the elements of several containers where each element of the
+  // first (driving) container refers to an element in each of the others,
+  // key_extractor(element) returns the handles of the elements it refers to
+  // (as a std::tuple, or a single handle when joining two containers)
+  // yields (handle, element&, element&...) tuples (the handle belongs to the
+  // driving element), elements of the other containers are resolved a block
+  // at a time (prefetching ahead of use) and rows with a handle that cannot
+  // be resolved are skipped
+  // note: the driving container is always the first as handles only refer
+  // one way (use storage_join_t to drive from the smallest container)
+  // note: invalidated by any operation that adds, removes or reorders
+  // elements
+  // note: changes made through a row are not recorded when tracking changes
+  // (use mark_dirty as with for_each)
+  template<typename KeyExtractor, typename Driver, typename... Others>
+  class keyed_join_t
+  {
+    static_assert(
+      sizeof...(Others) > 0, "At least two containers are required.");
+
+    template<typename Container>
+    using handle_of_t =
+      decltype(std::declval<const Container&>().handle_from_index(0));
+    template<typename Container>
+    using index_of_t = decltype(std::declval<const Container&>().size());
+
+  public:
+    using row_t = std::tuple<
+      handle_of_t<Driver>, typename Driver::value_type&,
+      typename Others::value_type&...>;
+    using iterator = detail::join_iterator_t<keyed_join_t>;
+
+  private:
+    friend iterator;
+    template<typename U>
+    using block_t = std::array<U, detail::join_block_size>;
+
+    KeyExtractor key_extractor_;
+    Driver& driver_;
+    std::tuple<Others&...> others_;
+    // next element of the driving container to resolve
+    index_of_t<Driver> driver_position_ = 0;
+    // handle of each driving element in the current block
+    block_t<handle_of_t<Driver>> driver_handles_;
+    // handles referred to by the current block in each of the other
+    // containers and the positions they resolve to (-1 if invalid)
+    std::tuple<block_t<handle_of_t<Others>>...> keys_;
+    std::tuple<block_t<index_of_t<Others>>...> indices_;
+    // first driving element in the current block, the number of rows in the
+    // block (including those that did not resolve) and the current row
+    index_of_t<Driver> block_position_ = 0;
+    int row_count_ = 0;
+    int row_ = 0;
+
+    // number of rows to look ahead when prefetching elements
+    static constexpr int row_prefetch_distance = 8;
+
+    // resets the join to the first driving element
+    void restart();
+    // returns if every key of the row in the current block resolved
+    template<std::size_t... Is>
+    [[nodiscard]] bool resolved(int row, std::index_sequence<Is...>) const;
+    // warms the cache for the elements of the row in the current block
+    template<std::size_t... Is>
+    void prefetch_row(int row, std::index_sequence<Is...>) const;
+    // looks up the elements referred to by the next block of driving
+    // elements, keeping those that resolve in every container
+    // returns false if there are no driving elements left
+    template<std::size_t... Is>
+    bool resolve_block(std::index_sequence<Is...>);
+    // moves to the next row, returns false once all rows have been visited
+    bool next();
+    // returns the current row
+    [[nodiscard]] row_t row() const;
+    // returns the row at the given offset in the current block
+    // note: the row must have resolved
+    template<std::size_t... Is>
+    [[nodiscard]] row_t row(int row, std::index_sequence<Is...>) const;
+
+  public:
+    keyed_join_t(KeyExtractor key_extractor, Driver& driver, Others&... others);
+
+    // returns an iterator to the first row (restarting the join)
+    [[nodiscard]] iterator begin();
+    // returns an iterator one past the last row
+    [[nodiscard]] iterator end();
+    // invokes fn(handle, element&, element&...) for every row
+    template<typename Fn>
+    void for_each(Fn&& fn);
+  };
+
+  // returns a view of the elements shared by every storage (see
+  // storage_join_t), e.g. for (auto [handle, a, b] : join(as, bs))
+  template<typename Tag, typename Index, typename Gen, typename... Ts>
+  [[nodiscard]] storage_join_t<Tag, Index, Gen, Ts...> join(
+    handle_storage_t<Ts, Tag, Index, Gen>&... storages);
+
+  // returns a view of the elements of driver along with the elements they
+  // refer to in others (see keyed_join_t)
+  template<
+    typename KeyExtractor, typename T, typename Tag, typename Index,
+    typename Gen, typename Allocator, typename... Others>
+  [[nodiscard]] keyed_join_t<
+    std::decay_t<KeyExtractor>, handle_vector_t<T, Tag, Index, Gen, Allocator>,
+    Others...>
+    join(
+      KeyExtractor&& key_extractor,
+      handle_vector_t<T, Tag, Index, Gen, Allocator>& driver,
+      Others&... others);
+} // namespace thh
+
+#include "join.inl"
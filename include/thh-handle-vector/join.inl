@@ -0,0 +1,355 @@
+namespace thh
+{
+  namespace detail
+  {
+    template<typename T>
+    struct is_tuple_t : std::false_type
+    {
+    };
+
+    template<typename... Ts>
+    struct is_tuple_t<std::tuple<Ts...>> : std::true_type
+    {
+    };
+
+    // wraps a single key in a tuple so one or several keys are handled alike
+    template<typename Keys>
+    auto as_key_tuple(Keys&& keys)
+    {
+      if constexpr (is_tuple_t<std::decay_t<Keys>>::value) {
+        return std::forward<Keys>(keys);
+      } else {
+        return std::make_tuple(std::forward<Keys>(keys));
+      }
+    }
+  } // namespace detail
+
+  template<typename Tag, typename Index, typename Gen, typename... Ts>
+  storage_join_t<Tag, Index, Gen, Ts...>::storage_join_t(
+    handle_storage_t<Ts, Tag, Index, Gen>&... storages)
+    : storages_(storages...)
+  {
+    [[maybe_unused]] const auto* registry = std::get<0>(storages_).registry_;
+    assert(((storages.registry_ == registry) && ...));
+  }
+
+  template<typename Tag, typename Index, typename Gen, typename... Ts>
+  template<std::size_t... Is>
+  bool storage_join_t<Tag, Index, Gen, Ts...>::resolve_block(
+    std::index_sequence<Is...>)
+  {
+    const typed_handle_t<Tag, Index, Gen>* driver_handles = nullptr;
+    Index driver_size = 0;
+    const auto select_driver = [&](const auto& storage, const std::size_t i) {
+      if (i == driver_) {
+        driver_handles = storage.element_handles_.data();
+        driver_size = storage.size();
+      }
+    };
+    (select_driver(std::get<Is>(storages_), Is), ...);
+
+    const auto count =
+      std::min(Index(detail::join_block_size), driver_size - driver_position_);
+    if (count <= 0) {
+      return false;
+    }
+
+    const auto* handles = driver_handles + driver_position_;
+    // issue the lookups for the whole block up front so the cache misses
+    // overlap instead of being taken one element at a time
+    const auto prefetch_lookups = [this, handles, count](
+                                    const auto& storage, const std::size_t i) {
+      if (i == driver_) {
+        return;
+      }
+      const auto lookup_size = static_cast<Index>(storage.lookup_.size());
+      for (Index h = 0; h < count; h++) {
+        if (handles[h].id_ < lookup_size) {
+          detail::prefetch(&storage.lookup_[handles[h].id_]);
+        }
+      }
+    };
+    (prefetch_lookups(std::get<Is>(storages_), Is), ...);
+
+    row_count_ = 0;
+    for (Index h = 0; h < count; h++) {
+      const auto handle = handles[h];
+      auto& positions = positions_[row_count_];
+      bool found = true;
+      const auto resolve = [&](const auto& storage, const std::size_t i) {
+        if (i == driver_) {
+          positions[i] = driver_position_ + h;
+          return;
+        }
+        const auto lookup =
+          handle.id_ < static_cast<Index>(storage.lookup_.size())
+            ? storage.lookup_[handle.id_]
+            : Index(-1);
+        positions[i] = lookup;
+        if (lookup == -1) {
+          found = false;
+        } else {
+          // warm the cache for the element before the row is visited
+          detail::prefetch(&storage.elements_[lookup]);
+        }
+      };
+      (resolve(std::get<Is>(storages_), Is), ...);
+      handles_[row_count_] = handle;
+      row_count_ += int(found);
+    }
+
+    driver_position_ += count;
+    row_ = 0;
+    return true;
+  }
+
+  template<typename Tag, typename Index, typename Gen, typename... Ts>
+  bool storage_join_t<Tag, Index, Gen, Ts...>::next()
+  {
+    if (++row_ < row_count_) {
+      return true;
+    }
+    while (resolve_block(std::index_sequence_for<Ts...>())) {
+      if (row_count_ > 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  template<typename Tag, typename Index, typename Gen, typename... Ts>
+  auto storage_join_t<Tag, Index, Gen, Ts...>::row() const -> row_t
+  {
+    return row(row_, std::index_sequence_for<Ts...>());
+  }
+
+  template<typename Tag, typename Index, typename Gen, typename... Ts>
+  template<std::size_t... Is>
+  auto storage_join_t<Tag, Index, Gen, Ts...>::row(
+    const int row, std::index_sequence<Is...>) const -> row_t
+  {
+    const auto& positions = positions_[row];
+    return row_t(
+      handles_[row], std::get<Is>(storages_).elements_[positions[Is]]...);
+  }
+
+  template<typename Tag, typename Index, typename Gen, typename... Ts>
+  void storage_join_t<Tag, Index, Gen, Ts...>::restart()
+  {
+    // drive the join from the storage with the fewest elements
+    std::apply(
+      [this](const auto&... storages) {
+        const Index sizes[] = {storages.size()...};
+        driver_ = std::min_element(std::begin(sizes), std::end(sizes))
+                - std::begin(sizes);
+      },
+      storages_);
+    driver_position_ = 0;
+    row_count_ = 0;
+    row_ = 0;
+  }
+
+  template<typename Tag, typename Index, typename Gen, typename... Ts>
+  auto storage_join_t<Tag, Index, Gen, Ts...>::begin() -> iterator
+  {
+    restart();
+    return iterator(this);
+  }
+
+  template<typename Tag, typename Index, typename Gen, typename... Ts>
+  auto storage_join_t<Tag, Index, Gen, Ts...>::end() -> iterator
+  {
+    return iterator();
+  }
+
+  template<typename Tag, typename Index, typename Gen, typename... Ts>
+  template<typename Fn>
+  void storage_join_t<Tag, Index, Gen, Ts...>::for_each(Fn&& fn)
+  {
+    // visit each block directly rather than through the iterator
+    restart();
+    while (resolve_block(std::index_sequence_for<Ts...>())) {
+      for (int row = 0, count = row_count_; row < count; row++) {
+        std::apply(fn, this->row(row, std::index_sequence_for<Ts...>()));
+      }
+    }
+  }
+
+  template<typename KeyExtractor, typename Driver, typename... Others>
+  keyed_join_t<KeyExtractor, Driver, Others...>::keyed_join_t(
+    KeyExtractor key_extractor, Driver& driver, Others&... others)
+    : key_extractor_(std::move(key_extractor)),
+      driver_(driver),
+      others_(others...)
+  {
+  }
+
+  template<typename KeyExtractor, typename Driver, typename... Others>
+  template<std::size_t... Is>
+  bool keyed_join_t<KeyExtractor, Driver, Others...>::resolve_block(
+    std::index_sequence<Is...>)
+  {
+    using driver_index_t = index_of_t<Driver>;
+    const auto count = std::min(
+      driver_index_t(detail::join_block_size),
+      driver_.size() - driver_position_);
+    if (count <= 0) {
+      return false;
+    }
+
+    block_position_ = driver_position_;
+    driver_position_ += count;
+
+    const auto& driver = std::as_const(driver_);
+    driver.handles_from_indices(block_position_, count, driver_handles_.data());
+    for (int i = 0; i < count; i++) {
+      // tombstones keep invalid keys so they never resolve
+      if (driver_handles_[i].id_ == -1) {
+        ((std::get<Is>(keys_)[i] = handle_of_t<Others>()), ...);
+        continue;
+      }
+      const auto keys =
+        detail::as_key_tuple(key_extractor_(driver[block_position_ + i]));
+      static_assert(
+        std::tuple_size<std::decay_t<decltype(keys)>>::value
+          == sizeof...(Others),
+        "key_extractor must return one handle per joined container.");
+      ((std::get<Is>(keys_)[i] = std::get<Is>(keys)), ...);
+    }
+
+    // resolve the keys for each container a block at a time (lookups are
+    // prefetched ahead of use)
+    (std::get<Is>(others_).indices_from_handles(
+       std::get<Is>(keys_).data(), index_of_t<Others>(count),
+       std::get<Is>(indices_).data()),
+     ...);
+
+    // warm the cache for the elements of the first rows (later rows are
+    // prefetched as earlier ones are visited)
+    row_count_ = int(count);
+    for (int i = 0; i < std::min(row_count_, row_prefetch_distance); i++) {
+      prefetch_row(i, std::index_sequence<Is...>());
+    }
+    return true;
+  }
+
+  template<typename KeyExtractor, typename Driver, typename... Others>
+  template<std::size_t... Is>
+  bool keyed_join_t<KeyExtractor, Driver, Others...>::resolved(
+    const int row, std::index_sequence<Is...>) const
+  {
+    return ((std::get<Is>(indices_)[row] != -1) && ...);
+  }
+
+  template<typename KeyExtractor, typename Driver, typename... Others>
+  template<std::size_t... Is>
+  void keyed_join_t<KeyExtractor, Driver, Others...>::prefetch_row(
+    const int row, std::index_sequence<Is...> sequence) const
+  {
+    if (resolved(row, sequence)) {
+      (detail::prefetch(
+         std::get<Is>(others_).data() + std::get<Is>(indices_)[row]),
+       ...);
+    }
+  }
+
+  template<typename KeyExtractor, typename Driver, typename... Others>
+  bool keyed_join_t<KeyExtractor, Driver, Others...>::next()
+  {
+    const auto sequence = std::index_sequence_for<Others...>();
+    for (;;) {
+      while (++row_ < row_count_) {
+        if (row_ + row_prefetch_distance < row_count_) {
+          prefetch_row(row_ + row_prefetch_distance, sequence);
+        }
+        if (resolved(row_, sequence)) {
+          return true;
+        }
+      }
+      if (!resolve_block(sequence)) {
+        return false;
+      }
+      row_ = -1;
+    }
+  }
+
+  template<typename KeyExtractor, typename Driver, typename... Others>
+  auto keyed_join_t<KeyExtractor, Driver, Others...>::row() const -> row_t
+  {
+    return row(row_, std::index_sequence_for<Others...>());
+  }
+
+  template<typename KeyExtractor, typename Driver, typename... Others>
+  template<std::size_t... Is>
+  auto keyed_join_t<KeyExtractor, Driver, Others...>::row(
+    const int row, std::index_sequence<Is...>) const -> row_t
+  {
+    return row_t(
+      driver_handles_[row], driver_.data()[block_position_ + row],
+      std::get<Is>(others_).data()[std::get<Is>(indices_)[row]]...);
+  }
+
+  template<typename KeyExtractor, typename Driver, typename... Others>
+  void keyed_join_t<KeyExtractor, Driver, Others...>::restart()
+  {
+    driver_position_ = 0;
+    row_count_ = 0;
+    row_ = 0;
+  }
+
+  template<typename KeyExtractor, typename Driver, typename... Others>
+  auto keyed_join_t<KeyExtractor, Driver, Others...>::begin() -> iterator
+  {
+    restart();
+    return iterator(this);
+  }
+
+  template<typename KeyExtractor, typename Driver, typename... Others>
+  auto keyed_join_t<KeyExtractor, Driver, Others...>::end() -> iterator
+  {
+    return iterator();
+  }
+
+  template<typename KeyExtractor, typename Driver, typename... Others>
+  template<typename Fn>
+  void keyed_join_t<KeyExtractor, Driver, Others...>::for_each(Fn&& fn)
+  {
+    // visit each block directly rather than through the iterator
+    restart();
+    const auto sequence = std::index_sequence_for<Others...>();
+    while (resolve_block(sequence)) {
+      for (int row = 0, count = row_count_; row < count; row++) {
+        if (row + row_prefetch_distance < count) {
+          prefetch_row(row + row_prefetch_distance, sequence);
+        }
+        if (resolved(row, sequence)) {
+          std::apply(fn, this->row(row, sequence));
+        }
+      }
+    }
+  }
+
+  template<typename Tag, typename Index, typename Gen, typename... Ts>
+  storage_join_t<Tag, Index, Gen, Ts...> join(
+    handle_storage_t<Ts, Tag, Index, Gen>&... storages)
+  {
+    return storage_join_t<Tag, Index, Gen, Ts...>(storages...);
+  }
+
+  template<
+    typename KeyExtractor, typename T, typename Tag, typename Index,
+    typename Gen, typename Allocator, typename... Others>
+  keyed_join_t<
+    std::decay_t<KeyExtractor>, handle_vector_t<T, Tag, Index, Gen, Allocator>,
+    Others...>
+    join(
+      KeyExtractor&& key_extractor,
+      handle_vector_t<T, Tag, Index, Gen, Allocator>& driver,
+      Others&... others)
+  {
+    return keyed_join_t<
+      std::decay_t<KeyExtractor>,
+      handle_vector_t<T, Tag, Index, Gen, Allocator>, Others...>(
+      std::forward<KeyExtractor>(key_extractor), driver, others...);
+  }
+} // namespace thh
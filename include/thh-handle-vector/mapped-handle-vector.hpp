@@ -0,0 +1,204 @@
+#pragma once
+
+#include "handle-vector.hpp"
+
+#if __has_include(<sys/mman.h>)
+
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace thh
+{
+  namespace detail
+  {
+    // read/write shared mapping of a file that can be resized
+    class mapped_file_t
+    {
+      int fd_ = -1;
+      void* data_ = nullptr;
+      size_t size_ = 0;
+
+      mapped_file_t(int fd, void* data, size_t size);
+      // unmaps and closes the file (if open)
+      void reset();
+
+    public:
+      // opens (or creates) the file and maps it, the file is grown to
+      // min_size bytes if it is smaller
+      // returns an empty optional if the file could not be opened or mapped
+      [[nodiscard]] static std::optional<mapped_file_t> open(
+        const std::string& path, size_t min_size);
+
+      mapped_file_t(mapped_file_t&& other) noexcept;
+      mapped_file_t& operator=(mapped_file_t&& other) noexcept;
+      mapped_file_t(const mapped_file_t&) = delete;
+      mapped_file_t& operator=(const mapped_file_t&) = delete;
+      ~mapped_file_t();
+
+      // resizes the file (ftruncate) and the mapping (mremap where available)
+      // note: data may move, existing pointers are invalidated
+      [[nodiscard]] bool resize(size_t size);
+      // flushes changes to the file
+      bool sync();
+      [[nodiscard]] void* data() const;
+      [[nodiscard]] size_t size() const;
+    };
+  } // namespace detail
+
+  // storage for trivially copyable type T where elements, element ids and
+  // handles live in memory-mapped files, the container can be reopened later
+  // and existing handles used immediately (nothing is read up front)
+  // note: files are created at path with the suffixes .elements, .ids and
+  // .handles (container state is stored at the start of .handles)
+  // note: only available on platforms providing <sys/mman.h>
+  template<
+    typename T, typename Tag = default_tag_t, typename Index = int32_t,
+    typename Gen = int32_t>
+  class mapped_handle_vector_t
+  {
+    static_assert(
+      std::is_trivially_copyable_v<T>, "T must be trivially copyable.");
+
+    // internal mapping from external handle to internal element
+    // maintains a reference to the next free handle
+    struct internal_handle_t
+    {
+      Gen gen_; // generation of handle to be looked up
+      Index lookup_; // mapping to element
+      Index next_; // index of next available handle (-1 for none)
+    };
+
+    // container state stored at the start of the handles file
+    struct alignas(64) header_t
+    {
+      char magic_[4];
+      uint32_t version_;
+      uint32_t index_size_;
+      uint32_t gen_size_;
+      uint32_t element_size_;
+      Index size_;
+      Index capacity_;
+      // front and back of the free list of handles (-1 when empty)
+      Index dequeue_;
+      Index enqueue_;
+    };
+
+    detail::mapped_file_t handles_file_;
+    detail::mapped_file_t ids_file_;
+    detail::mapped_file_t elements_file_;
+
+    mapped_handle_vector_t(
+      detail::mapped_file_t handles_file, detail::mapped_file_t ids_file,
+      detail::mapped_file_t elements_file);
+
+    [[nodiscard]] header_t& header();
+    [[nodiscard]] const header_t& header() const;
+    [[nodiscard]] internal_handle_t* handles();
+    [[nodiscard]] const internal_handle_t* handles() const;
+    [[nodiscard]] Index* ids();
+    [[nodiscard]] const Index* ids() const;
+    // grows all three files and appends the new handles to the free list
+    [[nodiscard]] bool grow(Index capacity);
+    // returns a handle to the back of the free list so it may be reused
+    void free_handle(Index id);
+    [[nodiscard]] T* resolve(typed_handle_t<Tag, Index, Gen> handle);
+    [[nodiscard]] const T* resolve(
+      typed_handle_t<Tag, Index, Gen> handle) const;
+
+  public:
+    using iterator = T*;
+    using const_iterator = const T*;
+    using value_type = T;
+    using reference = T&;
+    using const_reference = const T&;
+
+    // opens the container stored at path (or creates a new empty one)
+    // returns an empty optional if the files could not be mapped or were
+    // written by an incompatible container
+    [[nodiscard]] static std::optional<mapped_handle_vector_t> open(
+      const std::string& path);
+
+    // creates an element T in-place and returns a handle to it
+    // note: returns an invalid handle if the files could not be grown
+    template<typename... Args>
+    [[nodiscard]] typed_handle_t<Tag, Index, Gen> add(Args&&... args);
+    // invokes a callable object (usually a lambda) on a particular element in
+    // the container
+    template<typename Fn>
+    void call(typed_handle_t<Tag, Index, Gen> handle, Fn&& fn);
+    // invokes a callable object (usually a lambda) on a particular element in
+    // the container (const overload)
+    template<typename Fn>
+    void call(typed_handle_t<Tag, Index, Gen> handle, Fn&& fn) const;
+    // invokes a callable object (usually a lambda) on a particular element in
+    // the container and returns a std::optional containing either the result
+    // or an empty optional (as the handle may not have been successfully
+    // resolved)
+    template<typename Fn>
+    [[nodiscard]] decltype(auto) call_return(
+      typed_handle_t<Tag, Index, Gen> handle, Fn&& fn);
+    // invokes a callable object (usually a lambda) on a particular element in
+    // the container and returns a std::optional containing either the result
+    // or an empty optional (const overload)
+    template<typename Fn>
+    [[nodiscard]] decltype(auto) call_return(
+      typed_handle_t<Tag, Index, Gen> handle, Fn&& fn) const;
+    // removes the element referenced by the handle
+    // returns true if the element was removed, false otherwise (the handle was
+    // invalid or could not be found in the container)
+    bool remove(typed_handle_t<Tag, Index, Gen> handle);
+    // returns if the container still has the element referenced by the handle
+    [[nodiscard]] bool has(typed_handle_t<Tag, Index, Gen> handle) const;
+    // returns the number of elements currently stored in the container
+    [[nodiscard]] Index size() const;
+    // returns the number of handles (and elements) the files have space for
+    [[nodiscard]] Index capacity() const;
+    // grows the files to hold the number of elements specified
+    // returns false if the files could not be grown
+    bool reserve(Index capacity);
+    // removes all elements and invalidates all handles
+    // note: file sizes remain unchanged
+    void clear();
+    // flushes all changes to the underlying files
+    bool sync();
+    // returns the handle for a value at the given index
+    // note: will return an invalid handle if the index is out of range
+    [[nodiscard]] typed_handle_t<Tag, Index, Gen> handle_from_index(
+      Index index) const;
+    // returns the index (position) of a value for a given handle
+    // note: will return an empty optional if the handle is invalid
+    [[nodiscard]] std::optional<Index> index_from_handle(
+      typed_handle_t<Tag, Index, Gen> handle) const;
+    // returns if the container has any elements or not
+    [[nodiscard]] bool empty() const;
+    // returns mutable reference to element at position
+    // note: position must be in range (0 <= position < size)
+    T& operator[](Index position);
+    // returns constant reference to element at position
+    // note: position must be in range (0 <= position < size)
+    const T& operator[](Index position) const;
+    // returns a pointer to the underlying element storage
+    T* data();
+    // returns a const pointer to the underlying element storage
+    const T* data() const;
+    // returns an iterator to the beginning of the elements
+    auto begin() -> iterator;
+    // returns a const iterator to the beginning of the elements
+    auto begin() const -> const_iterator;
+    // returns an iterator to the end of the elements
+    auto end() -> iterator;
+    // returns a const iterator to the end of the elements
+    auto end() const -> const_iterator;
+  };
+} // namespace thh
+
+#include "mapped-handle-vector.inl"
+
+#endif
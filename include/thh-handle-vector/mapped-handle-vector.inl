@@ -0,0 +1,544 @@
+namespace thh
+{
+  namespace detail
+  {
+    inline mapped_file_t::mapped_file_t(
+      const int fd, void* data, const size_t size)
+      : fd_(fd), data_(data), size_(size)
+    {
+    }
+
+    inline std::optional<mapped_file_t> mapped_file_t::open(
+      const std::string& path, const size_t min_size)
+    {
+      const int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+      if (fd == -1) {
+        return std::nullopt;
+      }
+
+      struct stat file_stat;
+      if (::fstat(fd, &file_stat) == -1) {
+        ::close(fd);
+        return std::nullopt;
+      }
+
+      mapped_file_t file(fd, nullptr, 0);
+      const auto size =
+        std::max(static_cast<size_t>(file_stat.st_size), min_size);
+      if (size > 0 && !file.resize(size)) {
+        return std::nullopt;
+      }
+
+      return file;
+    }
+
+    inline mapped_file_t::mapped_file_t(mapped_file_t&& other) noexcept
+      : fd_(std::exchange(other.fd_, -1)),
+        data_(std::exchange(other.data_, nullptr)),
+        size_(std::exchange(other.size_, 0))
+    {
+    }
+
+    inline mapped_file_t& mapped_file_t::operator=(
+      mapped_file_t&& other) noexcept
+    {
+      if (this != &other) {
+        reset();
+        fd_ = std::exchange(other.fd_, -1);
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+      }
+      return *this;
+    }
+
+    inline mapped_file_t::~mapped_file_t()
+    {
+      reset();
+    }
+
+    inline void mapped_file_t::reset()
+    {
+      if (data_ != nullptr) {
+        ::munmap(data_, size_);
+        data_ = nullptr;
+        size_ = 0;
+      }
+      if (fd_ != -1) {
+        ::close(fd_);
+        fd_ = -1;
+      }
+    }
+
+    inline bool mapped_file_t::resize(const size_t size)
+    {
+      struct stat file_stat;
+      if (::fstat(fd_, &file_stat) == -1) {
+        return false;
+      }
+      // only ever grow the file (an existing file may be larger than the
+      // mapping when it is first opened)
+      if (
+        static_cast<size_t>(file_stat.st_size) < size
+        && ::ftruncate(fd_, static_cast<off_t>(size)) == -1) {
+        return false;
+      }
+
+      void* data = MAP_FAILED;
+      if (data_ == nullptr) {
+        data =
+          ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+      } else {
+#if defined(__linux__)
+        // extend the mapping in place if possible without copying any data
+        data = ::mremap(data_, size_, size, MREMAP_MAYMOVE);
+#else
+        data =
+          ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (data != MAP_FAILED) {
+          ::munmap(data_, size_);
+        }
+#endif
+      }
+      if (data == MAP_FAILED) {
+        return false;
+      }
+
+      data_ = data;
+      size_ = size;
+      return true;
+    }
+
+    inline bool mapped_file_t::sync()
+    {
+      return data_ == nullptr || ::msync(data_, size_, MS_SYNC) == 0;
+    }
+
+    inline void* mapped_file_t::data() const
+    {
+      return data_;
+    }
+
+    inline size_t mapped_file_t::size() const
+    {
+      return size_;
+    }
+  } // namespace detail
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  mapped_handle_vector_t<T, Tag, Index, Gen>::mapped_handle_vector_t(
+    detail::mapped_file_t handles_file, detail::mapped_file_t ids_file,
+    detail::mapped_file_t elements_file)
+    : handles_file_(std::move(handles_file)), ids_file_(std::move(ids_file)),
+      elements_file_(std::move(elements_file))
+  {
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  auto mapped_handle_vector_t<T, Tag, Index, Gen>::header() -> header_t&
+  {
+    return *static_cast<header_t*>(handles_file_.data());
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  auto mapped_handle_vector_t<T, Tag, Index, Gen>::header() const
+    -> const header_t&
+  {
+    return *static_cast<const header_t*>(handles_file_.data());
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  auto mapped_handle_vector_t<T, Tag, Index, Gen>::handles()
+    -> internal_handle_t*
+  {
+    return reinterpret_cast<internal_handle_t*>(&header() + 1);
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  auto mapped_handle_vector_t<T, Tag, Index, Gen>::handles() const
+    -> const internal_handle_t*
+  {
+    return reinterpret_cast<const internal_handle_t*>(&header() + 1);
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  Index* mapped_handle_vector_t<T, Tag, Index, Gen>::ids()
+  {
+    return static_cast<Index*>(ids_file_.data());
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  const Index* mapped_handle_vector_t<T, Tag, Index, Gen>::ids() const
+  {
+    return static_cast<const Index*>(ids_file_.data());
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  std::optional<mapped_handle_vector_t<T, Tag, Index, Gen>>
+  mapped_handle_vector_t<T, Tag, Index, Gen>::open(const std::string& path)
+  {
+    constexpr char magic[4] = {'T', 'H', 'H', 'M'};
+    constexpr uint32_t version = 1;
+
+    auto handles_file =
+      detail::mapped_file_t::open(path + ".handles", sizeof(header_t));
+    if (!handles_file) {
+      return std::nullopt;
+    }
+
+    auto& header = *static_cast<header_t*>(handles_file->data());
+    if (std::all_of(
+          std::begin(header.magic_), std::end(header.magic_),
+          [](const char c) { return c == 0; })) {
+      // newly created file
+      std::copy(std::begin(magic), std::end(magic), header.magic_);
+      header.version_ = version;
+      header.index_size_ = sizeof(Index);
+      header.gen_size_ = sizeof(Gen);
+      header.element_size_ = sizeof(T);
+      header.size_ = 0;
+      header.capacity_ = 0;
+      header.dequeue_ = -1;
+      header.enqueue_ = -1;
+    } else if (
+      !std::equal(std::begin(magic), std::end(magic), header.magic_)
+      || header.version_ != version || header.index_size_ != sizeof(Index)
+      || header.gen_size_ != sizeof(Gen) || header.element_size_ != sizeof(T)) {
+      return std::nullopt;
+    }
+
+    // reject a torn or corrupted header (the size and both ends of the free
+    // list must lie within the capacity, the free list is either empty or
+    // has both ends)
+    const auto in_range = [&header](const Index id) {
+      return id >= -1 && id < header.capacity_;
+    };
+    if (
+      header.capacity_ < 0 || header.size_ < 0
+      || header.size_ > header.capacity_ || !in_range(header.dequeue_)
+      || !in_range(header.enqueue_)
+      || (header.dequeue_ == -1) != (header.enqueue_ == -1)) {
+      return std::nullopt;
+    }
+
+    // existing files must be large enough for the stored capacity
+    const auto capacity = static_cast<size_t>(header.capacity_);
+    auto ids_file = detail::mapped_file_t::open(path + ".ids", 0);
+    auto elements_file = detail::mapped_file_t::open(path + ".elements", 0);
+    if (
+      !ids_file || !elements_file
+      || handles_file->size()
+           < sizeof(header_t) + capacity * sizeof(internal_handle_t)
+      || ids_file->size() < capacity * sizeof(Index)
+      || elements_file->size() < capacity * sizeof(T)) {
+      return std::nullopt;
+    }
+
+    // the ends of the free list must be free handles (the rest of the
+    // handles are not read up front)
+    const auto* handles =
+      reinterpret_cast<const internal_handle_t*>(&header + 1);
+    if (
+      header.dequeue_ != -1
+      && (handles[header.dequeue_].lookup_ != -1
+          || handles[header.enqueue_].lookup_ != -1
+          || handles[header.enqueue_].next_ != -1)) {
+      return std::nullopt;
+    }
+
+    return mapped_handle_vector_t(
+      std::move(*handles_file), std::move(*ids_file),
+      std::move(*elements_file));
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  bool mapped_handle_vector_t<T, Tag, Index, Gen>::grow(const Index capacity)
+  {
+    const auto last_capacity = header().capacity_;
+    assert(capacity > last_capacity);
+
+    const auto count = static_cast<size_t>(capacity);
+    if (
+      !handles_file_.resize(
+        sizeof(header_t) + count * sizeof(internal_handle_t))
+      || !ids_file_.resize(count * sizeof(Index))
+      || !elements_file_.resize(count * sizeof(T))) {
+      return false;
+    }
+
+    for (Index id = last_capacity; id < capacity; id++) {
+      handles()[id] = {Gen(-1), Index(-1), static_cast<Index>(id + 1)};
+    }
+    handles()[capacity - 1].next_ = -1;
+
+    // append new handles to the back of the free list
+    auto& state = header();
+    if (state.enqueue_ == -1) {
+      state.dequeue_ = last_capacity;
+    } else {
+      handles()[state.enqueue_].next_ = last_capacity;
+    }
+    state.enqueue_ = capacity - 1;
+    state.capacity_ = capacity;
+
+    return true;
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  void mapped_handle_vector_t<T, Tag, Index, Gen>::free_handle(const Index id)
+  {
+    auto& handle = handles()[id];
+    handle.lookup_ = -1;
+    // retire the handle if its generation has reached its limit
+    if (handle.gen_ == std::numeric_limits<Gen>::max()) {
+      return;
+    }
+    handle.next_ = -1;
+    auto& state = header();
+    if (state.enqueue_ == -1) {
+      state.dequeue_ = id;
+    } else {
+      handles()[state.enqueue_].next_ = id;
+    }
+    state.enqueue_ = id;
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  template<typename... Args>
+  typed_handle_t<Tag, Index, Gen> mapped_handle_vector_t<
+    T, Tag, Index, Gen>::add(Args&&... args)
+  {
+    if (header().dequeue_ == -1) {
+      const auto capacity = header().capacity_;
+      assert(capacity <= std::numeric_limits<Index>::max() / 2);
+      if (!grow(std::max(capacity * 2, Index(64)))) {
+        return {};
+      }
+    }
+
+    auto& state = header();
+    const auto id = state.dequeue_;
+    auto& handle = handles()[id];
+    state.dequeue_ = handle.next_;
+    if (state.dequeue_ == -1) {
+      state.enqueue_ = -1;
+    }
+
+    const auto lookup = state.size_++;
+    ::new (static_cast<void*>(data() + lookup)) T(std::forward<Args>(args)...);
+    ids()[lookup] = id;
+    handle.gen_++;
+    handle.lookup_ = lookup;
+
+    return {id, handle.gen_};
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  T* mapped_handle_vector_t<T, Tag, Index, Gen>::resolve(
+    const typed_handle_t<Tag, Index, Gen> handle)
+  {
+    if (!has(handle)) {
+      return nullptr;
+    }
+    return data() + handles()[handle.id_].lookup_;
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  const T* mapped_handle_vector_t<T, Tag, Index, Gen>::resolve(
+    const typed_handle_t<Tag, Index, Gen> handle) const
+  {
+    if (!has(handle)) {
+      return nullptr;
+    }
+    return data() + handles()[handle.id_].lookup_;
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  template<typename Fn>
+  void mapped_handle_vector_t<T, Tag, Index, Gen>::call(
+    const typed_handle_t<Tag, Index, Gen> handle, Fn&& fn)
+  {
+    if (T* element = resolve(handle)) {
+      fn(*element);
+    }
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  template<typename Fn>
+  void mapped_handle_vector_t<T, Tag, Index, Gen>::call(
+    const typed_handle_t<Tag, Index, Gen> handle, Fn&& fn) const
+  {
+    if (const T* element = resolve(handle)) {
+      fn(*element);
+    }
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  template<typename Fn>
+  decltype(auto) mapped_handle_vector_t<T, Tag, Index, Gen>::call_return(
+    const typed_handle_t<Tag, Index, Gen> handle, Fn&& fn)
+  {
+    if (T* element = resolve(handle)) {
+      return std::optional(fn(*element));
+    }
+    return std::optional<decltype(fn(*(static_cast<T*>(nullptr))))>{};
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  template<typename Fn>
+  decltype(auto) mapped_handle_vector_t<T, Tag, Index, Gen>::call_return(
+    const typed_handle_t<Tag, Index, Gen> handle, Fn&& fn) const
+  {
+    if (const T* element = resolve(handle)) {
+      return std::optional(fn(*element));
+    }
+    return std::optional<decltype(fn(*(static_cast<const T*>(nullptr))))>{};
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  bool mapped_handle_vector_t<T, Tag, Index, Gen>::remove(
+    const typed_handle_t<Tag, Index, Gen> handle)
+  {
+    if (!has(handle)) {
+      return false;
+    }
+
+    // move the last element into the position of the element being removed
+    const auto lookup = handles()[handle.id_].lookup_;
+    const auto last = --header().size_;
+    data()[lookup] = data()[last];
+    ids()[lookup] = ids()[last];
+    handles()[ids()[lookup]].lookup_ = lookup;
+
+    free_handle(handle.id_);
+
+    return true;
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  bool mapped_handle_vector_t<T, Tag, Index, Gen>::has(
+    const typed_handle_t<Tag, Index, Gen> handle) const
+  {
+    if (handle.id_ < 0 || handle.id_ >= header().capacity_) {
+      return false;
+    }
+    const auto& ih = handles()[handle.id_];
+    return ih.gen_ == handle.gen_ && ih.lookup_ != -1;
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  Index mapped_handle_vector_t<T, Tag, Index, Gen>::size() const
+  {
+    return header().size_;
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  Index mapped_handle_vector_t<T, Tag, Index, Gen>::capacity() const
+  {
+    return header().capacity_;
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  bool mapped_handle_vector_t<T, Tag, Index, Gen>::reserve(
+    const Index capacity)
+  {
+    return capacity <= this->capacity() || grow(capacity);
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  void mapped_handle_vector_t<T, Tag, Index, Gen>::clear()
+  {
+    // free handles in the order they are stored (generations are kept so
+    // existing handles cannot be used again)
+    for (Index lookup = 0; lookup < size(); lookup++) {
+      free_handle(ids()[lookup]);
+    }
+    header().size_ = 0;
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  bool mapped_handle_vector_t<T, Tag, Index, Gen>::sync()
+  {
+    return handles_file_.sync() && ids_file_.sync() && elements_file_.sync();
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  typed_handle_t<Tag, Index, Gen> mapped_handle_vector_t<
+    T, Tag, Index, Gen>::handle_from_index(const Index index) const
+  {
+    if (index < 0 || index >= size()) {
+      return typed_handle_t<Tag, Index, Gen>{};
+    }
+    const auto id = ids()[index];
+    return {id, handles()[id].gen_};
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  std::optional<Index> mapped_handle_vector_t<T, Tag, Index, Gen>::
+    index_from_handle(const typed_handle_t<Tag, Index, Gen> handle) const
+  {
+    if (!has(handle)) {
+      return std::nullopt;
+    }
+    return handles()[handle.id_].lookup_;
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  bool mapped_handle_vector_t<T, Tag, Index, Gen>::empty() const
+  {
+    return size() == 0;
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  T& mapped_handle_vector_t<T, Tag, Index, Gen>::operator[](
+    const Index position)
+  {
+    assert(position >= 0 && position < size());
+    return data()[position];
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  const T& mapped_handle_vector_t<T, Tag, Index, Gen>::operator[](
+    const Index position) const
+  {
+    assert(position >= 0 && position < size());
+    return data()[position];
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  T* mapped_handle_vector_t<T, Tag, Index, Gen>::data()
+  {
+    return static_cast<T*>(elements_file_.data());
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  const T* mapped_handle_vector_t<T, Tag, Index, Gen>::data() const
+  {
+    return static_cast<const T*>(elements_file_.data());
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  auto mapped_handle_vector_t<T, Tag, Index, Gen>::begin() -> iterator
+  {
+    return data();
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  auto mapped_handle_vector_t<T, Tag, Index, Gen>::begin() const
+    -> const_iterator
+  {
+    return data();
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  auto mapped_handle_vector_t<T, Tag, Index, Gen>::end() -> iterator
+  {
+    return data() + size();
+  }
+
+  template<typename T, typename Tag, typename Index, typename Gen>
+  auto mapped_handle_vector_t<T, Tag, Index, Gen>::end() const
+    -> const_iterator
+  {
+    return data() + size();
+  }
+} // namespace thh
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "handle-vector.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace thh
+{
+  namespace detail
+  {
+    // signed type used to hold an index or generation stored in Bits bits
+    template<std::size_t Bits>
+    using packed_field_t = std::conditional_t<(Bits < 32), int32_t, int64_t>;
+
+    // tag of containers whose handles may be stored as packed_handle_t
+    template<typename Tag, std::size_t Bits, std::size_t IndexBits>
+    struct packed_tag_t
+    {
+    };
+
+    // limits the index and generation to the bits available in a packed
+    // handle (the all ones pattern of each field is reserved for -1)
+    template<
+      typename Tag, std::size_t Bits, std::size_t IndexBits, typename Index,
+      typename Gen>
+    struct handle_limits_t<packed_tag_t<Tag, Bits, IndexBits>, Index, Gen>
+    {
+      static constexpr Index max_index =
+        static_cast<Index>((uint64_t(1) << IndexBits) - 1);
+      static constexpr Gen max_gen =
+        static_cast<Gen>((uint64_t(1) << (Bits - IndexBits)) - 2);
+    };
+  } // namespace detail
+
+  // weak handle storing both its index and generation in a single Bits wide
+  // (32 or 64) unsigned integer, the low IndexBits hold the index and the
+  // remaining bits the generation (e.g. 20/12 or 40/24)
+  // note: converts implicitly to and from the handles used by
+  // packed_handle_vector_t so it can be passed directly to the container
+  template<typename Tag, std::size_t Bits, std::size_t IndexBits>
+  class packed_handle_t
+  {
+    static_assert(Bits == 32 || Bits == 64, "Bits must be 32 or 64.");
+    static_assert(
+      IndexBits > 0 && IndexBits < Bits,
+      "IndexBits must leave at least one bit for the generation.");
+
+  public:
+    using value_type = std::conditional_t<Bits == 32, uint32_t, uint64_t>;
+    using index_type = detail::packed_field_t<IndexBits>;
+    using gen_type = detail::packed_field_t<Bits - IndexBits>;
+    using typed_handle_type = typed_handle_t<
+      detail::packed_tag_t<Tag, Bits, IndexBits>, index_type, gen_type>;
+
+  private:
+    static constexpr value_type index_mask =
+      (value_type(1) << IndexBits) - 1;
+    static constexpr value_type gen_mask =
+      (value_type(1) << (Bits - IndexBits)) - 1;
+
+    // all bits set for an invalid handle
+    value_type value_ = ~value_type(0);
+
+  public:
+    packed_handle_t() = default;
+    packed_handle_t(index_type id, gen_type gen);
+    packed_handle_t(typed_handle_type handle);
+
+    operator typed_handle_type() const;
+
+    // returns the index of the handle (-1 if invalid)
+    [[nodiscard]] index_type id() const;
+    // returns the generation of the handle (-1 if invalid)
+    [[nodiscard]] gen_type gen() const;
+    // returns the packed index and generation
+    [[nodiscard]] value_type value() const;
+  };
+
+  // packed handle comparison operators (compare the whole value at once)
+  template<typename Tag, std::size_t Bits, std::size_t IndexBits>
+  bool operator==(
+    const packed_handle_t<Tag, Bits, IndexBits>& lhs,
+    const packed_handle_t<Tag, Bits, IndexBits>& rhs);
+  template<typename Tag, std::size_t Bits, std::size_t IndexBits>
+  bool operator!=(
+    const packed_handle_t<Tag, Bits, IndexBits>& lhs,
+    const packed_handle_t<Tag, Bits, IndexBits>& rhs);
+  template<typename Tag, std::size_t Bits, std::size_t IndexBits>
+  bool operator<(
+    const packed_handle_t<Tag, Bits, IndexBits>& lhs,
+    const packed_handle_t<Tag, Bits, IndexBits>& rhs);
+  template<typename Tag, std::size_t Bits, std::size_t IndexBits>
+  bool operator<=(
+    const packed_handle_t<Tag, Bits, IndexBits>& lhs,
+    const packed_handle_t<Tag, Bits, IndexBits>& rhs);
+  template<typename Tag, std::size_t Bits, std::size_t IndexBits>
+  bool operator>(
+    const packed_handle_t<Tag, Bits, IndexBits>& lhs,
+    const packed_handle_t<Tag, Bits, IndexBits>& rhs);
+  template<typename Tag, std::size_t Bits, std::size_t IndexBits>
+  bool operator>=(
+    const packed_handle_t<Tag, Bits, IndexBits>& lhs,
+    const packed_handle_t<Tag, Bits, IndexBits>& rhs);
+
+  // handle_vector_t limited to the number of elements and generations that
+  // fit in packed_handle_t<Tag, Bits, IndexBits>, handles returned by add
+  // should be stored as packed_handle_t
+  // note: handles are retired once their generation reaches the largest
+  // value the generation bits can hold (as with the full width handles)
+  template<
+    typename T, typename Tag, std::size_t Bits, std::size_t IndexBits,
+    typename Allocator = std::allocator<T>>
+  using packed_handle_vector_t = handle_vector_t<
+    T, detail::packed_tag_t<Tag, Bits, IndexBits>,
+    typename packed_handle_t<Tag, Bits, IndexBits>::index_type,
+    typename packed_handle_t<Tag, Bits, IndexBits>::gen_type, Allocator>;
+} // namespace thh
+
+#include "packed-handle.inl"
@@ -0,0 +1,94 @@
+namespace thh
+{
+  template<typename Tag, std::size_t Bits, std::size_t IndexBits>
+  packed_handle_t<Tag, Bits, IndexBits>::packed_handle_t(
+    const index_type id, const gen_type gen)
+    : value_(
+      (static_cast<value_type>(id) & index_mask)
+      | ((static_cast<value_type>(gen) & gen_mask) << IndexBits))
+  {
+    assert(id >= -1 && static_cast<value_type>(id + 1) <= index_mask);
+    assert(gen >= -1 && static_cast<value_type>(gen + 1) <= gen_mask);
+  }
+
+  template<typename Tag, std::size_t Bits, std::size_t IndexBits>
+  packed_handle_t<Tag, Bits, IndexBits>::packed_handle_t(
+    const typed_handle_type handle)
+    : packed_handle_t(handle.id_, handle.gen_)
+  {
+  }
+
+  template<typename Tag, std::size_t Bits, std::size_t IndexBits>
+  packed_handle_t<Tag, Bits, IndexBits>::operator typed_handle_type() const
+  {
+    return {id(), gen()};
+  }
+
+  template<typename Tag, std::size_t Bits, std::size_t IndexBits>
+  auto packed_handle_t<Tag, Bits, IndexBits>::id() const -> index_type
+  {
+    const auto id = value_ & index_mask;
+    return id == index_mask ? index_type(-1) : static_cast<index_type>(id);
+  }
+
+  template<typename Tag, std::size_t Bits, std::size_t IndexBits>
+  auto packed_handle_t<Tag, Bits, IndexBits>::gen() const -> gen_type
+  {
+    const auto gen = (value_ >> IndexBits) & gen_mask;
+    return gen == gen_mask ? gen_type(-1) : static_cast<gen_type>(gen);
+  }
+
+  template<typename Tag, std::size_t Bits, std::size_t IndexBits>
+  auto packed_handle_t<Tag, Bits, IndexBits>::value() const -> value_type
+  {
+    return value_;
+  }
+
+  template<typename Tag, std::size_t Bits, std::size_t IndexBits>
+  bool operator==(
+    const packed_handle_t<Tag, Bits, IndexBits>& lhs,
+    const packed_handle_t<Tag, Bits, IndexBits>& rhs)
+  {
+    return lhs.value() == rhs.value();
+  }
+
+  template<typename Tag, std::size_t Bits, std::size_t IndexBits>
+  bool operator!=(
+    const packed_handle_t<Tag, Bits, IndexBits>& lhs,
+    const packed_handle_t<Tag, Bits, IndexBits>& rhs)
+  {
+    return !(lhs == rhs);
+  }
+
+  template<typename Tag, std::size_t Bits, std::size_t IndexBits>
+  bool operator<(
+    const packed_handle_t<Tag, Bits, IndexBits>& lhs,
+    const packed_handle_t<Tag, Bits, IndexBits>& rhs)
+  {
+    return lhs.value() < rhs.value();
+  }
+
+  template<typename Tag, std::size_t Bits, std::size_t IndexBits>
+  bool operator<=(
+    const packed_handle_t<Tag, Bits, IndexBits>& lhs,
+    const packed_handle_t<Tag, Bits, IndexBits>& rhs)
+  {
+    return !(rhs < lhs);
+  }
+
+  template<typename Tag, std::size_t Bits, std::size_t IndexBits>
+  bool operator>(
+    const packed_handle_t<Tag, Bits, IndexBits>& lhs,
+    const packed_handle_t<Tag, Bits, IndexBits>& rhs)
+  {
+    return rhs < lhs;
+  }
+
+  template<typename Tag, std::size_t Bits, std::size_t IndexBits>
+  bool operator>=(
+    const packed_handle_t<Tag, Bits, IndexBits>& lhs,
+    const packed_handle_t<Tag, Bits, IndexBits>& rhs)
+  {
+    return !(lhs < rhs);
+  }
+} // namespace thh
@@ -0,0 +1,218 @@
+#pragma once
+
+#include "handle-vector.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+namespace thh
+{
+  namespace detail
+  {
+    // smallest signed index type able to address capacity elements
+    template<std::size_t Capacity>
+    using static_index_t = std::conditional_t<
+      (Capacity <= std::numeric_limits<int8_t>::max()), int8_t,
+      std::conditional_t<
+        (Capacity <= std::numeric_limits<int16_t>::max()), int16_t,
+        int32_t>>;
+
+    // generation type paired with the index type so small containers produce
+    // handles that fit in 32 bits
+    template<typename Index>
+    using static_gen_t =
+      std::conditional_t<(sizeof(Index) <= sizeof(int16_t)), int16_t, int32_t>;
+  } // namespace detail
+
+  // forward declare static_handle_vector_t
+  template<typename T, std::size_t N, typename Tag>
+  class static_handle_vector_t;
+
+  // forward declare debug_handles friend function
+  template<typename T, std::size_t N, typename Tag>
+  [[nodiscard]] std::string debug_handles(
+    const static_handle_vector_t<T, N, Tag>& static_handle_vector);
+
+  // fixed capacity storage for up to N elements of type T that never allocates
+  // (elements, element ids and handles are all stored inline)
+  // note: Index and Gen are chosen at compile time based on N, for N less than
+  // 32768 handles fit in 32 bits
+  // note: handles that reach their generation limit are retired so the number
+  // of elements that can be stored may slowly decrease below N
+  template<typename T, std::size_t N, typename Tag = default_tag_t>
+  class static_handle_vector_t
+  {
+    static_assert(N > 0, "Capacity must be greater than zero.");
+    static_assert(
+      N <= static_cast<std::size_t>(std::numeric_limits<int32_t>::max()),
+      "Capacity must fit in a 32 bit signed integer.");
+
+  public:
+    using index_type = detail::static_index_t<N>;
+    using gen_type = detail::static_gen_t<index_type>;
+    using handle_type = typed_handle_t<Tag, index_type, gen_type>;
+    using iterator = T*;
+    using const_iterator = const T*;
+    using value_type = T;
+    using reference = T&;
+    using const_reference = const T&;
+
+  private:
+    // internal mapping from external handle to internal element
+    // maintains a reference to the next free handle
+    struct internal_handle_t
+    {
+      gen_type gen_ = -1; // generation of handle to be looked up
+      index_type lookup_ = -1; // mapping to element
+      index_type next_ = -1; // index of next available handle
+    };
+
+    // index used to mark the end of the free list
+    static constexpr auto end_of_list = static_cast<index_type>(N);
+
+    // inline storage for elements (only the first size_ are constructed)
+    alignas(T) unsigned char elements_[sizeof(T) * N];
+    // parallel array of ids that map from elements back to the corresponding
+    // handle
+    std::array<index_type, N> element_ids_;
+    // fixed array of handles to elements
+    std::array<internal_handle_t, N> handles_;
+
+    // number of elements currently stored
+    index_type size_ = 0;
+    // index of the next handle to be allocated (end_of_list if none are free)
+    index_type dequeue_ = 0;
+    // index of the last handle in the free list
+    index_type enqueue_ = end_of_list - 1;
+    // number of handles that are depleted (generation is at its limit)
+    index_type depleted_handles_ = 0;
+
+    // returns a pointer to the element storage at position
+    T* element(index_type position);
+    const T* element(index_type position) const;
+    // resets all handles (keeping their generation) and rebuilds the free list
+    // (skipping any handles that are depleted)
+    void reset_handles();
+    // destroys all stored elements
+    void destroy_elements();
+    // copies bookkeeping from another container (but not elements)
+    void copy_handles(const static_handle_vector_t& other);
+    // reorders elements in the range to match the order of element_ids_
+    // (which has been sorted or partitioned) and updates handles to match
+    // note: uses each handle's lookup_ as the source position so no additional
+    // memory is required
+    void apply_id_order(index_type begin, index_type end);
+    // returns a mutable pointer to the underlying element T referenced by the
+    // handle
+    [[nodiscard]] T* resolve(handle_type handle);
+    // returns a constant pointer to the underlying element T referenced by the
+    // handle
+    [[nodiscard]] const T* resolve(handle_type handle) const;
+
+  public:
+    static_handle_vector_t();
+    static_handle_vector_t(const static_handle_vector_t& other);
+    static_handle_vector_t(static_handle_vector_t&& other) noexcept(
+      std::is_nothrow_move_constructible<T>::value);
+    static_handle_vector_t& operator=(const static_handle_vector_t& other);
+    static_handle_vector_t& operator=(static_handle_vector_t&& other) noexcept(
+      std::is_nothrow_move_constructible<T>::value);
+    ~static_handle_vector_t();
+
+    // creates an element T in-place and returns a handle to it
+    // returns an empty optional if the container is full (no allocation is
+    // ever performed)
+    template<typename... Args>
+    [[nodiscard]] std::optional<handle_type> try_add(Args&&... args);
+    // creates an element T in-place and returns a handle to it
+    // note: the container must not be full (see try_add)
+    template<typename... Args>
+    [[nodiscard]] handle_type add(Args&&... args);
+    // invokes a callable object (usually a lambda) on a particular element in
+    // the container
+    template<typename Fn>
+    void call(handle_type handle, Fn&& fn);
+    // invokes a callable object (usually a lambda) on a particular element in
+    // the container (const overload)
+    template<typename Fn>
+    void call(handle_type handle, Fn&& fn) const;
+    // invokes a callable object (usually a lambda) on a particular element in
+    // the container and returns a std::optional containing either the result
+    // or an empty optional (as the handle may not have been successfully
+    // resolved)
+    template<typename Fn>
+    [[nodiscard]] decltype(auto) call_return(handle_type handle, Fn&& fn);
+    // invokes a callable object (usually a lambda) on a particular element in
+    // the container and returns a std::optional containing either the result
+    // or an empty optional (const overload)
+    template<typename Fn>
+    [[nodiscard]] decltype(auto) call_return(
+      handle_type handle, Fn&& fn) const;
+    // removes the element referenced by the handle
+    // returns true if the element was removed, false otherwise (the handle was
+    // invalid or could not be found in the container)
+    bool remove(handle_type handle);
+    // returns if the container still has the element referenced by the handle
+    [[nodiscard]] bool has(handle_type handle) const;
+    // returns the number of elements currently stored in the container
+    [[nodiscard]] index_type size() const;
+    // returns the number of handles (the maximum number of elements)
+    [[nodiscard]] static constexpr index_type capacity()
+    {
+      return static_cast<index_type>(N);
+    }
+    // returns if no more elements can be added
+    [[nodiscard]] bool full() const;
+    // removes all elements and invalidates all handles
+    void clear();
+    // returns the handle for a value at the given index
+    // note: will return an invalid handle if the index is out of range
+    [[nodiscard]] handle_type handle_from_index(index_type index) const;
+    // returns the index (position) of a value for a given handle
+    // note: will return an empty optional if the handle is invalid
+    [[nodiscard]] std::optional<index_type> index_from_handle(
+      handle_type handle) const;
+    // returns if the container has any elements or not
+    [[nodiscard]] bool empty() const;
+    // returns mutable reference to element at position
+    // note: position must be in range (0 <= position < size)
+    T& operator[](index_type position);
+    // returns constant reference to element at position
+    // note: position must be in range (0 <= position < size)
+    const T& operator[](index_type position) const;
+    // returns a pointer to the underlying element storage
+    T* data();
+    // returns a const pointer to the underlying element storage
+    const T* data() const;
+    // returns an iterator to the beginning of the elements
+    auto begin() -> iterator;
+    // returns a const iterator to the beginning of the elements
+    auto begin() const -> const_iterator;
+    // returns an iterator to the end of the elements
+    auto end() -> iterator;
+    // returns a const iterator to the end of the elements
+    auto end() const -> const_iterator;
+    // sorts elements in the container according to the provided comparison
+    // note: no additional memory is allocated
+    template<typename Compare>
+    void sort(Compare&& compare);
+    // sorts elements in the container in the specified range according to the
+    // provided comparison
+    // begin - inclusive, end - exclusive
+    template<typename Compare>
+    void sort(index_type begin, index_type end, Compare&& compare);
+    // partitions elements in the container according to the provided predicate
+    // returns index of the first element for the second group
+    template<typename Predicate>
+    index_type partition(Predicate&& predicate);
+
+    // returns an ascii representation of the currently allocated handles
+    // (useful for debugging purposes)
+    friend std::string debug_handles<T, N, Tag>(
+      const static_handle_vector_t<T, N, Tag>& static_handle_vector);
+  };
+} // namespace thh
+
+#include "static-handle-vector.inl"
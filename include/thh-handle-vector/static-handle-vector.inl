@@ -0,0 +1,464 @@
+namespace thh
+{
+  template<typename T, std::size_t N, typename Tag>
+  T* static_handle_vector_t<T, N, Tag>::element(const index_type position)
+  {
+    return std::launder(reinterpret_cast<T*>(elements_) + position);
+  }
+
+  template<typename T, std::size_t N, typename Tag>
+  const T* static_handle_vector_t<T, N, Tag>::element(
+    const index_type position) const
+  {
+    return std::launder(reinterpret_cast<const T*>(elements_) + position);
+  }
+
+  template<typename T, std::size_t N, typename Tag>
+  void static_handle_vector_t<T, N, Tag>::reset_handles()
+  {
+    // rebuild the free list in order, leaving generations untouched (ensures
+    // existing external handles cannot be used again with the container)
+    dequeue_ = end_of_list;
+    enqueue_ = end_of_list;
+    depleted_handles_ = 0;
+    for (std::size_t i = 0; i < N; i++) {
+      auto& internal_handle = handles_[i];
+      internal_handle.lookup_ = -1;
+      internal_handle.next_ = end_of_list;
+      if (internal_handle.gen_ == std::numeric_limits<gen_type>::max()) {
+        depleted_handles_++;
+        continue;
+      }
+      const auto handle_index = static_cast<index_type>(i);
+      if (dequeue_ == end_of_list) {
+        dequeue_ = handle_index;
+      } else {
+        handles_[enqueue_].next_ = handle_index;
+      }
+      enqueue_ = handle_index;
+    }
+  }
+
+  template<typename T, std::size_t N, typename Tag>
+  void static_handle_vector_t<T, N, Tag>::destroy_elements()
+  {
+    for (index_type i = 0; i < size_; i++) {
+      element(i)->~T();
+    }
+    size_ = 0;
+  }
+
+  template<typename T, std::size_t N, typename Tag>
+  void static_handle_vector_t<T, N, Tag>::copy_handles(
+    const static_handle_vector_t& other)
+  {
+    element_ids_ = other.element_ids_;
+    handles_ = other.handles_;
+    dequeue_ = other.dequeue_;
+    enqueue_ = other.enqueue_;
+    depleted_handles_ = other.depleted_handles_;
+  }
+
+  template<typename T, std::size_t N, typename Tag>
+  static_handle_vector_t<T, N, Tag>::static_handle_vector_t()
+  {
+    reset_handles();
+  }
+
+  template<typename T, std::size_t N, typename Tag>
+  static_handle_vector_t<T, N, Tag>::static_handle_vector_t(
+    const static_handle_vector_t& other)
+  {
+    copy_handles(other);
+    for (; size_ < other.size_; size_++) {
+      ::new (static_cast<void*>(element(size_))) T(*other.element(size_));
+    }
+  }
+
+  template<typename T, std::size_t N, typename Tag>
+  static_handle_vector_t<T, N, Tag>::static_handle_vector_t(
+    static_handle_vector_t&& other) noexcept(
+    std::is_nothrow_move_constructible<T>::value)
+  {
+    copy_handles(other);
+    for (; size_ < other.size_; size_++) {
+      ::new (static_cast<void*>(element(size_)))
+        T(std::move(*other.element(size_)));
+    }
+  }
+
+  template<typename T, std::size_t N, typename Tag>
+  auto static_handle_vector_t<T, N, Tag>::operator=(
+    const static_handle_vector_t& other) -> static_handle_vector_t&
+  {
+    if (this != &other) {
+      destroy_elements();
+      copy_handles(other);
+      for (; size_ < other.size_; size_++) {
+        ::new (static_cast<void*>(element(size_))) T(*other.element(size_));
+      }
+    }
+    return *this;
+  }
+
+  template<typename T, std::size_t N, typename Tag>
+  auto static_handle_vector_t<T, N, Tag>::operator=(
+    static_handle_vector_t&& other) noexcept(
+    std::is_nothrow_move_constructible<T>::value) -> static_handle_vector_t&
+  {
+    if (this != &other) {
+      destroy_elements();
+      copy_handles(other);
+      for (; size_ < other.size_; size_++) {
+        ::new (static_cast<void*>(element(size_)))
+          T(std::move(*other.element(size_)));
+      }
+    }
+    return *this;
+  }
+
+  template<typename T, std::size_t N, typename Tag>
+  static_handle_vector_t<T, N, Tag>::~static_handle_vector_t()
+  {
+    destroy_elements();
+  }
+
+  template<typename T, std::size_t N, typename Tag>
+  template<typename... Args>
+  auto static_handle_vector_t<T, N, Tag>::try_add(Args&&... args)
+    -> std::optional<handle_type>
+  {
+    if (full()) {
+      return std::nullopt;
+    }
+
+    const auto lookup = size_;
+    // allocate new element
+    ::new (static_cast<void*>(element(lookup)))
+      T(std::forward<Args>(args)...);
+    size_++;
+
+    const auto index = dequeue_;
+    // increment the generation of the handle
+    auto& internal_handle = handles_[index];
+    assert(internal_handle.lookup_ == -1); // ensure handle is free
+    internal_handle.gen_++;
+
+    // map handle to newly allocated element
+    internal_handle.lookup_ = lookup;
+
+    // map the element back to the handle it's bound to
+    element_ids_[lookup] = index;
+    // update the next available handle
+    dequeue_ = internal_handle.next_;
+
+    return handle_type{index, internal_handle.gen_};
+  }
+
+  template<typename T, std::size_t N, typename Tag>
+  template<typename... Args>
+  auto static_handle_vector_t<T, N, Tag>::add(Args&&... args) -> handle_type
+  {
+    assert(!full());
+    return try_add(std::forward<Args>(args)...).value_or(handle_type{});
+  }
+
+  template<typename T, std::size_t N, typename Tag>
+  template<typename Fn>
+  void static_handle_vector_t<T, N, Tag>::call(
+    const handle_type handle, Fn&& fn)
+  {
+    if (T* element = resolve(handle)) {
+      fn(*element);
+    }
+  }
+
+  template<typename T, std::size_t N, typename Tag>
+  template<typename Fn>
+  void static_handle_vector_t<T, N, Tag>::call(
+    const handle_type handle, Fn&& fn) const
+  {
+    if (const T* element = resolve(handle)) {
+      fn(*element);
+    }
+  }
+
+  template<typename T, std::size_t N, typename Tag>
+  template<typename Fn>
+  decltype(auto) static_handle_vector_t<T, N, Tag>::call_return(
+    const handle_type handle, Fn&& fn)
+  {
+    if (T* element = resolve(handle)) {
+      return std::optional(fn(*element));
+    }
+    return std::optional<decltype(fn(std::declval<T&>()))>{};
+  }
+
+  template<typename T, std::size_t N, typename Tag>
+  template<typename Fn>
+  decltype(auto) static_handle_vector_t<T, N, Tag>::call_return(
+    const handle_type handle, Fn&& fn) const
+  {
+    if (const T* element = resolve(handle)) {
+      return std::optional(fn(*element));
+    }
+    return std::optional<decltype(fn(std::declval<const T&>()))>{};
+  }
+
+  template<typename T, std::size_t N, typename Tag>
+  bool static_handle_vector_t<T, N, Tag>::has(const handle_type handle) const
+  {
+    if (handle.id_ < 0 || handle.id_ >= capacity()) {
+      return false;
+    }
+
+    // ensure the handle matches the one stored internally
+    // and is referencing a valid element
+    const internal_handle_t& ih = handles_[handle.id_];
+    return ih.gen_ == handle.gen_ && ih.lookup_ >= 0 && ih.lookup_ < size_;
+  }
+
+  template<typename T, std::size_t N, typename Tag>
+  bool static_handle_vector_t<T, N, Tag>::remove(const handle_type handle)
+  {
+    if (!has(handle)) {
+      return false;
+    }
+
+    using std::swap;
+    auto& internal_handle = handles_[handle.id_];
+    const auto lookup = internal_handle.lookup_;
+    const auto last = static_cast<index_type>(size_ - 1);
+    // find the handle of the last element currently stored and have it
+    // point to the look-up of the element about to be removed
+    handles_[element_ids_[last]].lookup_ = lookup;
+    // swap the last element with the element being removed and then destroy
+    // the last element (the element and element_ids array have a one to one
+    // mapping)
+    swap(*element(lookup), *element(last));
+    element(last)->~T();
+    swap(element_ids_[lookup], element_ids_[last]);
+    size_--;
+
+    // free handle being removed (make ready for reuse)
+    internal_handle.lookup_ = -1;
+    internal_handle.next_ = end_of_list;
+
+    // retire handle if generation has reached its limit
+    if (internal_handle.gen_ == std::numeric_limits<gen_type>::max()) {
+      depleted_handles_++;
+      return true;
+    }
+
+    if (dequeue_ == end_of_list) {
+      dequeue_ = handle.id_;
+    } else {
+      handles_[enqueue_].next_ = handle.id_;
+    }
+    enqueue_ = handle.id_;
+
+    return true;
+  }
+
+  template<typename T, std::size_t N, typename Tag>
+  auto static_handle_vector_t<T, N, Tag>::size() const -> index_type
+  {
+    return size_;
+  }
+
+  template<typename T, std::size_t N, typename Tag>
+  bool static_handle_vector_t<T, N, Tag>::full() const
+  {
+    return dequeue_ == end_of_list;
+  }
+
+  template<typename T, std::size_t N, typename Tag>
+  const T* static_handle_vector_t<T, N, Tag>::resolve(
+    const handle_type handle) const
+  {
+    if (!has(handle)) {
+      return nullptr;
+    }
+    return element(handles_[handle.id_].lookup_);
+  }
+
+  template<typename T, std::size_t N, typename Tag>
+  T* static_handle_vector_t<T, N, Tag>::resolve(const handle_type handle)
+  {
+    return const_cast<T*>(
+      static_cast<const static_handle_vector_t&>(*this).resolve(handle));
+  }
+
+  template<typename T, std::size_t N, typename Tag>
+  void static_handle_vector_t<T, N, Tag>::clear()
+  {
+    destroy_elements();
+    reset_handles();
+  }
+
+  template<typename T, std::size_t N, typename Tag>
+  auto static_handle_vector_t<T, N, Tag>::handle_from_index(
+    const index_type index) const -> handle_type
+  {
+    if (index < 0 || index >= size_) {
+      return handle_type{};
+    }
+    const auto handle = element_ids_[index];
+    return {handle, handles_[handle].gen_};
+  }
+
+  template<typename T, std::size_t N, typename Tag>
+  auto static_handle_vector_t<T, N, Tag>::index_from_handle(
+    const handle_type handle) const -> std::optional<index_type>
+  {
+    if (!has(handle)) {
+      return std::nullopt;
+    }
+    return handles_[handle.id_].lookup_;
+  }
+
+  template<typename T, std::size_t N, typename Tag>
+  bool static_handle_vector_t<T, N, Tag>::empty() const
+  {
+    return size_ == 0;
+  }
+
+  template<typename T, std::size_t N, typename Tag>
+  T& static_handle_vector_t<T, N, Tag>::operator[](const index_type position)
+  {
+    return const_cast<T&>(
+      static_cast<const static_handle_vector_t&>(*this).operator[](position));
+  }
+
+  template<typename T, std::size_t N, typename Tag>
+  const T& static_handle_vector_t<T, N, Tag>::operator[](
+    const index_type position) const
+  {
+    assert(position >= 0 && position < size_);
+    return *element(position);
+  }
+
+  template<typename T, std::size_t N, typename Tag>
+  T* static_handle_vector_t<T, N, Tag>::data()
+  {
+    return element(0);
+  }
+
+  template<typename T, std::size_t N, typename Tag>
+  const T* static_handle_vector_t<T, N, Tag>::data() const
+  {
+    return element(0);
+  }
+
+  template<typename T, std::size_t N, typename Tag>
+  auto static_handle_vector_t<T, N, Tag>::begin() -> iterator
+  {
+    return data();
+  }
+
+  template<typename T, std::size_t N, typename Tag>
+  auto static_handle_vector_t<T, N, Tag>::begin() const -> const_iterator
+  {
+    return data();
+  }
+
+  template<typename T, std::size_t N, typename Tag>
+  auto static_handle_vector_t<T, N, Tag>::end() -> iterator
+  {
+    return data() + size_;
+  }
+
+  template<typename T, std::size_t N, typename Tag>
+  auto static_handle_vector_t<T, N, Tag>::end() const -> const_iterator
+  {
+    return data() + size_;
+  }
+
+  template<typename T, std::size_t N, typename Tag>
+  void static_handle_vector_t<T, N, Tag>::apply_id_order(
+    const index_type begin, const index_type end)
+  {
+    for (index_type i = begin; i < end; i++) {
+      if (handles_[element_ids_[i]].lookup_ == i) {
+        continue;
+      }
+      // follow the cycle of moves, each position takes the element from the
+      // position its handle currently looks up (which is then updated)
+      T temp(std::move(*element(i)));
+      auto current = i;
+      while (true) {
+        auto& internal_handle = handles_[element_ids_[current]];
+        const auto source = internal_handle.lookup_;
+        internal_handle.lookup_ = current;
+        if (source == i) {
+          *element(current) = std::move(temp);
+          break;
+        }
+        *element(current) = std::move(*element(source));
+        current = source;
+      }
+    }
+  }
+
+  template<typename T, std::size_t N, typename Tag>
+  template<typename Compare>
+  void static_handle_vector_t<T, N, Tag>::sort(Compare&& compare)
+  {
+    sort(index_type(0), size_, std::forward<Compare>(compare));
+  }
+
+  template<typename T, std::size_t N, typename Tag>
+  template<typename Compare>
+  void static_handle_vector_t<T, N, Tag>::sort(
+    const index_type begin, const index_type end, Compare&& compare)
+  {
+    const auto last = std::min(end, size_);
+    // sort ids (handles still refer to the original element positions)
+    std::sort(
+      element_ids_.begin() + begin, element_ids_.begin() + last,
+      [this, &compare](const index_type lhs, const index_type rhs) {
+        return compare(handles_[lhs].lookup_, handles_[rhs].lookup_);
+      });
+    apply_id_order(begin, last);
+  }
+
+  template<typename T, std::size_t N, typename Tag>
+  template<typename Predicate>
+  auto static_handle_vector_t<T, N, Tag>::partition(Predicate&& predicate)
+    -> index_type
+  {
+    const auto second = std::partition(
+      element_ids_.begin(), element_ids_.begin() + size_,
+      [this, &predicate](const index_type id) {
+        return predicate(handles_[id].lookup_);
+      });
+    apply_id_order(index_type(0), size_);
+    return index_type(second - element_ids_.begin());
+  }
+
+  template<typename T, std::size_t N, typename Tag>
+  std::string debug_handles(
+    const static_handle_vector_t<T, N, Tag>& static_handle_vector)
+  {
+    constexpr std::string_view filled_glyph = "[o]";
+    constexpr std::string_view empty_glyph = "[x]";
+    constexpr std::string_view depleted_glyph = "[!]";
+
+    using gen_type = typename static_handle_vector_t<T, N, Tag>::gen_type;
+
+    std::string buffer;
+    for (const auto& handle : static_handle_vector.handles_) {
+      std::string_view glyph;
+      if (handle.gen_ == std::numeric_limits<gen_type>::max()) {
+        glyph = depleted_glyph;
+      } else if (handle.lookup_ == -1) {
+        glyph = empty_glyph;
+      } else {
+        glyph = filled_glyph;
+      }
+      buffer.append(glyph);
+    }
+
+    return buffer;
+  }
+} // namespace thh
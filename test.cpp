@@ -1,10 +1,30 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "doctest/doctest.h"
 
+#include "thh-handle-vector/chunked-handle-vector.hpp"
+#include "thh-handle-vector/concurrent-handle-vector.hpp"
+#include "thh-handle-vector/epoch-handle-vector.hpp"
+#include "thh-handle-vector/handle-registry.hpp"
+#include "thh-handle-vector/handle-soa-vector.hpp"
 #include "thh-handle-vector/handle-vector.hpp"
-
+#include "thh-handle-vector/join.hpp"
+#include "thh-handle-vector/mapped-handle-vector.hpp"
+#include "thh-handle-vector/packed-handle.hpp"
+#include "thh-handle-vector/static-handle-vector.hpp"
+
+#include <atomic>
+#include <cstring>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory_resource>
 #include <numeric>
 #include <random>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <utility>
 
 TEST_CASE("HandleComparisons")
 {
@@ -1409,3 +1429,2707 @@ TEST_CASE("StableOrderingOfElementsAfterAdditionAndRemoval")
   handle_vector.call(
     handles.back(), [](const char& c) mutable { CHECK(c == 'k'); });
 }
+
+TEST_CASE("AddNReturnsHandleForEachElement")
+{
+  thh::handle_vector_t<char> handle_vector;
+  std::vector<thh::handle_t> handles;
+  handle_vector.add_n(5, std::back_inserter(handles), 'a');
+
+  CHECK(handles.size() == 5);
+  CHECK(handle_vector.size() == 5);
+  for (const auto handle : handles) {
+    CHECK(handle_vector.has(handle));
+    handle_vector.call(handle, [](const char c) { CHECK(c == 'a'); });
+  }
+}
+
+TEST_CASE("AddNReusesRemovedHandles")
+{
+  thh::handle_vector_t<int> handle_vector;
+  std::vector<thh::handle_t> handles;
+  for (int i = 0; i < 5; i++) {
+    handles.push_back(handle_vector.add(i));
+  }
+
+  handle_vector.remove(handles[1]);
+  handle_vector.remove(handles[3]);
+
+  std::vector<thh::handle_t> added_handles(10);
+  const auto last = handle_vector.add_n(10, added_handles.begin(), 42);
+
+  CHECK(last == added_handles.end());
+  CHECK(handle_vector.size() == 13);
+  CHECK(handle_vector.capacity() == 16);
+
+  // removed handles are not lost when storage grows
+  const auto reused = [&added_handles](const int32_t id) {
+    return std::any_of(
+      added_handles.begin(), added_handles.end(),
+      [id](const thh::handle_t handle) {
+        return handle.id_ == id && handle.gen_ == 1;
+      });
+  };
+  CHECK(reused(1));
+  CHECK(reused(3));
+
+  for (const auto handle : added_handles) {
+    handle_vector.call(handle, [](const int value) { CHECK(value == 42); });
+  }
+}
+
+TEST_CASE("AddNMatchesIndividualAdds")
+{
+  using handle_vector_t =
+    thh::handle_vector_t<int, thh::default_tag_t, int32_t, int8_t>;
+  using handle_t = thh::typed_handle_t<thh::default_tag_t, int32_t, int8_t>;
+  handle_vector_t batched;
+  handle_vector_t individual;
+  const auto both = [&](auto&& fn) {
+    fn(batched);
+    fn(individual);
+  };
+
+  both([](handle_vector_t& handle_vector) {
+    std::vector<handle_t> handles;
+    for (int i = 0; i < 100; i++) {
+      handles.push_back(handle_vector.add(i));
+    }
+    // cycle through the 43 free handles until some of those waiting on the
+    // free list are depleted
+    for (int i = 0; i < 100; i += 7) {
+      handle_vector.remove(handles[i]);
+    }
+    for (int i = 0; i < 43 * 127 + 10; i++) {
+      handle_vector.remove(handle_vector.add());
+    }
+    // leave tombstones waiting to be compacted
+    for (int i = 1; i < 100; i += 9) {
+      handle_vector.remove_deferred(handles[i]);
+    }
+    handle_vector.track_changes(true);
+  });
+
+  std::vector<handle_t> batched_handles(150);
+  batched.add_n(150, batched_handles.begin(), 5);
+  std::vector<handle_t> individual_handles;
+  for (int i = 0; i < 150; i++) {
+    individual_handles.push_back(individual.add(5));
+  }
+
+  CHECK(batched_handles == individual_handles);
+  CHECK(batched.size() == individual.size());
+  for (const auto handle : batched_handles) {
+    batched.call(handle, [](const int value) { CHECK(value == 5); });
+  }
+
+  std::vector<handle_t> batched_added;
+  batched.for_each_added(
+    [&batched_added](const handle_t handle, int) {
+      batched_added.push_back(handle);
+    });
+  CHECK(batched_added == batched_handles);
+
+  both([](handle_vector_t& handle_vector) { handle_vector.compact(); });
+  CHECK(batched.size() == individual.size());
+  for (int32_t i = 0; i < batched.size(); i++) {
+    CHECK(batched.handle_from_index(i) == individual.handle_from_index(i));
+  }
+}
+
+TEST_CASE("RemoveRangeRemovesElementsReferencedByHandles")
+{
+  thh::handle_vector_t<int> handle_vector;
+  std::vector<thh::handle_t> handles;
+  for (int i = 0; i < 10; i++) {
+    handles.push_back(handle_vector.add(i));
+  }
+
+  const thh::handle_t to_remove[] = {
+    handles[1], handles[9], handles[3], handles[3], thh::handle_t{}};
+  const auto removed =
+    handle_vector.remove(std::begin(to_remove), std::end(to_remove));
+
+  CHECK(removed == 3);
+  CHECK(handle_vector.size() == 7);
+  CHECK(!handle_vector.has(handles[1]));
+  CHECK(!handle_vector.has(handles[3]));
+  CHECK(!handle_vector.has(handles[9]));
+
+  for (int i = 0; i < 10; i++) {
+    if (i == 1 || i == 3 || i == 9) {
+      continue;
+    }
+    handle_vector.call(
+      handles[i], [i](const int value) { CHECK(value == i); });
+  }
+
+  for (int32_t i = 0; i < handle_vector.size(); i++) {
+    const auto handle = handle_vector.handle_from_index(i);
+    CHECK(handle_vector.index_from_handle(handle) == i);
+  }
+}
+
+TEST_CASE("RemoveRangeCanRemoveAllElements")
+{
+  thh::handle_vector_t<int> handle_vector;
+  std::vector<thh::handle_t> handles;
+  handle_vector.add_n(8, std::back_inserter(handles), 1);
+
+  const auto removed = handle_vector.remove(handles.begin(), handles.end());
+
+  CHECK(removed == 8);
+  CHECK(handle_vector.empty());
+
+  // freed handles are reused in order
+  const auto handle = handle_vector.add();
+  CHECK(handle.id_ == 0);
+  CHECK(handle.gen_ == 1);
+}
+
+TEST_CASE("IndicesCanBeReturnedFromHandles")
+{
+  thh::handle_vector_t<int> handle_vector;
+  std::vector<thh::handle_t> handles;
+  for (int i = 0; i < 40; i++) {
+    handles.push_back(handle_vector.add(i));
+  }
+
+  handle_vector.remove(handles[5]);
+  handle_vector.remove(handles[17]);
+  handles.push_back(thh::handle_t{});
+  handles.push_back(thh::handle_t(1000, 0));
+  handles.push_back(thh::handle_t(2, 3));
+
+  std::vector<int32_t> indices(handles.size());
+  const auto resolved = handle_vector.indices_from_handles(
+    handles.data(), static_cast<int32_t>(handles.size()), indices.data());
+
+  CHECK(resolved == 38);
+  for (size_t i = 0; i < handles.size(); i++) {
+    const auto index = handle_vector.index_from_handle(handles[i]);
+    CHECK(indices[i] == index.value_or(-1));
+  }
+}
+
+TEST_CASE("ManyElementsCanBeResolvedFromHandles")
+{
+  thh::handle_vector_t<int> handle_vector;
+  std::vector<thh::handle_t> handles;
+  for (int i = 0; i < 100; i++) {
+    handles.push_back(handle_vector.add(i));
+  }
+
+  handle_vector.remove(handles[42]);
+
+  std::vector<int*> elements(handles.size());
+  const auto resolved = handle_vector.resolve_many(
+    handles.data(), static_cast<int32_t>(handles.size()), elements.data());
+
+  CHECK(resolved == 99);
+  CHECK(elements[42] == nullptr);
+  for (int i = 0; i < 100; i++) {
+    if (i != 42) {
+      CHECK(*elements[i] == i);
+    }
+  }
+
+  const auto& const_handle_vector = handle_vector;
+  std::vector<const int*> const_elements(handles.size());
+  const_handle_vector.resolve_many(
+    handles.data(), static_cast<int32_t>(handles.size()),
+    const_elements.data());
+
+  CHECK(std::equal(
+    elements.begin(), elements.end(), const_elements.begin(),
+    const_elements.end()));
+}
+
+TEST_CASE("ResolvingHandlesWithEmptyContainerFails")
+{
+  thh::handle_vector_t<int, thh::default_tag_t, int16_t, int8_t> handle_vector;
+  const thh::typed_handle_t<thh::default_tag_t, int16_t, int8_t> handles[] = {
+    {0, 0}, {1, 0}};
+  int16_t indices[2];
+  const auto resolved =
+    handle_vector.indices_from_handles(handles, 2, indices);
+
+  CHECK(resolved == 0);
+  CHECK(indices[0] == -1);
+  CHECK(indices[1] == -1);
+}
+
+using soa_vector_t =
+  thh::handle_soa_vector_t<thh::default_tag_t, int32_t, int32_t, int, float>;
+
+TEST_CASE("SoaContainerValuesCanBeAddedAndResolved")
+{
+  soa_vector_t soa_vector;
+  const auto handle1 = soa_vector.add(1, 1.0f);
+  const auto handle2 = soa_vector.add();
+
+  CHECK(soa_vector.size() == 2);
+  CHECK(soa_vector.has(handle1));
+  CHECK(soa_vector.has(handle2));
+
+  soa_vector.call(handle1, [](const int i, const float f) {
+    CHECK(i == 1);
+    CHECK(f == 1.0f);
+  });
+  soa_vector.call(handle2, [](int& i, float& f) {
+    i = 2;
+    f = 2.0f;
+  });
+
+  const auto sum = soa_vector.call_return(
+    handle2, [](const int i, const float f) { return float(i) + f; });
+  CHECK(sum == 4.0f);
+}
+
+TEST_CASE("SoaContainerColumnsRemainPackedAfterRemoval")
+{
+  soa_vector_t soa_vector;
+  std::vector<thh::handle_t> handles;
+  for (int i = 0; i < 5; i++) {
+    handles.push_back(soa_vector.add(i, float(i) * 10.0f));
+  }
+
+  CHECK(soa_vector.remove(handles[1]));
+  CHECK(!soa_vector.remove(handles[1]));
+
+  const auto ints = soa_vector.column<0>();
+  const auto floats = soa_vector.column<1>();
+  CHECK(ints.size() == 4);
+  CHECK(floats.size() == 4);
+  CHECK(std::accumulate(ints.begin(), ints.end(), 0) == 9);
+  CHECK(std::accumulate(floats.begin(), floats.end(), 0.0f) == 90.0f);
+
+  // values in each column still correspond to one another
+  soa_vector.for_each(
+    [](const int i, const float f) { CHECK(float(i) * 10.0f == f); });
+
+  const auto missing = soa_vector.call_return(
+    handles[1], [](const int i, const float) { return i; });
+  CHECK(!missing.has_value());
+}
+
+TEST_CASE("SoaContainerRangeOfHandlesCanBeRemoved")
+{
+  soa_vector_t soa_vector;
+  std::vector<thh::handle_t> handles;
+  for (int i = 0; i < 10; i++) {
+    handles.push_back(soa_vector.add(i, float(i)));
+  }
+
+  const auto removed = soa_vector.remove(handles.begin(), handles.begin() + 4);
+
+  CHECK(removed == 4);
+  CHECK(soa_vector.size() == 6);
+  for (int i = 4; i < 10; i++) {
+    soa_vector.call(handles[i], [i](const int value, const float f) {
+      CHECK(value == i);
+      CHECK(f == float(i));
+    });
+  }
+}
+
+TEST_CASE("SoaContainerHandlesReferToSameElementsAfterSort")
+{
+  soa_vector_t soa_vector;
+  std::vector<thh::handle_t> handles;
+  std::mt19937 gen(1);
+  std::uniform_int_distribution<> dist(0, 100);
+  for (int i = 0; i < 20; i++) {
+    const int value = dist(gen);
+    handles.push_back(soa_vector.add(value, float(value)));
+  }
+
+  const auto ints = soa_vector.column<0>();
+  soa_vector.sort(
+    [&ints](const auto lhs, const auto rhs) { return ints[lhs] < ints[rhs]; });
+
+  CHECK(std::is_sorted(ints.begin(), ints.end()));
+  soa_vector.for_each([](const int i, const float f) { CHECK(float(i) == f); });
+
+  for (const auto handle : handles) {
+    soa_vector.call(
+      handle, [](const int i, const float f) { CHECK(float(i) == f); });
+    const auto index = soa_vector.index_from_handle(handle);
+    CHECK(soa_vector.handle_from_index(index.value()) == handle);
+  }
+}
+
+TEST_CASE("SoaContainerCanBePartitioned")
+{
+  soa_vector_t soa_vector;
+  std::vector<thh::handle_t> handles;
+  for (int i = 0; i < 10; i++) {
+    handles.push_back(soa_vector.add(i, float(i)));
+  }
+
+  const auto& const_soa_vector = soa_vector;
+  const auto ints = const_soa_vector.column<0>();
+  const auto second = soa_vector.partition(
+    [&ints](const auto index) { return ints[index] % 2 == 0; });
+
+  CHECK(second == 5);
+  for (int32_t i = 0; i < soa_vector.size(); i++) {
+    CHECK((ints[i] % 2 == 0) == (i < second));
+  }
+  for (int i = 0; i < 10; i++) {
+    soa_vector.call(handles[i], [i](const int value, const float f) {
+      CHECK(value == i);
+      CHECK(f == float(i));
+    });
+  }
+}
+
+TEST_CASE("SoaContainerCanBeCleared")
+{
+  soa_vector_t soa_vector;
+  soa_vector.reserve(4);
+  const auto handle = soa_vector.add(1, 1.0f);
+
+  CHECK(soa_vector.capacity() == 4);
+  CHECK(thh::debug_handles(soa_vector) == "[o][x][x][x]");
+
+  soa_vector.clear();
+
+  CHECK(soa_vector.empty());
+  CHECK(!soa_vector.has(handle));
+  CHECK(soa_vector.column<1>().empty());
+}
+
+namespace
+{
+  template<typename T>
+  struct counting_allocator_t
+  {
+    using value_type = T;
+
+    int* allocations_ = nullptr;
+
+    explicit counting_allocator_t(int* allocations)
+      : allocations_(allocations)
+    {
+    }
+    template<typename U>
+    counting_allocator_t(const counting_allocator_t<U>& other)
+      : allocations_(other.allocations_)
+    {
+    }
+
+    T* allocate(const std::size_t n)
+    {
+      ++*allocations_;
+      return std::allocator<T>().allocate(n);
+    }
+    void deallocate(T* p, const std::size_t n)
+    {
+      std::allocator<T>().deallocate(p, n);
+    }
+
+    template<typename U>
+    bool operator==(const counting_allocator_t<U>& other) const
+    {
+      return allocations_ == other.allocations_;
+    }
+    template<typename U>
+    bool operator!=(const counting_allocator_t<U>& other) const
+    {
+      return !(*this == other);
+    }
+  };
+} // namespace
+
+TEST_CASE("CustomAllocatorIsUsedForAllStorage")
+{
+  int allocations = 0;
+  thh::handle_vector_t<
+    int, thh::default_tag_t, int32_t, int32_t, counting_allocator_t<int>>
+    handle_vector{counting_allocator_t<int>(&allocations)};
+  handle_vector.reserve(8);
+
+  // elements, element ids and handles
+  CHECK(allocations == 3);
+
+  const auto handle = handle_vector.add(5);
+  handle_vector.call(handle, [](const int value) { CHECK(value == 5); });
+  CHECK(handle_vector.get_allocator().allocations_ == &allocations);
+}
+
+TEST_CASE("PmrContainerAllocatesFromMemoryResource")
+{
+  alignas(std::max_align_t) std::byte buffer[16384];
+  std::pmr::monotonic_buffer_resource resource(
+    buffer, sizeof(buffer), std::pmr::null_memory_resource());
+
+  thh::pmr::handle_vector_t<int> handle_vector(&resource);
+  std::vector<thh::handle_t> handles;
+  for (int i = 0; i < 100; i++) {
+    handles.push_back(handle_vector.add(i));
+  }
+
+  CHECK(handle_vector.get_allocator().resource() == &resource);
+  for (int i = 0; i < 100; i++) {
+    handle_vector.call(handles[i], [i](const int value) { CHECK(value == i); });
+  }
+}
+
+TEST_CASE("PmrContainersWithDifferentResourcesCanBeSwapped")
+{
+  std::pmr::monotonic_buffer_resource resource_a;
+  std::pmr::monotonic_buffer_resource resource_b;
+
+  thh::pmr::handle_vector_t<int> handle_vector_a(&resource_a);
+  thh::pmr::handle_vector_t<int> handle_vector_b(&resource_b);
+
+  const auto handle_a = handle_vector_a.add(1);
+  const auto handle_b1 = handle_vector_b.add(2);
+  const auto handle_b2 = handle_vector_b.add(3);
+
+  swap(handle_vector_a, handle_vector_b);
+
+  // allocators do not propagate so each container keeps its resource
+  CHECK(handle_vector_a.get_allocator().resource() == &resource_a);
+  CHECK(handle_vector_b.get_allocator().resource() == &resource_b);
+
+  CHECK(handle_vector_a.size() == 2);
+  CHECK(handle_vector_b.size() == 1);
+  handle_vector_a.call(handle_b1, [](const int value) { CHECK(value == 2); });
+  handle_vector_a.call(handle_b2, [](const int value) { CHECK(value == 3); });
+  handle_vector_b.call(handle_a, [](const int value) { CHECK(value == 1); });
+}
+
+TEST_CASE("ContainersWithDefaultAllocatorCanBeSwapped")
+{
+  thh::handle_vector_t<int> handle_vector_a;
+  thh::handle_vector_t<int> handle_vector_b;
+
+  const auto handle_a = handle_vector_a.add(1);
+  const auto* element_a = handle_vector_a.data();
+
+  handle_vector_a.swap(handle_vector_b);
+
+  CHECK(handle_vector_a.empty());
+  CHECK(handle_vector_b.data() == element_a);
+  CHECK(handle_vector_b.has(handle_a));
+}
+
+TEST_CASE("StaticContainerHandlesFitIn32Bits")
+{
+  using small_vector_t = thh::static_handle_vector_t<float, 100>;
+  using medium_vector_t = thh::static_handle_vector_t<float, 30000>;
+  using large_vector_t = thh::static_handle_vector_t<char, 40000>;
+  CHECK(sizeof(small_vector_t::handle_type) == 4);
+  CHECK(sizeof(medium_vector_t::handle_type) == 4);
+  CHECK(sizeof(large_vector_t::handle_type) == 8);
+  CHECK(small_vector_t::capacity() == 100);
+}
+
+TEST_CASE("StaticContainerAddAndRemove")
+{
+  thh::static_handle_vector_t<int, 8> handle_vector;
+  const auto handle1 = handle_vector.add(1);
+  const auto handle2 = handle_vector.add(2);
+  const auto handle3 = handle_vector.add(3);
+
+  CHECK(handle1.id_ == 0);
+  CHECK(handle2.id_ == 1);
+  CHECK(handle3.id_ == 2);
+  CHECK(handle_vector.size() == 3);
+
+  CHECK(handle_vector.remove(handle1));
+  CHECK(!handle_vector.remove(handle1));
+  CHECK(!handle_vector.has(handle1));
+  CHECK(handle_vector.size() == 2);
+
+  // remaining elements are tightly packed
+  CHECK(std::accumulate(handle_vector.begin(), handle_vector.end(), 0) == 5);
+  handle_vector.call(handle3, [](const int value) { CHECK(value == 3); });
+  CHECK(handle_vector.call_return(handle2, [](const int v) { return v; }) == 2);
+}
+
+TEST_CASE("StaticContainerTryAddFailsWhenFull")
+{
+  thh::static_handle_vector_t<int, 4> handle_vector;
+  std::vector<thh::static_handle_vector_t<int, 4>::handle_type> handles;
+  for (int i = 0; i < 4; i++) {
+    const auto handle = handle_vector.try_add(i);
+    CHECK(handle.has_value());
+    handles.push_back(*handle);
+  }
+
+  CHECK(handle_vector.full());
+  CHECK(!handle_vector.try_add(5).has_value());
+  CHECK(handle_vector.size() == 4);
+
+  handle_vector.remove(handles[2]);
+  const auto handle = handle_vector.try_add(6);
+  CHECK(handle.has_value());
+  CHECK(handle->id_ == 2);
+  CHECK(handle->gen_ == 1);
+  CHECK(thh::debug_handles(handle_vector) == "[o][o][o][o]");
+}
+
+TEST_CASE("StaticContainerHandlesReaddedInOrder")
+{
+  thh::static_handle_vector_t<float, 5> handle_vector;
+  std::vector<thh::static_handle_vector_t<float, 5>::handle_type> handles;
+  for (int i = 0; i < 5; i++) {
+    handles.push_back(handle_vector.add());
+  }
+  for (const auto handle : handles) {
+    handle_vector.remove(handle);
+  }
+
+  CHECK(thh::debug_handles(handle_vector) == "[x][x][x][x][x]");
+  const auto handle = handle_vector.add();
+  CHECK(handle.id_ == 0);
+  CHECK(thh::debug_handles(handle_vector) == "[o][x][x][x][x]");
+}
+
+TEST_CASE("StaticContainerDepletedHandleIsRetired")
+{
+  thh::static_handle_vector_t<char, 2> handle_vector;
+  using gen_type = thh::static_handle_vector_t<char, 2>::gen_type;
+
+  // use up every generation of both handles
+  for (int i = 0; i <= std::numeric_limits<gen_type>::max() * 2 + 1; i++) {
+    const auto handle = handle_vector.add();
+    handle_vector.remove(handle);
+  }
+
+  CHECK(handle_vector.full());
+  CHECK(thh::debug_handles(handle_vector) == "[!][!]");
+
+  // handles stay depleted after clear
+  handle_vector.clear();
+  CHECK(handle_vector.full());
+  CHECK(!handle_vector.try_add('a').has_value());
+}
+
+TEST_CASE("StaticContainerHandlesReferToSameElementsAfterSort")
+{
+  thh::static_handle_vector_t<int, 64> handle_vector;
+  std::vector<thh::static_handle_vector_t<int, 64>::handle_type> handles;
+  std::mt19937 gen(1);
+  std::uniform_int_distribution<> dist(0, 1000);
+  for (int i = 0; i < 50; i++) {
+    handles.push_back(handle_vector.add(dist(gen)));
+  }
+  handle_vector.remove(handles[10]);
+
+  std::vector<int> values;
+  for (const auto handle : handles) {
+    values.push_back(
+      handle_vector.call_return(handle, [](const int v) { return v; })
+        .value_or(-1));
+  }
+
+  handle_vector.sort([&handle_vector](const auto lhs, const auto rhs) {
+    return handle_vector[lhs] < handle_vector[rhs];
+  });
+
+  CHECK(std::is_sorted(handle_vector.begin(), handle_vector.end()));
+  for (size_t i = 0; i < handles.size(); i++) {
+    CHECK(
+      handle_vector.call_return(handles[i], [](const int v) { return v; })
+        .value_or(-1)
+      == values[i]);
+  }
+}
+
+TEST_CASE("StaticContainerHandlesReferToSameElementsAfterPartition")
+{
+  thh::static_handle_vector_t<int, 16> handle_vector;
+  std::vector<thh::static_handle_vector_t<int, 16>::handle_type> handles;
+  for (int i = 0; i < 16; i++) {
+    handles.push_back(handle_vector.add(i));
+  }
+
+  const auto second =
+    handle_vector.partition([&handle_vector](const auto index) {
+      return handle_vector[index] % 2 == 0;
+    });
+
+  CHECK(second == 8);
+  for (int i = 0; i < 16; i++) {
+    handle_vector.call(handles[i], [i](const int value) { CHECK(value == i); });
+    const auto index = handle_vector.index_from_handle(handles[i]);
+    CHECK((index.value() < second) == (i % 2 == 0));
+    CHECK(handle_vector.handle_from_index(index.value()) == handles[i]);
+  }
+}
+
+TEST_CASE("StaticContainerCanBeCopiedAndMoved")
+{
+  thh::static_handle_vector_t<std::string, 4> handle_vector;
+  const auto handle = handle_vector.add("hello");
+
+  auto copy = handle_vector;
+  CHECK(copy.call_return(handle, [](const std::string& s) { return s; })
+        == "hello");
+
+  auto moved = std::move(copy);
+  CHECK(moved.has(handle));
+  moved.clear();
+  CHECK(!moved.has(handle));
+  CHECK(handle_vector.has(handle));
+}
+
+TEST_CASE("StaticContainerResourceCleanedUpAfterRemoval")
+{
+  struct resource_t
+  {
+    resource_t() = default;
+    resource_t(const resource_t&) = default;
+    resource_t& operator=(const resource_t&) = default;
+    ~resource_t() { *resource_ = 42; }
+    int* resource_ = nullptr;
+  };
+
+  int value = 100;
+  thh::static_handle_vector_t<resource_t, 4> handle_vector;
+  const auto resource_handle = handle_vector.add();
+  handle_vector.call(
+    resource_handle, [&value](auto& resource) { resource.resource_ = &value; });
+
+  handle_vector.remove(resource_handle);
+
+  CHECK(value == 42);
+}
+
+TEST_CASE("HandleFreedFromEmptyFreeListIsNotReusedTwice")
+{
+  thh::handle_vector_t<int> handle_vector;
+  const auto handle_1 = handle_vector.add(1);
+  auto handle_2 = handle_vector.add(2);
+  handle_vector.remove(handle_2);
+  handle_2 = handle_vector.add(2);
+  handle_vector.remove(handle_1);
+  handle_vector.remove(handle_2);
+  handle_2 = handle_vector.add(2);
+  handle_vector.remove(handle_2);
+
+  // the free list is empty and its tail is the handle being freed
+  handle_2 = handle_vector.add(2);
+  const auto handle_3 = handle_vector.add(3);
+
+  CHECK(handle_3 != handle_2);
+  CHECK(handle_vector.has(handle_2));
+  CHECK(handle_vector.has(handle_3));
+  CHECK(
+    handle_vector.call_return(handle_2, [](const int i) { return i; }) == 2);
+  CHECK(
+    handle_vector.call_return(handle_3, [](const int i) { return i; }) == 3);
+}
+
+TEST_CASE("DeferredRemovalLeavesTombstoneUntilCompacted")
+{
+  thh::handle_vector_t<int> handle_vector;
+  std::vector<thh::handle_t> handles;
+  for (int i = 0; i < 6; ++i) {
+    handles.push_back(handle_vector.add(i));
+  }
+
+  CHECK(handle_vector.remove_deferred(handles[1]));
+  CHECK(handle_vector.remove_deferred(handles[4]));
+  CHECK(!handle_vector.remove_deferred(handles[4]));
+
+  // handles are invalidated immediately but storage is unchanged
+  CHECK(!handle_vector.has(handles[1]));
+  CHECK(!handle_vector.has(handles[4]));
+  CHECK(handle_vector.tombstone_count() == 2);
+  CHECK(handle_vector.size() == 6);
+  CHECK(handle_vector.index_from_handle(handles[5]) == 5);
+  CHECK(handle_vector.handle_from_index(1) == thh::handle_t());
+
+  std::vector<int> visited;
+  handle_vector.for_each([&visited](const int i) { visited.push_back(i); });
+  CHECK(visited == std::vector<int>{0, 2, 3, 5});
+
+  handle_vector.compact();
+  CHECK(handle_vector.tombstone_count() == 0);
+  CHECK(handle_vector.size() == 4);
+  // live elements keep their relative order
+  CHECK(
+    std::vector<int>(handle_vector.begin(), handle_vector.end())
+    == std::vector<int>{0, 2, 3, 5});
+  for (const int i : {0, 2, 3, 5}) {
+    CHECK(
+      handle_vector.call_return(handles[i], [](const int e) { return e; })
+      == i);
+  }
+}
+
+TEST_CASE("ElementsAddedWhileTombstonesPendingAreVisited")
+{
+  thh::handle_vector_t<int> handle_vector;
+  std::vector<thh::handle_t> handles;
+  for (int i = 0; i < 70; ++i) {
+    handles.push_back(handle_vector.add(i));
+  }
+  for (int i = 0; i < 70; i += 2) {
+    handle_vector.remove_deferred(handles[i]);
+  }
+  // reuses handles that were freed by remove_deferred
+  const auto handle = handle_vector.add(100);
+  CHECK(handle_vector.has(handle));
+
+  int count = 0;
+  int sum = 0;
+  handle_vector.for_each([&count, &sum](const int i) {
+    count++;
+    sum += i;
+  });
+  CHECK(count == 36);
+  CHECK(sum == 35 * 35 + 100);
+
+  // eager removal compacts first
+  CHECK(handle_vector.remove(handles[1]));
+  CHECK(handle_vector.tombstone_count() == 0);
+  CHECK(handle_vector.size() == 35);
+  CHECK(
+    handle_vector.call_return(handle, [](const int e) { return e; }) == 100);
+  CHECK(
+    handle_vector.call_return(handles[69], [](const int e) { return e; })
+    == 69);
+}
+
+TEST_CASE("EraseStablePreservesElementOrder")
+{
+  thh::handle_vector_t<int> handle_vector;
+  std::vector<thh::handle_t> handles;
+  for (int i = 0; i < 6; ++i) {
+    handles.push_back(handle_vector.add(i));
+  }
+
+  CHECK(handle_vector.erase_stable(handles[1]));
+  CHECK(!handle_vector.erase_stable(handles[1]));
+  CHECK(
+    std::vector<int>(handle_vector.begin(), handle_vector.end())
+    == std::vector<int>{0, 2, 3, 4, 5});
+  CHECK(!handle_vector.has(handles[1]));
+  for (const int i : {0, 2, 3, 4, 5}) {
+    CHECK(
+      handle_vector.call_return(handles[i], [](const int e) { return e; })
+      == i);
+  }
+}
+
+TEST_CASE("EraseStableRangeShiftsRemainingElementsOnce")
+{
+  thh::handle_vector_t<int> handle_vector;
+  std::vector<thh::handle_t> handles;
+  for (int i = 0; i < 10; ++i) {
+    handles.push_back(handle_vector.add(i));
+  }
+
+  // includes a duplicate and an invalid handle
+  const thh::handle_t erase[] = {
+    handles[7], handles[2], handles[3], handles[7], thh::handle_t(42, 0)};
+  CHECK(handle_vector.erase_stable(std::begin(erase), std::end(erase)) == 3);
+
+  CHECK(handle_vector.size() == 7);
+  CHECK(
+    std::vector<int>(handle_vector.begin(), handle_vector.end())
+    == std::vector<int>{0, 1, 4, 5, 6, 8, 9});
+  for (const int i : {0, 1, 4, 5, 6, 8, 9}) {
+    CHECK(
+      handle_vector.call_return(handles[i], [](const int e) { return e; })
+      == i);
+  }
+  for (const int i : {2, 3, 7}) {
+    CHECK(!handle_vector.has(handles[i]));
+  }
+}
+
+TEST_CASE("SortingSubRangeKeepsHandlesValid")
+{
+  thh::handle_vector_t<int> handle_vector;
+  std::vector<thh::handle_t> handles;
+  for (const int i : {9, 8, 7, 6, 5, 4}) {
+    handles.push_back(handle_vector.add(i));
+  }
+
+  handle_vector.sort(2, 5, [&handle_vector](const int lhs, const int rhs) {
+    return handle_vector[lhs] < handle_vector[rhs];
+  });
+
+  CHECK(
+    std::vector<int>(handle_vector.begin(), handle_vector.end())
+    == std::vector<int>{9, 8, 5, 6, 7, 4});
+  const int expected[] = {9, 8, 7, 6, 5, 4};
+  for (int i = 0; i < 6; ++i) {
+    CHECK(
+      handle_vector.call_return(handles[i], [](const int e) { return e; })
+      == expected[i]);
+  }
+}
+
+TEST_CASE("ContainerCanBeSavedAndLoaded")
+{
+  thh::handle_vector_t<int> handle_vector;
+  std::vector<thh::handle_t> handles;
+  for (int i = 0; i < 10; ++i) {
+    handles.push_back(handle_vector.add(i));
+  }
+  handle_vector.remove(handles[3]);
+  handle_vector.remove(handles[6]);
+
+  std::stringstream stream;
+  CHECK(handle_vector.save(stream));
+
+  thh::handle_vector_t<int> loaded;
+  CHECK(loaded.load(stream));
+  CHECK(loaded.size() == handle_vector.size());
+  for (int i = 0; i < 10; ++i) {
+    CHECK(loaded.has(handles[i]) == handle_vector.has(handles[i]));
+    CHECK(
+      loaded.call_return(handles[i], [](const int e) { return e; })
+      == handle_vector.call_return(handles[i], [](const int e) { return e; }));
+  }
+
+  // free list state is preserved so new handles match
+  CHECK(loaded.add(42) == handle_vector.add(42));
+}
+
+TEST_CASE("ContainerCanBeSavedAndLoadedWithSerializer")
+{
+  thh::handle_vector_t<std::string> handle_vector;
+  const auto handle_1 = handle_vector.add("hello");
+  const auto handle_2 = handle_vector.add("world");
+
+  std::stringstream stream;
+  CHECK(handle_vector.save(
+    stream, [](std::ostream& os, const std::string& element) {
+      const auto length = static_cast<uint32_t>(element.size());
+      os.write(reinterpret_cast<const char*>(&length), sizeof(length));
+      os.write(element.data(), length);
+    }));
+
+  thh::handle_vector_t<std::string> loaded;
+  CHECK(loaded.load(stream, [](std::istream& is) {
+    uint32_t length = 0;
+    is.read(reinterpret_cast<char*>(&length), sizeof(length));
+    std::string element(length, '\0');
+    is.read(element.data(), length);
+    return element;
+  }));
+
+  CHECK(
+    loaded.call_return(handle_1, [](const std::string& e) { return e; })
+    == "hello");
+  CHECK(
+    loaded.call_return(handle_2, [](const std::string& e) { return e; })
+    == "world");
+}
+
+TEST_CASE("LoadingInvalidStreamLeavesContainerEmpty")
+{
+  thh::handle_vector_t<int> handle_vector;
+  const auto handle = handle_vector.add(1);
+  std::stringstream stream;
+  CHECK(handle_vector.save(stream));
+  const std::string saved = stream.str();
+
+  // truncated
+  std::stringstream truncated(saved.substr(0, saved.size() - 1));
+  thh::handle_vector_t<int> loaded;
+  [[maybe_unused]] const auto existing = loaded.add(5);
+  CHECK(!loaded.load(truncated));
+  CHECK(loaded.empty());
+  CHECK(!loaded.has(handle));
+
+  // different element type
+  std::stringstream mismatched(saved);
+  thh::handle_vector_t<int64_t> loaded_wide;
+  CHECK(!loaded_wide.load(mismatched));
+  CHECK(loaded_wide.empty());
+
+  // corrupted contents (the header is followed by the id, handle and bitmap
+  // counts, the free list state and then element ids and handles)
+  thh::handle_vector_t<int> original;
+  const auto first = original.add(1);
+  [[maybe_unused]] const auto second = original.add(2);
+  const auto third = original.add(3);
+  original.remove(third);
+  std::stringstream original_stream;
+  CHECK(original.save(original_stream));
+  const std::string valid = original_stream.str();
+  constexpr size_t counts_offset = 24;
+  constexpr size_t state_offset = counts_offset + 3 * sizeof(uint64_t);
+  constexpr size_t ids_offset = state_offset + 4 * sizeof(int32_t);
+  const size_t handles_offset = ids_offset + 2 * sizeof(int32_t);
+  const auto load_corrupted = [&](const size_t offset, const auto value) {
+    std::string corrupted = valid;
+    std::memcpy(corrupted.data() + offset, &value, sizeof(value));
+    std::stringstream corrupted_stream(corrupted);
+    thh::handle_vector_t<int> corrupted_vector;
+    const bool loaded = corrupted_vector.load(corrupted_stream);
+    CHECK(loaded != corrupted_vector.empty());
+    CHECK(loaded == corrupted_vector.has(first));
+    return loaded;
+  };
+  CHECK(load_corrupted(0, valid[0]));
+  // element id out of range
+  CHECK(!load_corrupted(ids_offset, int32_t(1 << 20)));
+  // duplicate element ids
+  CHECK(!load_corrupted(ids_offset + sizeof(int32_t), first.id_));
+  // free list head out of range
+  CHECK(!load_corrupted(state_offset, int32_t(-5)));
+  // free list tail that is not the last free handle
+  CHECK(!load_corrupted(state_offset + sizeof(int32_t), first.id_));
+  // tombstones without a live bitmap
+  CHECK(!load_corrupted(state_offset + 3 * sizeof(int32_t), int32_t(1)));
+  // free handle linked to itself (a cycle in the free list)
+  const size_t third_lookup = handles_offset
+                            + third.id_ * 2 * sizeof(int32_t)
+                            + sizeof(int32_t);
+  CHECK(!load_corrupted(third_lookup, ~third.id_));
+  // far more handles than the stream holds (rejected before allocating)
+  CHECK(!load_corrupted(counts_offset + sizeof(uint64_t), uint64_t(1) << 30));
+}
+
+#if __has_include(<sys/mman.h>)
+namespace
+{
+  // removes the files backing a mapped container
+  void remove_mapped_files(const std::string& path)
+  {
+    for (const char* suffix : {".handles", ".ids", ".elements"}) {
+      std::filesystem::remove(path + suffix);
+    }
+  }
+} // namespace
+
+TEST_CASE("MappedContainerHandlesRemainValidAfterReopening")
+{
+  const std::string path =
+    (std::filesystem::temp_directory_path() / "thh-mapped-reopen").string();
+  remove_mapped_files(path);
+
+  std::vector<thh::handle_t> handles;
+  {
+    auto handle_vector = thh::mapped_handle_vector_t<int>::open(path);
+    CHECK(handle_vector.has_value());
+    CHECK(handle_vector->empty());
+    for (int i = 0; i < 100; ++i) {
+      handles.push_back(handle_vector->add(i));
+    }
+    handle_vector->remove(handles[10]);
+    handle_vector->remove(handles[50]);
+    CHECK(handle_vector->size() == 98);
+    CHECK(handle_vector->sync());
+  }
+
+  {
+    auto handle_vector = thh::mapped_handle_vector_t<int>::open(path);
+    CHECK(handle_vector.has_value());
+    CHECK(handle_vector->size() == 98);
+    for (int i = 0; i < 100; ++i) {
+      const auto value =
+        handle_vector->call_return(handles[i], [](const int e) { return e; });
+      if (i == 10 || i == 50) {
+        CHECK(!value.has_value());
+      } else {
+        CHECK(value == i);
+      }
+    }
+
+    // removed handles are not reused with the same generation
+    const auto handle = handle_vector->add(1000);
+    CHECK(handle_vector->has(handle));
+    CHECK(!handle_vector->has(handles[10]));
+    CHECK(!handle_vector->has(handles[50]));
+
+    int sum = 0;
+    for (const int element : *handle_vector) {
+      sum += element;
+    }
+    CHECK(sum == 99 * 100 / 2 - 10 - 50 + 1000);
+  }
+
+  remove_mapped_files(path);
+}
+
+TEST_CASE("MappedContainerRejectsIncompatibleFiles")
+{
+  const std::string path =
+    (std::filesystem::temp_directory_path() / "thh-mapped-incompatible")
+      .string();
+  remove_mapped_files(path);
+
+  {
+    auto handle_vector = thh::mapped_handle_vector_t<int>::open(path);
+    CHECK(handle_vector.has_value());
+    [[maybe_unused]] const auto handle = handle_vector->add(1);
+  }
+
+  CHECK(!thh::mapped_handle_vector_t<int64_t>::open(path).has_value());
+  CHECK(thh::mapped_handle_vector_t<int>::open(path).has_value());
+
+  // corrupted header fields (size, capacity and the ends of the free list
+  // follow the magic, version and type sizes)
+  const auto open_corrupted = [&path](const int field, const int32_t value) {
+    std::string original;
+    {
+      std::ifstream file(path + ".handles", std::ios::binary);
+      original.assign(std::istreambuf_iterator<char>(file), {});
+    }
+    std::string corrupted = original;
+    std::memcpy(corrupted.data() + 20 + field * 4, &value, sizeof(value));
+    std::ofstream(path + ".handles", std::ios::binary) << corrupted;
+    const bool opened =
+      thh::mapped_handle_vector_t<int>::open(path).has_value();
+    std::ofstream(path + ".handles", std::ios::binary) << original;
+    return opened;
+  };
+  CHECK(!open_corrupted(0, 1000)); // size larger than capacity
+  CHECK(!open_corrupted(0, -1)); // negative size
+  CHECK(!open_corrupted(2, 1 << 20)); // free list head out of range
+  CHECK(!open_corrupted(3, -7)); // free list tail out of range
+  CHECK(!open_corrupted(3, -1)); // free list with only one end
+  CHECK(!open_corrupted(2, 0)); // free list head that is in use
+  CHECK(thh::mapped_handle_vector_t<int>::open(path).has_value());
+
+  remove_mapped_files(path);
+}
+#endif
+
+TEST_CASE("ConcurrentContainerElementsCanBeAddedAndRemoved")
+{
+  thh::concurrent_handle_vector_t<int> handle_vector(4);
+  CHECK(handle_vector.shard_count() == 4);
+
+  const auto handle_1 = handle_vector.add(1);
+  const auto handle_2 = handle_vector.add(2);
+  CHECK(handle_vector.size() == 2);
+  CHECK(handle_vector.has(handle_1));
+  CHECK(handle_vector.has(handle_2));
+  CHECK(handle_1 != handle_2);
+
+  CHECK(handle_vector.remove(handle_1));
+  CHECK(!handle_vector.remove(handle_1));
+  CHECK(!handle_vector.has(handle_1));
+  CHECK(handle_vector.size() == 1);
+
+  const auto value = handle_vector.call_return(
+    handle_2, [](const int element) { return element; });
+  CHECK(value.has_value());
+  CHECK(*value == 2);
+  CHECK(!handle_vector.call_return(handle_1, [](int element) {
+            return element;
+          }).has_value());
+  CHECK(!handle_vector.has(thh::handle_t(-1, 0)));
+}
+
+TEST_CASE("ConcurrentContainerSupportsConcurrentAddRemoveAndCall")
+{
+  constexpr int thread_count = 4;
+  constexpr int element_count = 1000;
+
+  thh::concurrent_handle_vector_t<int> handle_vector(2);
+  std::vector<std::vector<thh::handle_t>> thread_handles(thread_count);
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < thread_count; ++t) {
+    threads.emplace_back([&handle_vector, &handles = thread_handles[t]] {
+      for (int i = 0; i < element_count; ++i) {
+        handles.push_back(handle_vector.add(i));
+      }
+      for (const auto handle : handles) {
+        handle_vector.call(handle, [](int& element) { element++; });
+      }
+      for (size_t i = 0; i < handles.size(); i += 2) {
+        handle_vector.remove(handles[i]);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  CHECK(handle_vector.size() == thread_count * element_count / 2);
+  for (const auto& handles : thread_handles) {
+    for (size_t i = 0; i < handles.size(); ++i) {
+      CHECK(handle_vector.has(handles[i]) == (i % 2 == 1));
+    }
+  }
+
+  int sum = 0;
+  std::as_const(handle_vector).for_each([&sum](const int element) {
+    sum += element;
+  });
+  // odd indices survive (values 2, 4, ..., 1000 after the increment)
+  CHECK(sum == thread_count * (element_count / 2) * (element_count / 2 + 1));
+
+  handle_vector.clear();
+  CHECK(handle_vector.size() == 0);
+}
+
+TEST_CASE("ConcurrentContainerGivesEachThreadItsOwnShard")
+{
+  constexpr int shard_count = 4;
+  thh::concurrent_handle_vector_t<int> handle_vector(shard_count);
+
+  // threads are given shards in turn (handle ids encode the shard)
+  std::vector<thh::handle_t> handles(shard_count);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < shard_count; ++t) {
+    threads.emplace_back([&handle_vector, &handle = handles[t]] {
+      handle = handle_vector.add(0);
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  std::vector<int32_t> shards;
+  for (const auto handle : handles) {
+    shards.push_back(handle.id_ % shard_count);
+  }
+  std::sort(shards.begin(), shards.end());
+  CHECK(shards == std::vector<int32_t>{0, 1, 2, 3});
+}
+
+TEST_CASE("EpochContainerElementsCanBeResolvedByReaders")
+{
+  thh::epoch_handle_vector_t<int> handle_vector;
+  auto reader = handle_vector.register_reader();
+  CHECK(reader.has_value());
+
+  const auto handle_1 = handle_vector.add(1);
+  const auto handle_2 = handle_vector.add(2);
+  CHECK(handle_vector.size() == 2);
+
+  {
+    const auto guard = reader->enter();
+    CHECK(guard.has(handle_1));
+    CHECK(*guard.resolve(handle_2) == 2);
+    CHECK(
+      guard.call_return(handle_1, [](const int element) { return element; })
+      == 1);
+  }
+
+  CHECK(handle_vector.remove(handle_1));
+  CHECK(!handle_vector.remove(handle_1));
+  CHECK(!handle_vector.has(handle_1));
+
+  {
+    const auto guard = reader->enter();
+    CHECK(!guard.has(handle_1));
+    CHECK(guard.resolve(handle_1) == nullptr);
+    CHECK(guard.resolve(thh::handle_t(100, 0)) == nullptr);
+  }
+}
+
+TEST_CASE("EpochContainerDefersDestructionWhileReadersAreActive")
+{
+  struct tracked_t
+  {
+    explicit tracked_t(int* destroyed) : destroyed_(destroyed) {}
+    tracked_t(const tracked_t&) = default;
+    ~tracked_t() { (*destroyed_)++; }
+    int* destroyed_;
+  };
+
+  int destroyed = 0;
+  thh::epoch_handle_vector_t<tracked_t> handle_vector;
+  auto reader = handle_vector.register_reader();
+  const auto handle = handle_vector.add(&destroyed);
+
+  {
+    const auto guard = reader->enter();
+    const tracked_t* element = guard.resolve(handle);
+    CHECK(element != nullptr);
+
+    // force the underlying buffer to be replaced and remove the element
+    handle_vector.reserve(handle_vector.capacity() * 4);
+    handle_vector.remove(handle);
+    handle_vector.reclaim();
+
+    // the element (and its buffer) are still alive for this reader
+    CHECK(destroyed == 0);
+    CHECK(element->destroyed_ == &destroyed);
+  }
+
+  handle_vector.reclaim();
+  // the original and the copy made when the buffer grew
+  CHECK(destroyed == 2);
+}
+
+TEST_CASE("EpochContainerReusesSlotsOnceReclaimed")
+{
+  thh::epoch_handle_vector_t<int> handle_vector;
+  const auto handle_1 = handle_vector.add(1);
+  handle_vector.remove(handle_1);
+  // no readers are active so the slot is reclaimed immediately
+  const auto handle_2 = handle_vector.add(2);
+  CHECK(handle_2.id_ == handle_1.id_);
+  CHECK(handle_2.gen_ == handle_1.gen_ + 1);
+  CHECK(!handle_vector.has(handle_1));
+
+  handle_vector.clear();
+  CHECK(handle_vector.empty());
+  CHECK(!handle_vector.has(handle_2));
+}
+
+TEST_CASE("EpochContainerReaderCountIsLimited")
+{
+  thh::epoch_handle_vector_t<int> handle_vector(1);
+  auto reader_1 = handle_vector.register_reader();
+  CHECK(reader_1.has_value());
+  CHECK(!handle_vector.register_reader().has_value());
+  reader_1.reset();
+  CHECK(handle_vector.register_reader().has_value());
+}
+
+TEST_CASE("EpochContainerSupportsConcurrentReadersDuringMutation")
+{
+  thh::epoch_handle_vector_t<std::vector<int>> handle_vector;
+  std::atomic<bool> done = false;
+
+  // a handle that remains valid for the lifetime of the test
+  const auto stable_handle = handle_vector.add(std::vector<int>(16, 7));
+
+  std::vector<std::thread> readers;
+  std::atomic<int> failures = 0;
+  for (int r = 0; r < 3; ++r) {
+    readers.emplace_back([&] {
+      auto reader = handle_vector.register_reader();
+      while (!done.load()) {
+        const auto guard = reader->enter();
+        const auto* element = guard.resolve(stable_handle);
+        if (
+          element == nullptr || element->size() != 16
+          || (*element)[15] != 7) {
+          failures++;
+        }
+      }
+    });
+  }
+
+  std::vector<thh::handle_t> handles;
+  for (int i = 0; i < 2000; ++i) {
+    handles.push_back(handle_vector.add(std::vector<int>(8, i)));
+    if (i % 3 == 0) {
+      handle_vector.remove(handles[i / 2]);
+    }
+  }
+  done = true;
+  for (auto& reader : readers) {
+    reader.join();
+  }
+
+  CHECK(failures == 0);
+  CHECK(handle_vector.has(stable_handle));
+}
+
+TEST_CASE("ChunkedContainerPointersRemainStableWhileGrowing")
+{
+  thh::chunked_handle_vector_t<int, 4> handle_vector;
+  const auto first_handle = handle_vector.add(1);
+  const int* first = handle_vector.resolve(first_handle);
+
+  std::vector<thh::handle_t> handles;
+  for (int i = 0; i < 100; ++i) {
+    handles.push_back(handle_vector.add(i));
+  }
+
+  CHECK(handle_vector.size() == 101);
+  CHECK(handle_vector.capacity() >= 101);
+  CHECK(handle_vector.resolve(first_handle) == first);
+  CHECK(*first == 1);
+  for (int i = 0; i < 100; ++i) {
+    CHECK(handle_vector.call_return(handles[i], [](const int e) {
+      return e;
+    }) == i);
+  }
+
+  int chunk_count = 0;
+  int element_count = 0;
+  handle_vector.for_each_chunk([&](const int*, const int32_t count) {
+    CHECK(count <= 4);
+    chunk_count++;
+    element_count += count;
+  });
+  CHECK(chunk_count == 26);
+  CHECK(element_count == 101);
+}
+
+TEST_CASE("ChunkedContainerElementsRemainPackedAfterRemoveAndSort")
+{
+  thh::chunked_handle_vector_t<std::string, 4> handle_vector;
+  std::vector<thh::handle_t> handles;
+  for (int i = 0; i < 20; ++i) {
+    handles.push_back(handle_vector.add(std::to_string(i)));
+  }
+
+  CHECK(handle_vector.remove(handles[0]));
+  CHECK(handle_vector.remove(handles[7]));
+  CHECK(!handle_vector.remove(handles[7]));
+  const std::vector<thh::handle_t> range = {handles[3], handles[12]};
+  CHECK(handle_vector.remove(range.begin(), range.end()) == 2);
+  CHECK(handle_vector.size() == 16);
+  CHECK(std::distance(handle_vector.begin(), handle_vector.end()) == 16);
+
+  handle_vector.sort([&handle_vector](const int32_t lhs, const int32_t rhs) {
+    return std::stoi(handle_vector[lhs]) < std::stoi(handle_vector[rhs]);
+  });
+  CHECK(std::is_sorted(
+    handle_vector.begin(), handle_vector.end(),
+    [](const std::string& lhs, const std::string& rhs) {
+      return std::stoi(lhs) < std::stoi(rhs);
+    }));
+
+  for (int i = 0; i < 20; ++i) {
+    const auto value = handle_vector.call_return(
+      handles[i], [](const std::string& e) { return e; });
+    if (i == 0 || i == 3 || i == 7 || i == 12) {
+      CHECK(!value.has_value());
+    } else {
+      CHECK(value == std::to_string(i));
+    }
+  }
+
+  const auto second =
+    handle_vector.partition([&handle_vector](const int32_t index) {
+      return std::stoi(handle_vector[index]) % 2 == 0;
+    });
+  CHECK(second == 8);
+  int32_t position = 0;
+  handle_vector.for_each([&](const std::string& element) {
+    CHECK((std::stoi(element) % 2 == 0) == (position++ < second));
+  });
+  for (int i = 0; i < 20; ++i) {
+    if (handle_vector.has(handles[i])) {
+      CHECK(*handle_vector.resolve(handles[i]) == std::to_string(i));
+    }
+  }
+
+  handle_vector.clear();
+  CHECK(handle_vector.empty());
+  CHECK(!handle_vector.has(handles[1]));
+}
+
+TEST_CASE("PackedHandlesFitInASingleInteger")
+{
+  using packed_32_t = thh::packed_handle_t<thh::default_tag_t, 32, 20>;
+  using packed_64_t = thh::packed_handle_t<thh::default_tag_t, 64, 40>;
+  CHECK(sizeof(packed_32_t) == sizeof(uint32_t));
+  CHECK(sizeof(packed_64_t) == sizeof(uint64_t));
+
+  const packed_32_t invalid;
+  CHECK(invalid.id() == -1);
+  CHECK(invalid.gen() == -1);
+
+  const packed_32_t packed(5, 9);
+  CHECK(packed.id() == 5);
+  CHECK(packed.gen() == 9);
+  CHECK(packed.value() == (9u << 20 | 5u));
+  CHECK(packed != invalid);
+  CHECK(packed == packed_32_t(5, 9));
+  CHECK(packed < packed_32_t(5, 10));
+
+  const packed_64_t large((int64_t(1) << 39) + 3, (1 << 23) + 1);
+  CHECK(large.id() == (int64_t(1) << 39) + 3);
+  CHECK(large.gen() == (1 << 23) + 1);
+}
+
+TEST_CASE("PackedHandlesCanBeUsedWithContainer")
+{
+  using packed_t = thh::packed_handle_t<thh::default_tag_t, 32, 20>;
+  thh::packed_handle_vector_t<int, thh::default_tag_t, 32, 20> handle_vector;
+
+  std::vector<packed_t> handles;
+  for (int i = 0; i < 10; ++i) {
+    handles.push_back(handle_vector.add(i));
+  }
+
+  CHECK(!handle_vector.has(packed_t()));
+  for (int i = 0; i < 10; ++i) {
+    CHECK(handle_vector.call_return(handles[i], [](const int e) {
+      return e;
+    }) == i);
+  }
+
+  CHECK(handle_vector.remove(handles[4]));
+  CHECK(!handle_vector.has(handles[4]));
+  const packed_t readded = handle_vector.add(40);
+  CHECK(readded != handles[4]);
+  CHECK(!handle_vector.has(handles[4]));
+  CHECK(*handle_vector.call_return(readded, [](const int e) { return e; })
+        == 40);
+}
+
+TEST_CASE("PackedHandlesAreRetiredWhenGenerationBitsDeplete")
+{
+  // 4 generation bits (generations 0 to 14 are used, 15 is reserved)
+  using packed_t = thh::packed_handle_t<thh::default_tag_t, 32, 28>;
+  thh::packed_handle_vector_t<int, thh::default_tag_t, 32, 28> handle_vector;
+
+  std::vector<packed_t> handles;
+  for (int i = 0; i < 64; ++i) {
+    const packed_t handle = handle_vector.add(i);
+    CHECK(handle.gen() <= 14);
+    handles.push_back(handle);
+    handle_vector.remove(handle);
+  }
+
+  // no handle was reused with a generation that wrapped around
+  std::sort(handles.begin(), handles.end());
+  CHECK(std::adjacent_find(handles.begin(), handles.end()) == handles.end());
+  CHECK(handle_vector.capacity() > 1);
+  CHECK(handle_vector.empty());
+}
+
+TEST_CASE("ShrinkToFitReleasesCapacityAfterSpike")
+{
+  thh::handle_vector_t<int> handle_vector;
+  std::vector<thh::handle_t> handles(10000);
+  handle_vector.add_n(10000, handles.begin(), 1);
+  const auto before = handle_vector.memory_usage();
+  CHECK(before.element_bytes_ >= 10000 * sizeof(int));
+  CHECK(before.total_bytes() > before.element_bytes_);
+
+  CHECK(handle_vector.remove(handles.begin() + 10, handles.end()) == 9990);
+  handle_vector.shrink_to_fit();
+
+  const auto after = handle_vector.memory_usage();
+  CHECK(after.element_bytes_ < before.element_bytes_);
+  CHECK(after.id_bytes_ < before.id_bytes_);
+  // used handles keep their generation so are not released
+  CHECK(after.handle_bytes_ == before.handle_bytes_);
+
+  for (int i = 0; i < 10; ++i) {
+    CHECK(handle_vector.has(handles[i]));
+  }
+  for (int i = 10; i < 10000; ++i) {
+    CHECK(!handle_vector.has(handles[i]));
+  }
+  const auto handle = handle_vector.add(2);
+  CHECK(handle_vector.has(handle));
+  CHECK(std::find(handles.begin(), handles.end(), handle) == handles.end());
+}
+
+TEST_CASE("ShrinkToFitReleasesHandlesThatWereNeverUsed")
+{
+  thh::handle_vector_t<int> handle_vector;
+  handle_vector.reserve(1000);
+  std::vector<thh::handle_t> handles;
+  for (int i = 0; i < 5; ++i) {
+    handles.push_back(handle_vector.add(i));
+  }
+  handle_vector.remove(handles[2]);
+  CHECK(handle_vector.capacity() >= 1000);
+
+  handle_vector.shrink_to_fit();
+  CHECK(handle_vector.capacity() == 5);
+  CHECK(
+    handle_vector.memory_usage().handle_bytes_
+    < 1000 * sizeof(thh::handle_t));
+
+  // the removed handle is reused (with a new generation) before new handles
+  // are created
+  const auto readded = handle_vector.add(10);
+  CHECK(readded.id_ == handles[2].id_);
+  CHECK(!handle_vector.has(handles[2]));
+  std::vector<thh::handle_t> more;
+  for (int i = 0; i < 100; ++i) {
+    more.push_back(handle_vector.add(i));
+  }
+  CHECK(handle_vector.size() == 105);
+  for (int i = 0; i < 100; ++i) {
+    CHECK(*handle_vector.call_return(more[i], [](const int e) { return e; })
+          == i);
+  }
+
+  thh::chunked_handle_vector_t<int, 16> chunked;
+  for (int i = 0; i < 100; ++i) {
+    [[maybe_unused]] const auto chunked_handle = chunked.add(i);
+  }
+  chunked.clear();
+  chunked.shrink_to_fit();
+  CHECK(chunked.memory_usage().element_bytes_ == 0);
+}
+
+TEST_CASE("ParallelSortKeepsHandlesValid")
+{
+  thh::handle_vector_t<std::string> handle_vector;
+  std::vector<thh::handle_t> handles;
+  std::vector<int> values(100000);
+  std::iota(values.begin(), values.end(), 0);
+  std::shuffle(values.begin(), values.end(), std::mt19937(1));
+  for (const int value : values) {
+    handles.push_back(handle_vector.add(std::to_string(value)));
+  }
+  // removed elements are compacted before sorting
+  for (int i = 0; i < 100; ++i) {
+    handle_vector.remove(handles[i * 2]);
+  }
+
+  const auto to_int = [](const std::string& value) { return std::stoi(value); };
+  handle_vector.sort(
+    thh::parallel_t{4}, [&handle_vector, to_int](const int lhs, const int rhs) {
+      return to_int(handle_vector[lhs]) < to_int(handle_vector[rhs]);
+    });
+
+  CHECK(handle_vector.size() == 99900);
+  CHECK(std::is_sorted(
+    handle_vector.begin(), handle_vector.end(),
+    [to_int](const std::string& lhs, const std::string& rhs) {
+      return to_int(lhs) < to_int(rhs);
+    }));
+  for (int i = 0; i < 100000; ++i) {
+    const bool removed = i < 200 && i % 2 == 0;
+    CHECK(handle_vector.has(handles[i]) == !removed);
+    if (!removed) {
+      CHECK(
+        *handle_vector.call_return(handles[i], to_int) == values[i]);
+    }
+  }
+}
+
+TEST_CASE("ParallelPartitionKeepsHandlesValid")
+{
+  thh::handle_vector_t<int> handle_vector;
+  std::vector<thh::handle_t> handles;
+  for (int i = 0; i < 100000; ++i) {
+    handles.push_back(handle_vector.add(i));
+  }
+
+  const auto second = handle_vector.partition(
+    thh::parallel_t{4}, [&handle_vector](const int index) {
+      return handle_vector[index] % 3 == 0;
+    });
+
+  CHECK(second == 33334);
+  CHECK(std::all_of(
+    handle_vector.begin(), handle_vector.begin() + second,
+    [](const int e) { return e % 3 == 0; }));
+  CHECK(std::none_of(
+    handle_vector.begin() + second, handle_vector.end(),
+    [](const int e) { return e % 3 == 0; }));
+  for (int i = 0; i < 100000; ++i) {
+    CHECK(*handle_vector.call_return(handles[i], [](const int e) { return e; })
+          == i);
+  }
+
+  // small containers are handled on the calling thread
+  thh::handle_vector_t<int> small;
+  const auto handle = small.add(1);
+  [[maybe_unused]] const auto other = small.add(2);
+  CHECK(small.partition(thh::parallel_t{}, [](int) { return false; }) == 0);
+  CHECK(*small.call_return(handle, [](const int e) { return e; }) == 1);
+}
+
+TEST_CASE("ParallelSortSupportsOverAlignedElements")
+{
+  // gathered through a temporary buffer instead of the reusable storage
+  struct alignas(64) aligned_t
+  {
+    int value_;
+  };
+  thh::handle_vector_t<aligned_t> handle_vector;
+  std::vector<thh::handle_t> handles;
+  for (int i = 0; i < 100; ++i) {
+    handles.push_back(handle_vector.add(aligned_t{(i * 37) % 100}));
+  }
+
+  handle_vector.sort(
+    thh::parallel_t{2}, [&handle_vector](const int lhs, const int rhs) {
+      return handle_vector[lhs].value_ < handle_vector[rhs].value_;
+    });
+
+  for (int i = 0; i < 100; ++i) {
+    CHECK(handle_vector[i].value_ == i);
+    CHECK(
+      *handle_vector.call_return(
+        handles[i], [](const aligned_t& e) { return e.value_; })
+      == (i * 37) % 100);
+  }
+}
+
+TEST_CASE("SortElementsKeepsHandlesValid")
+{
+  std::vector<int> values(1000);
+  std::iota(values.begin(), values.end(), 0);
+  std::shuffle(values.begin(), values.end(), std::mt19937(1));
+
+  // small trivially copyable elements are sorted along with their ids
+  thh::handle_vector_t<int> handle_vector;
+  // other elements are sorted through indices
+  thh::handle_vector_t<std::string> strings;
+  std::vector<thh::handle_t> handles;
+  std::vector<thh::handle_t> string_handles;
+  for (const int value : values) {
+    handles.push_back(handle_vector.add(value));
+    string_handles.push_back(strings.add(std::to_string(value)));
+  }
+
+  handle_vector.sort_elements(std::greater<>());
+  strings.sort_elements(
+    10, 500, [](const std::string& lhs, const std::string& rhs) {
+      return lhs.size() < rhs.size() || (lhs.size() == rhs.size() && lhs < rhs);
+    });
+
+  CHECK(std::is_sorted(
+    handle_vector.begin(), handle_vector.end(), std::greater<>()));
+  CHECK(std::is_sorted(
+    strings.begin() + 10, strings.begin() + 500,
+    [](const std::string& lhs, const std::string& rhs) {
+      return std::stoi(lhs) < std::stoi(rhs);
+    }));
+  for (int i = 0; i < 1000; ++i) {
+    CHECK(
+      *handle_vector.call_return(handles[i], [](const int e) { return e; })
+      == values[i]);
+    CHECK(
+      *strings.call_return(
+        string_handles[i],
+        [](const std::string& e) { return std::stoi(e); })
+      == values[i]);
+  }
+}
+
+TEST_CASE("SortReusesScratchStorage")
+{
+  thh::handle_vector_t<int> handle_vector;
+  std::vector<thh::handle_t> handles;
+  for (int i = 0; i < 1000; ++i) {
+    handles.push_back(handle_vector.add(i % 10));
+  }
+  const auto compare = [&handle_vector](const int lhs, const int rhs) {
+    return handle_vector[lhs] < handle_vector[rhs];
+  };
+
+  handle_vector.sort(compare);
+  const auto after_first_sort = handle_vector.memory_usage();
+  handle_vector.sort(compare);
+  handle_vector.partition(
+    [&handle_vector](const int index) { return handle_vector[index] < 5; });
+  handle_vector.sort(100, 200, compare);
+  CHECK(handle_vector.memory_usage().id_bytes_ == after_first_sort.id_bytes_);
+  CHECK(std::is_partitioned(
+    handle_vector.begin(), handle_vector.end(), [](const int e) {
+      return e < 5;
+    }));
+  CHECK(
+    std::is_sorted(handle_vector.begin() + 100, handle_vector.begin() + 200));
+  for (int i = 0; i < 1000; ++i) {
+    CHECK(
+      *handle_vector.call_return(handles[i], [](const int e) { return e; })
+      == i % 10);
+  }
+
+  handle_vector.shrink_to_fit();
+  CHECK(handle_vector.memory_usage().id_bytes_ < after_first_sort.id_bytes_);
+}
+
+TEST_CASE("IncrementalSortRestoresOrderAfterSmallChanges")
+{
+  thh::handle_vector_t<int> handle_vector;
+  std::vector<thh::handle_t> handles;
+  for (int i = 0; i < 1000; ++i) {
+    handles.push_back(handle_vector.add(i * 10));
+  }
+  const auto compare = [&handle_vector](const int lhs, const int rhs) {
+    return handle_vector[lhs] < handle_vector[rhs];
+  };
+
+  // nudge a few elements past their neighbours
+  for (const int i : {5, 100, 101, 500, 999}) {
+    handle_vector.call(handles[i], [i](int& e) { e += (i % 2 ? -25 : 25); });
+  }
+  handle_vector.incremental_sort(compare);
+
+  CHECK(std::is_sorted(handle_vector.begin(), handle_vector.end()));
+  for (int i = 0; i < 1000; ++i) {
+    const bool nudged = i == 5 || i == 100 || i == 101 || i == 500 || i == 999;
+    const int offset = nudged ? (i % 2 ? -25 : 25) : 0;
+    CHECK(
+      *handle_vector.call_return(handles[i], [](const int e) { return e; })
+      == i * 10 + offset);
+  }
+}
+
+TEST_CASE("IncrementalSortFallsBackToSortWhenOutOfOrder")
+{
+  thh::handle_vector_t<int> handle_vector;
+  std::vector<thh::handle_t> handles;
+  for (int i = 0; i < 1000; ++i) {
+    handles.push_back(handle_vector.add(1000 - i));
+  }
+
+  handle_vector.incremental_sort(
+    10, 990, [&handle_vector](const int lhs, const int rhs) {
+      return handle_vector[lhs] < handle_vector[rhs];
+    });
+
+  CHECK(
+    std::is_sorted(handle_vector.begin() + 10, handle_vector.begin() + 990));
+  CHECK(handle_vector[0] == 1000);
+  CHECK(handle_vector[999] == 1);
+  for (int i = 0; i < 1000; ++i) {
+    CHECK(
+      *handle_vector.call_return(handles[i], [](const int e) { return e; })
+      == 1000 - i);
+  }
+}
+
+TEST_CASE("SortByKeyIsStableWithSignedKeys")
+{
+  struct item_t
+  {
+    int key_;
+    int order_;
+  };
+  thh::handle_vector_t<item_t> handle_vector;
+  std::vector<thh::handle_t> handles;
+  std::mt19937 gen(1);
+  std::uniform_int_distribution<int> key(-50, 50);
+  for (int i = 0; i < 10000; ++i) {
+    handles.push_back(handle_vector.add(item_t{key(gen), i}));
+  }
+  // only the top byte differs for these keys
+  handles.push_back(handle_vector.add(item_t{-(1 << 30), 10000}));
+
+  handle_vector.sort_by_key([](const item_t& item) { return item.key_; });
+
+  CHECK(handle_vector[0].key_ == -(1 << 30));
+  CHECK(std::is_sorted(
+    handle_vector.begin(), handle_vector.end(),
+    [](const item_t& lhs, const item_t& rhs) {
+      return lhs.key_ < rhs.key_
+          || (lhs.key_ == rhs.key_ && lhs.order_ < rhs.order_);
+    }));
+  for (int i = 0; i <= 10000; ++i) {
+    CHECK(
+      *handle_vector.call_return(
+        handles[i], [](const item_t& item) { return item.order_; })
+      == i);
+  }
+}
+
+TEST_CASE("SortByKeySupportsFloatingPointAndWideKeys")
+{
+  const float values[] = {3.5f, -1.0f, 0.0f, -100.25f, 1e20f, -1e-20f, 2.0f};
+  thh::handle_vector_t<float> floats;
+  std::vector<thh::handle_t> handles;
+  for (const float value : values) {
+    handles.push_back(floats.add(value));
+  }
+  floats.sort_by_key([](const float value) { return value; });
+  CHECK(std::is_sorted(floats.begin(), floats.end()));
+  for (size_t i = 0; i < std::size(values); ++i) {
+    CHECK(*floats.call_return(handles[i], [](const float e) { return e; })
+          == values[i]);
+  }
+
+  thh::handle_vector_t<int64_t> wide;
+  for (const int64_t value :
+       {int64_t(1) << 40, int64_t(-5), int64_t(7), -(int64_t(1) << 50)}) {
+    [[maybe_unused]] const auto handle = wide.add(value);
+  }
+  wide.sort_by_key([](const int64_t value) { return value; });
+  CHECK(
+    std::vector<int64_t>(wide.begin(), wide.end())
+    == std::vector<int64_t>{
+      -(int64_t(1) << 50), -5, 7, int64_t(1) << 40});
+
+  // sorting a sub-range by a double key
+  wide.sort_by_key(1, 3, [](const int64_t value) { return -double(value); });
+  CHECK(wide[1] == 7);
+  CHECK(wide[2] == -5);
+}
+
+TEST_CASE("SortByKeyReusesScratchStorage")
+{
+  std::vector<int> values(100000);
+  std::iota(values.begin(), values.end(), 0);
+  std::shuffle(values.begin(), values.end(), std::mt19937(1));
+
+  thh::handle_vector_t<int> handle_vector;
+  // elements that are not trivially copyable are swapped into place
+  thh::handle_vector_t<std::string> strings;
+  std::vector<thh::handle_t> handles;
+  std::vector<thh::handle_t> string_handles;
+  for (const int value : values) {
+    handles.push_back(handle_vector.add(value));
+    string_handles.push_back(strings.add(std::to_string(value)));
+  }
+
+  const auto reorder = [&handle_vector] {
+    handle_vector.sort_by_key([](const int value) { return -value; });
+    handle_vector.sort(
+      thh::parallel_t{4}, [&handle_vector](const int lhs, const int rhs) {
+        return handle_vector[lhs] < handle_vector[rhs];
+      });
+    [[maybe_unused]] const auto second = handle_vector.partition(
+      thh::parallel_t{4},
+      [&handle_vector](const int index) { return handle_vector[index] < 10; });
+  };
+  reorder();
+  const auto memory_usage = handle_vector.memory_usage().total_bytes();
+  // scratch storage has grown to fit, reordering again does not grow it
+  reorder();
+  CHECK(handle_vector.memory_usage().total_bytes() == memory_usage);
+
+  strings.sort_by_key(
+    [](const std::string& value) { return std::stoi(value); });
+
+  for (size_t i = 0; i < values.size(); ++i) {
+    CHECK(
+      *handle_vector.call_return(handles[i], [](const int e) { return e; })
+      == values[i]);
+    CHECK(
+      *strings.call_return(
+        string_handles[i],
+        [](const std::string& e) { return std::stoi(e); })
+      == values[i]);
+  }
+  CHECK(strings[0] == "0");
+  CHECK(strings[99999] == "99999");
+}
+
+TEST_CASE("SelectionAlgorithmsKeepHandlesValid")
+{
+  std::vector<int> values(1000);
+  std::iota(values.begin(), values.end(), 0);
+  std::shuffle(values.begin(), values.end(), std::mt19937(1));
+
+  thh::handle_vector_t<int> handle_vector;
+  std::vector<thh::handle_t> handles;
+  for (const int value : values) {
+    handles.push_back(handle_vector.add(value));
+  }
+  const auto compare = [&handle_vector](const int lhs, const int rhs) {
+    return handle_vector[lhs] < handle_vector[rhs];
+  };
+  const auto check_handles = [&] {
+    for (int i = 0; i < 1000; ++i) {
+      CHECK(
+        *handle_vector.call_return(handles[i], [](const int e) { return e; })
+        == values[i]);
+    }
+  };
+
+  handle_vector.nth_element(10, compare);
+  CHECK(handle_vector[10] == 10);
+  CHECK(std::all_of(
+    handle_vector.begin(), handle_vector.begin() + 10,
+    [](const int e) { return e < 10; }));
+  check_handles();
+
+  // shuffling elements in place leaves handles referring to new values
+  std::shuffle(handle_vector.begin(), handle_vector.end(), std::mt19937(2));
+  for (int i = 0; i < 1000; ++i) {
+    values[i] = handle_vector[*handle_vector.index_from_handle(handles[i])];
+  }
+  handle_vector.partial_sort(20, compare);
+  for (int i = 0; i < 20; ++i) {
+    CHECK(handle_vector[i] == i);
+  }
+  check_handles();
+
+  // partial_sort with middle past the end sorts everything
+  handle_vector.partial_sort(5000, compare);
+  CHECK(std::is_sorted(handle_vector.begin(), handle_vector.end()));
+  check_handles();
+}
+
+TEST_CASE("StableAlgorithmsPreserveRelativeOrder")
+{
+  struct item_t
+  {
+    int key_;
+    int order_;
+  };
+  thh::handle_vector_t<item_t> handle_vector;
+  std::vector<thh::handle_t> handles;
+  for (int i = 0; i < 1000; ++i) {
+    handles.push_back(handle_vector.add(item_t{(i * 7) % 10, i}));
+  }
+  const auto by_order = [](const item_t& lhs, const item_t& rhs) {
+    return lhs.order_ < rhs.order_;
+  };
+
+  const auto second =
+    handle_vector.stable_partition([&handle_vector](const int index) {
+      return handle_vector[index].key_ < 3;
+    });
+  CHECK(second == 300);
+  CHECK(std::is_sorted(
+    handle_vector.begin(), handle_vector.begin() + second, by_order));
+  CHECK(std::is_sorted(
+    handle_vector.begin() + second, handle_vector.end(), by_order));
+
+  handle_vector.stable_sort(
+    second, handle_vector.size(),
+    [&handle_vector](const int lhs, const int rhs) {
+      return handle_vector[lhs].key_ < handle_vector[rhs].key_;
+    });
+  for (int i = second + 1; i < handle_vector.size(); ++i) {
+    const auto& prev = handle_vector[i - 1];
+    const auto& curr = handle_vector[i];
+    CHECK(
+      (prev.key_ < curr.key_
+       || (prev.key_ == curr.key_ && prev.order_ < curr.order_)));
+  }
+  for (int i = 0; i < 1000; ++i) {
+    CHECK(
+      *handle_vector.call_return(
+        handles[i], [](const item_t& item) { return item.order_; })
+      == i);
+  }
+}
+
+TEST_CASE("ParallelForEachVisitsEveryElementWithItsHandle")
+{
+  thh::handle_vector_t<int> handle_vector;
+  std::vector<thh::handle_t> handles;
+  for (int i = 0; i < 10000; ++i) {
+    handles.push_back(handle_vector.add(0));
+  }
+  // tombstones are skipped
+  for (int i = 0; i < 10000; i += 10) {
+    handle_vector.remove_deferred(handles[i]);
+  }
+
+  std::vector<thh::handle_t> visited(handle_vector.size());
+  handle_vector.parallel_for_each(
+    thh::parallel_t{4},
+    [&visited, &handle_vector](const thh::handle_t handle, int& element) {
+      element++;
+      visited[*handle_vector.index_from_handle(handle)] = handle;
+    },
+    100);
+
+  for (int i = 0; i < 10000; ++i) {
+    const auto index = handle_vector.index_from_handle(handles[i]);
+    if (i % 10 == 0) {
+      CHECK(!index.has_value());
+    } else {
+      CHECK(visited[*index] == handles[i]);
+      CHECK(handle_vector[*index] == 1);
+    }
+  }
+}
+
+TEST_CASE("ParallelTransformReduceCombinesChunksInOrder")
+{
+  thh::handle_vector_t<int> handle_vector;
+  for (int i = 0; i < 5000; ++i) {
+    [[maybe_unused]] const auto handle = handle_vector.add(i);
+  }
+
+  const auto sum = handle_vector.parallel_transform_reduce(
+    thh::parallel_t{4}, int64_t(0), std::plus<>(),
+    [](thh::handle_t, const int element) { return int64_t(element); }, 64);
+  CHECK(sum == int64_t(4999) * 5000 / 2);
+
+  // chunks are combined in order so a non-commutative reduce is supported
+  thh::handle_vector_t<char> letters;
+  for (const char letter : std::string("handle-vector")) {
+    [[maybe_unused]] const auto handle = letters.add(letter);
+  }
+  const auto joined = letters.parallel_transform_reduce(
+    thh::parallel_t{4}, std::string(">"), std::plus<>(),
+    [](thh::handle_t, const char letter) { return std::string(1, letter); },
+    2);
+  CHECK(joined == ">handle-vector");
+
+  thh::handle_vector_t<int> empty;
+  CHECK(
+    empty.parallel_transform_reduce(
+      thh::parallel_t{}, 7, std::plus<>(),
+      [](thh::handle_t, const int element) { return element; })
+    == 7);
+}
+
+TEST_CASE("ParallelForEachRunsChunksOnAProvidedExecutor")
+{
+  thh::handle_vector_t<int> handle_vector;
+  for (int i = 0; i < 1000; ++i) {
+    [[maybe_unused]] const auto handle = handle_vector.add(i);
+  }
+
+  // stand-in for a thread pool (runs tasks in reverse order on the caller)
+  int64_t executed_tasks = 0;
+  const auto executor = [&executed_tasks](
+                          const int64_t task_count, auto&& task) {
+    for (int64_t i = task_count - 1; i >= 0; --i) {
+      task(i);
+      executed_tasks++;
+    }
+  };
+
+  handle_vector.parallel_for_each(
+    executor, [](thh::handle_t, int& element) { element *= 2; }, 100);
+  CHECK(executed_tasks == 10);
+  CHECK(handle_vector[999] == 1998);
+
+  // chunks are still combined in order whichever order they ran in
+  const auto sum = handle_vector.parallel_transform_reduce(
+    executor, int64_t(0), std::plus<>(),
+    [](thh::handle_t, const int element) { return int64_t(element); }, 64);
+  CHECK(executed_tasks == 26);
+  CHECK(sum == int64_t(999) * 1000);
+}
+
+TEST_CASE("ParallelForEachRethrowsAfterJoiningThreads")
+{
+  thh::handle_vector_t<int> handle_vector;
+  for (int i = 0; i < 1000; ++i) {
+    [[maybe_unused]] const auto handle = handle_vector.add(i);
+  }
+
+  // exceptions thrown from the calling thread and from other threads are
+  // both rethrown (instead of terminating)
+  for (const int throwing_element : {0, 999}) {
+    bool caught = false;
+    try {
+      handle_vector.parallel_for_each(
+        thh::parallel_t{4},
+        [throwing_element](thh::handle_t, const int element) {
+          if (element == throwing_element) {
+            throw std::runtime_error("element");
+          }
+        },
+        10);
+    } catch (const std::runtime_error&) {
+      caught = true;
+    }
+    CHECK(caught);
+  }
+
+  bool caught = false;
+  try {
+    [[maybe_unused]] const auto sum = handle_vector.parallel_transform_reduce(
+      thh::parallel_t{4}, 0, std::plus<>(),
+      [](thh::handle_t, const int element) {
+        if (element == 500) {
+          throw std::runtime_error("element");
+        }
+        return element;
+      },
+      10);
+  } catch (const std::runtime_error&) {
+    caught = true;
+  }
+  CHECK(caught);
+
+  // the container can be used afterwards
+  handle_vector.parallel_for_each(
+    thh::parallel_t{4}, [](thh::handle_t, int& element) { element++; }, 10);
+  CHECK(handle_vector[0] == 1);
+}
+
+TEST_CASE("ItemsViewYieldsHandleAndElementPairs")
+{
+  thh::handle_vector_t<int> handle_vector;
+  std::vector<thh::handle_t> handles;
+  for (int i = 0; i < 10; ++i) {
+    handles.push_back(handle_vector.add(i));
+  }
+  handle_vector.remove(handles[0]);
+  handle_vector.remove_deferred(handles[3]);
+  handle_vector.remove_deferred(handles[9]);
+
+  int visited = 0;
+  for (auto [handle, element] : handle_vector.items()) {
+    CHECK(handle_vector.has(handle));
+    CHECK(handle == handles[element]);
+    element *= 10;
+    visited++;
+  }
+  CHECK(visited == 7);
+
+  const auto& const_handle_vector = handle_vector;
+  int sum = 0;
+  for (const auto [handle, element] : const_handle_vector.items()) {
+    CHECK(
+      *const_handle_vector.call_return(handle, [](const int e) { return e; })
+      == element);
+    sum += element;
+  }
+  CHECK(sum == 10 * (1 + 2 + 4 + 5 + 6 + 7 + 8));
+
+  thh::handle_vector_t<int> empty;
+  CHECK(empty.items().begin() == empty.items().end());
+}
+
+TEST_CASE("HandlesCanBeWrittenForRangesOfElements")
+{
+  thh::handle_vector_t<int> handle_vector;
+  std::vector<thh::handle_t> handles;
+  for (int i = 0; i < 1003; ++i) {
+    handles.push_back(handle_vector.add(i));
+  }
+  for (int i = 0; i < 1003; i += 7) {
+    handle_vector.remove_deferred(handles[i]);
+  }
+
+  std::vector<thh::handle_t> written(1001);
+  handle_vector.handles_from_indices(1, 1001, written.data());
+  for (int i = 0; i < 1001; ++i) {
+    CHECK(written[i] == handle_vector.handle_from_index(i + 1));
+  }
+
+  int visited = 0;
+  handle_vector.for_each_item_chunk(
+    [&](const thh::handle_t* chunk_handles, int* elements, const int count) {
+      for (int i = 0; i < count; ++i) {
+        if (elements[i] % 7 == 0) {
+          CHECK(chunk_handles[i] == thh::handle_t{});
+        } else {
+          CHECK(chunk_handles[i] == handles[elements[i]]);
+        }
+      }
+      visited += count;
+    });
+  CHECK(visited == 1003);
+}
+
+TEST_CASE("ChangeTrackingRecordsModifiedAddedAndRemovedElements")
+{
+  thh::handle_vector_t<int> handle_vector;
+  std::vector<thh::handle_t> handles;
+  for (int i = 0; i < 100; ++i) {
+    handles.push_back(handle_vector.add(i));
+  }
+
+  const auto dirty_handles = [&handle_vector] {
+    std::vector<thh::handle_t> dirty;
+    handle_vector.for_each_dirty(
+      [&dirty](const thh::handle_t handle, const int) {
+        dirty.push_back(handle);
+      });
+    return dirty;
+  };
+  const auto added_handles = [&handle_vector] {
+    std::vector<thh::handle_t> added;
+    handle_vector.for_each_added(
+      [&added](const thh::handle_t handle, const int) {
+        added.push_back(handle);
+      });
+    return added;
+  };
+  const auto removed_handles = [&handle_vector] {
+    std::vector<thh::handle_t> removed;
+    handle_vector.for_each_removed(
+      [&removed](const thh::handle_t handle) { removed.push_back(handle); });
+    return removed;
+  };
+
+  // nothing is recorded until tracking is enabled
+  handle_vector.call(handles[1], [](int& element) { element += 1000; });
+  CHECK(!handle_vector.tracking_changes());
+  handle_vector.track_changes(true);
+  CHECK(handle_vector.tracking_changes());
+  CHECK(dirty_handles().empty());
+  CHECK(added_handles().empty());
+
+  handle_vector.call(handles[10], [](int& element) { element += 1000; });
+  handle_vector[20] += 1000;
+  handle_vector.mark_dirty(handles[30]);
+  // reading through a const container is not a change
+  const auto& const_handle_vector = handle_vector;
+  CHECK(const_handle_vector[40] == 40);
+  const auto added = handle_vector.add(500);
+  const auto transient = handle_vector.add(600);
+  handle_vector.call(added, [](int& element) { element++; });
+  handle_vector.remove(transient);
+  handle_vector.remove(handles[40]);
+  handle_vector.remove_deferred(handles[50]);
+  handle_vector.remove(handles[10]);
+
+  CHECK(
+    dirty_handles() == std::vector<thh::handle_t>{handles[20], handles[30]});
+  CHECK(added_handles() == std::vector<thh::handle_t>{added});
+  CHECK(*handle_vector.call_return(added, [](int e) { return e; }) == 501);
+  CHECK(
+    removed_handles()
+    == std::vector<thh::handle_t>{handles[40], handles[50], handles[10]});
+
+  handle_vector.clear_dirty();
+  CHECK(dirty_handles().empty());
+  CHECK(added_handles().empty());
+  CHECK(removed_handles().empty());
+
+  // clearing the container removes everything except elements added since
+  const auto size = handle_vector.size();
+  [[maybe_unused]] const auto unreported = handle_vector.add(700);
+  handle_vector.clear();
+  CHECK(removed_handles().size() == size);
+  CHECK(added_handles().empty());
+
+  handle_vector.track_changes(false);
+  handle_vector.remove(handle_vector.add(800));
+  handle_vector[0] = 1;
+  handle_vector.track_changes(true);
+  CHECK(dirty_handles().empty());
+  CHECK(removed_handles().empty());
+}
+
+TEST_CASE("ChangeTrackingFollowsElementsAsTheyMove")
+{
+  thh::handle_vector_t<int> handle_vector;
+  std::vector<thh::handle_t> handles;
+  for (int i = 0; i < 200; ++i) {
+    handles.push_back(handle_vector.add((i * 37) % 200));
+  }
+  handle_vector.track_changes(true);
+
+  std::vector<thh::handle_t> expected;
+  for (int i = 0; i < 200; i += 3) {
+    handle_vector.mark_dirty(handles[i]);
+    expected.push_back(handles[i]);
+  }
+  const auto remove_expected = [&expected](const thh::handle_t handle) {
+    expected.erase(std::remove(expected.begin(), expected.end(), handle));
+  };
+
+  // dirty elements are visited in element order with their current value
+  const auto check_dirty = [&] {
+    std::vector<thh::handle_t> dirty;
+    int last_position = -1;
+    handle_vector.for_each_dirty(
+      [&](const thh::handle_t handle, const int element) {
+        const auto position = handle_vector.index_from_handle(handle);
+        CHECK(position.has_value());
+        CHECK(*position > last_position);
+        CHECK(std::as_const(handle_vector)[*position] == element);
+        last_position = *position;
+        dirty.push_back(handle);
+      });
+    std::sort(dirty.begin(), dirty.end());
+    auto sorted = expected;
+    std::sort(sorted.begin(), sorted.end());
+    CHECK(dirty == sorted);
+  };
+  check_dirty();
+
+  const auto& elements = std::as_const(handle_vector);
+  const auto greater = [&elements](const int lhs, const int rhs) {
+    return elements[lhs] > elements[rhs];
+  };
+  const auto less = [&elements](const int lhs, const int rhs) {
+    return elements[lhs] < elements[rhs];
+  };
+
+  handle_vector.sort(greater);
+  check_dirty();
+
+  handle_vector.remove(handles[3]);
+  remove_expected(handles[3]);
+  handle_vector.remove(handles[4]);
+  check_dirty();
+
+  handle_vector.erase_stable(handles[6]);
+  remove_expected(handles[6]);
+  const thh::handle_t erased[] = {handles[9], handles[10], handles[9]};
+  handle_vector.erase_stable(std::begin(erased), std::end(erased));
+  remove_expected(handles[9]);
+  check_dirty();
+
+  handle_vector.remove_deferred(handles[12]);
+  remove_expected(handles[12]);
+  handle_vector.remove_deferred(handles[13]);
+  handle_vector.compact();
+  check_dirty();
+
+  handle_vector.sort_by_key([](const int element) { return element; });
+  check_dirty();
+  handle_vector.stable_sort(greater);
+  check_dirty();
+  handle_vector.partition(
+    [&elements](const int position) { return elements[position] % 2 == 0; });
+  check_dirty();
+  handle_vector.sort_elements(std::less<>());
+  check_dirty();
+  handle_vector.call(handles[1], [](int& element) { element = 1000; });
+  expected.push_back(handles[1]);
+  handle_vector.incremental_sort(less);
+  check_dirty();
+  handle_vector.sort(thh::parallel_t{2}, greater);
+  check_dirty();
+  handle_vector.partition(thh::parallel_t{2}, [&elements](const int position) {
+    return elements[position] < 100;
+  });
+  check_dirty();
+  handle_vector.nth_element(50, less);
+  check_dirty();
+
+  const thh::handle_t removed[] = {handles[15], handles[16], handles[15]};
+  handle_vector.remove(std::begin(removed), std::end(removed));
+  remove_expected(handles[15]);
+  check_dirty();
+
+  handle_vector.shrink_to_fit();
+  check_dirty();
+}
+
+TEST_CASE("ReorderingWithMutableAccessDoesNotMarkElementsDirty")
+{
+  thh::handle_vector_t<int> handle_vector;
+  std::vector<thh::handle_t> handles;
+  for (int i = 0; i < 20000; ++i) {
+    handles.push_back(handle_vector.add((i * 7919) % 20000));
+  }
+  handle_vector.track_changes(true);
+  std::vector<thh::handle_t> expected;
+  for (int i = 0; i < 20000; i += 101) {
+    handle_vector.mark_dirty(handles[i]);
+    expected.push_back(handles[i]);
+  }
+  std::sort(expected.begin(), expected.end());
+
+  const auto check_dirty = [&] {
+    std::vector<thh::handle_t> dirty;
+    handle_vector.for_each_dirty(
+      [&dirty](const thh::handle_t handle, int) { dirty.push_back(handle); });
+    std::sort(dirty.begin(), dirty.end());
+    CHECK(dirty == expected);
+  };
+
+  // comparators using the mutable operator[] only read elements
+  const auto less = [&handle_vector](const int lhs, const int rhs) {
+    return handle_vector[lhs] < handle_vector[rhs];
+  };
+  const auto greater = [&handle_vector](const int lhs, const int rhs) {
+    return handle_vector[lhs] > handle_vector[rhs];
+  };
+  const auto even = [&handle_vector](const int position) {
+    return handle_vector[position] % 2 == 0;
+  };
+
+  handle_vector.sort(greater);
+  check_dirty();
+  handle_vector.stable_sort(less);
+  check_dirty();
+  handle_vector.partition(even);
+  check_dirty();
+  handle_vector.stable_partition(even);
+  check_dirty();
+  handle_vector.partial_sort(100, greater);
+  check_dirty();
+  handle_vector.nth_element(100, less);
+  check_dirty();
+  // falls back to a full sort
+  handle_vector.incremental_sort(less);
+  check_dirty();
+  // sorted by insertion alone
+  handle_vector.incremental_sort(less);
+  check_dirty();
+
+  // comparators are invoked concurrently
+  handle_vector.sort(thh::parallel_t{4}, greater);
+  CHECK(std::is_sorted(
+    handle_vector.begin(), handle_vector.end(), std::greater<>()));
+  check_dirty();
+  handle_vector.partition(thh::parallel_t{4}, even);
+  check_dirty();
+
+  // recording resumes once the reorder is done
+  int position = 0;
+  while (std::binary_search(
+    expected.begin(), expected.end(),
+    handle_vector.handle_from_index(position))) {
+    position++;
+  }
+  handle_vector[position] = -1;
+  expected.push_back(handle_vector.handle_from_index(position));
+  std::sort(expected.begin(), expected.end());
+  check_dirty();
+}
+
+TEST_CASE("RegistryHandlesAreSharedBetweenStorages")
+{
+  thh::handle_registry_t<> registry;
+  thh::handle_storage_t<float> positions(registry);
+  thh::handle_storage_t<std::string> names(registry);
+
+  std::vector<thh::handle_t> entities;
+  for (int i = 0; i < 10; ++i) {
+    entities.push_back(registry.create());
+    CHECK(positions.add(entities.back(), float(i)));
+    if (i % 2 == 0) {
+      CHECK(names.add(entities.back(), std::to_string(i)));
+    }
+  }
+  CHECK(registry.size() == 10);
+  CHECK(positions.size() == 10);
+  CHECK(names.size() == 5);
+
+  // a handle can only have one element per storage
+  CHECK(!positions.add(entities[0], 100.0f));
+  CHECK(*positions.call_return(entities[0], [](float p) { return p; }) == 0.0f);
+
+  // elements are visited densely along with the shared handle
+  names.for_each([&](const thh::handle_t handle, const std::string& name) {
+    CHECK(
+      *positions.call_return(handle, [](const float p) { return p; })
+      == std::stof(name));
+  });
+
+  // destroying a handle removes its element from every storage
+  CHECK(registry.destroy(entities[4]));
+  CHECK(!registry.destroy(entities[4]));
+  CHECK(!registry.has(entities[4]));
+  CHECK(!positions.has(entities[4]));
+  CHECK(!names.has(entities[4]));
+  CHECK(positions.size() == 9);
+  CHECK(names.size() == 4);
+
+  // removing an element from one storage leaves the handle in use
+  CHECK(names.remove(entities[2]));
+  CHECK(registry.has(entities[2]));
+  CHECK(positions.has(entities[2]));
+
+  // destroyed handles are reused with a new generation
+  const auto reused = registry.create();
+  CHECK(reused.id_ == entities[4].id_);
+  CHECK(reused.gen_ == entities[4].gen_ + 1);
+  CHECK(!positions.has(reused));
+  CHECK(!positions.add(entities[4], 4.0f));
+  CHECK(positions.add(reused, 40.0f));
+
+  for (int i = 0; i < positions.size(); ++i) {
+    const auto handle = positions.handle_from_index(i);
+    CHECK(registry.has(handle));
+    CHECK(*positions.index_from_handle(handle) == i);
+  }
+
+  int in_use = 0;
+  registry.for_each([&](const thh::handle_t handle) {
+    CHECK(registry.has(handle));
+    in_use++;
+  });
+  CHECK(in_use == 10);
+
+  registry.clear();
+  CHECK(registry.empty());
+  CHECK(positions.empty());
+  CHECK(names.empty());
+  CHECK(!positions.has(reused));
+  for (const auto& entity : entities) {
+    CHECK(!registry.has(entity));
+  }
+}
+
+TEST_CASE("StoragesDetachFromRegistryWhenDestroyed")
+{
+  thh::handle_registry_t<> registry;
+  const auto entity = registry.create();
+  {
+    thh::handle_storage_t<int> scoped(registry);
+    CHECK(scoped.add(entity, 1));
+  }
+  thh::handle_storage_t<int> storage(registry);
+  CHECK(storage.add(entity, 2));
+  CHECK(registry.destroy(entity));
+  CHECK(storage.empty());
+
+  // handles that were never created cannot have elements added
+  CHECK(!storage.add(thh::handle_t{}, 3));
+  CHECK(!storage.add(thh::handle_t(5, 0), 3));
+
+  // handles are retired once their generation reaches its limit
+  thh::handle_registry_t<
+    thh::detail::packed_tag_t<struct small_gen_t, 32, 30>, int32_t, int32_t>
+    small;
+  for (int gen = 0; gen <= 2; ++gen) {
+    const auto handle = small.create();
+    CHECK(handle.id_ == 0);
+    CHECK(handle.gen_ == gen);
+    CHECK(small.destroy(handle));
+  }
+  CHECK(small.create().id_ == 1);
+  CHECK(small.capacity() == 2);
+  // clearing keeps retired handles out of use
+  small.clear();
+  const auto after_clear = small.create();
+  CHECK(after_clear.id_ == 1);
+  CHECK(after_clear.gen_ == 1);
+  CHECK(small.capacity() == 2);
+}
+
+TEST_CASE("JoinVisitsElementsSharedByEveryStorage")
+{
+  thh::handle_registry_t<> registry;
+  thh::handle_storage_t<int> values(registry);
+  thh::handle_storage_t<std::string> names(registry);
+  thh::handle_storage_t<float> weights(registry);
+
+  // enough elements to span several resolved blocks
+  std::vector<thh::handle_t> entities;
+  for (int i = 0; i < 300; ++i) {
+    entities.push_back(registry.create());
+    values.add(entities.back(), i);
+    if (i % 3 == 0) {
+      names.add(entities.back(), std::to_string(i));
+    }
+    if (i % 2 == 0) {
+      weights.add(entities.back(), float(i));
+    }
+  }
+
+  // only handles with an element in every storage are visited (driven by
+  // names as it is the smallest storage)
+  int visited = 0;
+  for (auto [handle, value, name, weight] : thh::join(values, names, weights)) {
+    CHECK(value % 6 == 0);
+    CHECK(std::to_string(value) == name);
+    CHECK(weight == float(value));
+    CHECK(*values.index_from_handle(handle) == value);
+    value = -value;
+    visited++;
+  }
+  CHECK(visited == 50);
+
+  // references are to the stored elements
+  values.for_each([](thh::handle_t, const int value) {
+    CHECK((value % 6 != 0 || value <= 0));
+  });
+
+  // the view restarts each time it is iterated and follows removals
+  registry.destroy(entities[6]);
+  names.remove(entities[12]);
+  auto joined = thh::join(weights, names);
+  int rows = 0;
+  joined.for_each([&](thh::handle_t handle, float&, std::string& name) {
+    CHECK(handle != entities[6]);
+    CHECK(handle != entities[12]);
+    CHECK(names.has(handle));
+    CHECK(!name.empty());
+    rows++;
+  });
+  CHECK(rows == 48);
+  CHECK(std::distance(joined.begin(), joined.end()) == 48);
+
+  // an empty storage produces no rows
+  thh::handle_storage_t<char> empty(registry);
+  CHECK(thh::join(values, empty).begin() == thh::join(values, empty).end());
+}
+
+TEST_CASE("JoinResolvesHandlesReturnedByKeyExtractor")
+{
+  struct position_t
+  {
+    float x_;
+  };
+  struct velocity_t
+  {
+    float dx_;
+    thh::handle_t position_;
+  };
+
+  thh::handle_vector_t<position_t> positions;
+  thh::handle_vector_t<velocity_t> velocities;
+
+  std::vector<thh::handle_t> position_handles;
+  for (int i = 0; i < 200; ++i) {
+    position_handles.push_back(positions.add(position_t{float(i)}));
+  }
+  // velocities refer to positions in reverse order
+  for (int i = 0; i < 200; ++i) {
+    [[maybe_unused]] const auto handle =
+      velocities.add(velocity_t{1.0f, position_handles[199 - i]});
+  }
+  // removed positions leave their velocities unresolved
+  positions.remove(position_handles[10]);
+  positions.remove(position_handles[150]);
+
+  const auto key = [](const velocity_t& velocity) {
+    return velocity.position_;
+  };
+  int visited = 0;
+  for (auto [handle, velocity, position] :
+       thh::join(key, velocities, positions)) {
+    CHECK(velocities.has(handle));
+    position.x_ += velocity.dx_;
+    visited++;
+  }
+  CHECK(visited == 198);
+  for (int i = 0; i < 200; ++i) {
+    if (i == 10 || i == 150) {
+      continue;
+    }
+    CHECK(
+      *positions.call_return(
+        position_handles[i], [](const position_t& p) { return p.x_; })
+      == float(i + 1));
+  }
+
+  // tombstones in the driving container are skipped and several containers
+  // can be joined by returning a tuple of handles
+  thh::handle_vector_t<int> scores;
+  [[maybe_unused]] const auto score = scores.add(7);
+  velocities.remove_deferred(velocities.handle_from_index(0));
+  const auto keys = [&](const velocity_t& velocity) {
+    return std::make_tuple(velocity.position_, scores.handle_from_index(0));
+  };
+  int rows = 0;
+  thh::join(keys, velocities, positions, scores)
+    .for_each([&](thh::handle_t, velocity_t&, position_t&, int& score) {
+      CHECK(score == 7);
+      rows++;
+    });
+  CHECK(rows == 197);
+}
+
+TEST_CASE("FreeListLinksSurviveRemovalInMixedOrder")
+{
+  thh::handle_vector_t<int> handle_vector;
+  std::vector<thh::handle_t> handles;
+  for (int i = 0; i < 100; ++i) {
+    handles.push_back(handle_vector.add(i));
+  }
+  const auto capacity = handle_vector.capacity();
+
+  // free handles in an order unrelated to their ids or element positions
+  std::vector<thh::handle_t> stale = handles;
+  std::shuffle(stale.begin(), stale.end(), std::mt19937(7));
+  stale.resize(60);
+  for (size_t i = 0; i < stale.size(); i += 2) {
+    handle_vector.remove(stale[i]);
+  }
+  for (size_t i = 1; i < stale.size(); i += 2) {
+    handle_vector.remove(stale[i]);
+  }
+  CHECK(handle_vector.size() == 40);
+
+  // re-add until every free handle has been reused (the free list is
+  // drained without growing)
+  std::vector<thh::handle_t> added;
+  while (handle_vector.size() < capacity) {
+    added.push_back(handle_vector.add(-1));
+  }
+  CHECK(handle_vector.capacity() == capacity);
+
+  for (const auto handle : stale) {
+    CHECK(!handle_vector.has(handle));
+  }
+  for (const auto handle : added) {
+    CHECK(handle_vector.has(handle));
+    CHECK(
+      handle_vector.call_return(handle, [](const int i) { return i; }) == -1);
+  }
+
+  // bulk resolution (gathering eight at a time with AVX2) agrees
+  std::vector<int32_t> indices(stale.size());
+  CHECK(
+    handle_vector.indices_from_handles(
+      stale.data(), static_cast<int32_t>(stale.size()), indices.data())
+    == 0);
+  CHECK(std::all_of(
+    indices.begin(), indices.end(), [](const int32_t i) { return i == -1; }));
+  indices.resize(added.size());
+  CHECK(
+    handle_vector.indices_from_handles(
+      added.data(), static_cast<int32_t>(added.size()), indices.data())
+    == static_cast<int32_t>(added.size()));
+}